@@ -10,6 +10,7 @@
 #include "http.h"
 #include "io.h"
 #include "io_gpio.h"
+#include "io_ledpixel.h"
 #include "sys_time.h"
 #include "ota.h"
 #include "sequencer.h"
@@ -36,36 +37,30 @@ roflash static const application_function_table_t application_function_table[];
 
 typedef struct
 {
-	int	io;
-	int	pin;
+	config_cache_t		io;
+	config_cache_t		pin;
+	config_cache_slot_t	io_slot;
+	config_cache_slot_t	pin_slot;
 } trigger_t;
 
-static trigger_t trigger_alert = { -1, -1 };
+static trigger_t trigger_alert;
 
 void application_init(void)
 {
-	int io, pin;
-
-	trigger_alert.io = -1;
-	trigger_alert.pin = -1;
-
-	if(config_get_int("trigger.status.io", &io, -1, -1) &&
-			config_get_int("trigger.status.pin", &pin, -1, -1))
-	{
-		trigger_alert.io = io;
-		trigger_alert.pin = pin;
-	}
+	config_cache_register(&trigger_alert.io, &trigger_alert.io_slot, 1, config_key_trigger_status_io, false, -1);
+	config_cache_register(&trigger_alert.pin, &trigger_alert.pin_slot, 1, config_key_trigger_status_pin, false, -1);
 }
 
 app_action_t application_content(string_t *src, string_t *dst)
 {
 	const application_function_table_t *tableptr;
+	int io, pin;
 
-	if((trigger_alert.io >= 0) &&
-			(trigger_alert.pin >= 0))
-	{
-		io_trigger_pin((string_t *)0, trigger_alert.io, trigger_alert.pin, io_trigger_on);
-	}
+	io = config_cache_int(&trigger_alert.io, -1, -1);
+	pin = config_cache_int(&trigger_alert.pin, -1, -1);
+
+	if((io >= 0) && (pin >= 0))
+		io_trigger_pin((string_t *)0, io, pin, io_trigger_on);
 
 	if(parse_string(0, src, dst, ' ') != parse_ok)
 		return(app_action_empty);
@@ -96,6 +91,21 @@ static app_action_t application_function_config_dump(string_t *src, string_t *ds
 	return(app_action_normal);
 }
 
+static app_action_t application_function_config_commit(string_t *src, string_t *dst)
+{
+	bool pending = config_commit_pending();
+
+	if(!config_commit())
+	{
+		string_append(dst, "config-commit: failed\n");
+		return(app_action_error);
+	}
+
+	string_format(dst, "config-commit: %s\n", pending ? "committed" : "no uncommitted changes");
+
+	return(app_action_normal);
+}
+
 static app_action_t application_function_config_query_int(string_t *src, string_t *dst)
 {
 	int index1 = -1;
@@ -274,7 +284,7 @@ static app_action_t application_function_identification(string_t *src, string_t
 		string_splice(&text, 0, src, start, -1);
 
 		if(!config_open_write() ||
-				!config_set_string("identification", string_to_cstr(&text), -1, -1) ||
+				!config_set_string(config_key_identification, string_to_cstr(&text), -1, -1) ||
 				!config_close_write())
 		{
 			config_abort_write();
@@ -285,10 +295,10 @@ static app_action_t application_function_identification(string_t *src, string_t
 
 	string_clear(&text);
 
-	if(config_get_string("identification", &text, -1, -1) && string_empty(&text))
+	if(config_get_string(config_key_identification, &text, -1, -1) && string_empty(&text))
 	{
 		if(!config_open_write() ||
-				!config_delete("identification", false, -1, -1) ||
+				!config_delete(config_key_identification, -1, -1) ||
 				!config_close_write())
 		{
 			config_abort_write();
@@ -299,7 +309,7 @@ static app_action_t application_function_identification(string_t *src, string_t
 
 	string_clear(&text);
 
-	if(!config_get_string("identification", &text, -1, -1))
+	if(!config_get_string(config_key_identification, &text, -1, -1))
 		string_append(&text, "<unset>");
 
 	string_format(dst, "identification is \"%s\"\n", string_to_cstr(&text));
@@ -368,7 +378,7 @@ static app_action_t application_function_bridge_port(string_t *src, string_t *ds
 		if(port == 0)
 		{
 			if(!config_open_write() ||
-					!config_delete("bridge.port", -1, -1, false) ||
+					!config_delete(config_key_bridge_port, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -378,7 +388,7 @@ static app_action_t application_function_bridge_port(string_t *src, string_t *ds
 		}
 		else
 			if(!config_open_write() ||
-					!config_set_int("bridge.port", port, -1, -1) ||
+					!config_set_int(config_key_bridge_port, port, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -387,7 +397,7 @@ static app_action_t application_function_bridge_port(string_t *src, string_t *ds
 			}
 	}
 
-	if(!config_get_uint("bridge.port", &port, -1, -1))
+	if(!config_get_uint(config_key_bridge_port, &port, -1, -1))
 		port = 0;
 
 	string_format(dst, "> port: %u\n", port);
@@ -410,7 +420,7 @@ static app_action_t application_function_command_port(string_t *src, string_t *d
 		if(port == 24)
 		{
 			if(!config_open_write() ||
-					!config_delete("cmd.port", false, -1, -1) ||
+					!config_delete(config_key_cmd_port, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -420,7 +430,7 @@ static app_action_t application_function_command_port(string_t *src, string_t *d
 		}
 		else
 			if(!config_open_write() ||
-					!config_set_int("cmd.port", port, -1, -1) ||
+					!config_set_int(config_key_cmd_port, port, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -429,7 +439,7 @@ static app_action_t application_function_command_port(string_t *src, string_t *d
 			}
 	}
 
-	if(!config_get_uint("cmd.port", &port, -1, -1))
+	if(!config_get_uint(config_key_cmd_port, &port, -1, -1))
 		port = 24;
 
 	string_format(dst, "> port: %u\n", port);
@@ -618,7 +628,7 @@ static app_action_t application_function_uart_baud_rate(string_t *src, string_t
 		if(baud_rate == 115200)
 		{
 			if(!config_open_write() ||
-					!config_delete("uart.baud.%u", false, uart, -1) ||
+					!config_delete(config_key_uart_baud, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -628,7 +638,7 @@ static app_action_t application_function_uart_baud_rate(string_t *src, string_t
 		}
 		else
 			if(!config_open_write() ||
-					!config_set_int("uart.baud.%u", baud_rate, uart, -1) ||
+					!config_set_int(config_key_uart_baud, baud_rate, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -639,7 +649,7 @@ static app_action_t application_function_uart_baud_rate(string_t *src, string_t
 		uart_baudrate(uart, baud_rate);
 	}
 
-	if(!config_get_uint("uart.baud.%u", &baud_rate, uart, -1))
+	if(!config_get_uint(config_key_uart_baud, &baud_rate, uart, -1))
 		baud_rate = 115200;
 
 	string_format(dst, "> baudrate[%u]: %u\n", uart, baud_rate);
@@ -668,7 +678,7 @@ static app_action_t application_function_uart_data_bits(string_t *src, string_t
 		if(data_bits == 8)
 		{
 			if(!config_open_write() ||
-					!config_delete("uart.data.%u", false, uart, -1) ||
+					!config_delete(config_key_uart_data, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -679,7 +689,7 @@ static app_action_t application_function_uart_data_bits(string_t *src, string_t
 		}
 		else
 			if(!config_open_write() ||
-					!config_set_int("uart.data.%u", data_bits, uart, -1) ||
+					!config_set_int(config_key_uart_data, data_bits, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -690,7 +700,7 @@ static app_action_t application_function_uart_data_bits(string_t *src, string_t
 		uart_data_bits(uart, data_bits);
 	}
 
-	if(!config_get_uint("uart.data.%u", &data_bits, uart, -1))
+	if(!config_get_uint(config_key_uart_data, &data_bits, uart, -1))
 		data_bits = 8;
 
 	string_format(dst, "data bits[%u]: %u\n", uart, data_bits);
@@ -719,7 +729,7 @@ static app_action_t application_function_uart_stop_bits(string_t *src, string_t
 		if(stop_bits == 1)
 		{
 			if(!config_open_write() ||
-					!config_delete("uart.stop.%u", false, uart, -1) ||
+					!config_delete(config_key_uart_stop, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -729,7 +739,7 @@ static app_action_t application_function_uart_stop_bits(string_t *src, string_t
 		}
 		else
 			if(!config_open_write() ||
-					!config_set_int("uart.stop.%u", stop_bits, uart, -1) ||
+					!config_set_int(config_key_uart_stop, stop_bits, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -740,7 +750,7 @@ static app_action_t application_function_uart_stop_bits(string_t *src, string_t
 		uart_stop_bits(uart, stop_bits);
 	}
 
-	if(!config_get_uint("uart.stop.%u", &stop_bits, uart, -1))
+	if(!config_get_uint(config_key_uart_stop, &stop_bits, uart, -1))
 		stop_bits = 1;
 
 	string_format(dst, "> stop bits[%u]: %u\n", uart, stop_bits);
@@ -772,7 +782,7 @@ static app_action_t application_function_uart_parity(string_t *src, string_t *ds
 		if(parity == parity_none)
 		{
 			if(!config_open_write() ||
-					!config_delete("uart.parity.%u", false, uart, -1) ||
+					!config_delete(config_key_uart_parity, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -786,7 +796,7 @@ static app_action_t application_function_uart_parity(string_t *src, string_t *ds
 			parity_int = (int)parity;
 
 			if(!config_open_write() ||
-					!config_set_int("uart.parity.%u", parity_int, uart, -1) ||
+					!config_set_int(config_key_uart_parity, parity_int, uart, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -798,7 +808,7 @@ static app_action_t application_function_uart_parity(string_t *src, string_t *ds
 		uart_parity(uart, parity);
 	}
 
-	if(config_get_uint("uart.parity.%u", &parity_int, uart, -1))
+	if(config_get_uint(config_key_uart_parity, &parity_int, uart, -1))
 		parity = (uart_parity_t)parity_int;
 	else
 		parity = parity_none;
@@ -839,6 +849,64 @@ static app_action_t application_function_uart_loopback(string_t *src, string_t *
 	return(app_action_normal);
 }
 
+static app_action_t application_function_uart_frame(string_t *src, string_t *dst)
+{
+	unsigned int uart, gap, timestamp;
+	bool timestamp_enabled;
+
+	if((parse_uint(1, src, &uart, 0, ' ') != parse_ok) || (uart > 0))
+	{
+		string_append(dst, "> usage uart-frame <uart [0]> [<gap in character times [0-127]> [<timestamp [0|1]>]]\n");
+		return(app_action_error);
+	}
+
+	if(parse_uint(2, src, &gap, 0, ' ') == parse_ok)
+	{
+		if(parse_uint(3, src, &timestamp, 0, ' ') != parse_ok)
+			timestamp = 0;
+
+		if((gap > 127) || (timestamp > 1))
+		{
+			string_append(dst, "> usage uart-frame <uart [0]> [<gap in character times [0-127]> [<timestamp [0|1]>]]\n");
+			return(app_action_error);
+		}
+
+		if(gap == 0)
+		{
+			if(!config_open_write() ||
+					!config_delete(config_key_uart_frame_gap, uart, -1) ||
+					!config_delete(config_key_uart_frame_timestamp, uart, -1) ||
+					!config_close_write())
+			{
+				config_abort_write();
+				string_append(dst, "> cannot delete config (default values)\n");
+				return(app_action_error);
+			}
+		}
+		else
+			if(!config_open_write() ||
+					!config_set_int(config_key_uart_frame_gap, gap, uart, -1) ||
+					!config_set_int(config_key_uart_frame_timestamp, timestamp, uart, -1) ||
+					!config_close_write())
+			{
+				config_abort_write();
+				string_append(dst, "> cannot set config\n");
+				return(app_action_error);
+			}
+
+		uart_frame_mode(uart, gap, !!timestamp);
+	}
+
+	uart_get_frame_mode(uart, &gap, &timestamp_enabled);
+
+	if(gap == 0)
+		string_format(dst, "> frame[%u]: off\n", uart);
+	else
+		string_format(dst, "> frame[%u]: gap: %u characters, timestamp: %s\n", uart, gap, onoff(timestamp_enabled));
+
+	return(app_action_normal);
+}
+
 static app_action_t application_function_uart_write(string_t *src, string_t *dst)
 {
 	unsigned int uart;
@@ -1080,7 +1148,7 @@ static app_action_t application_function_i2c_speed(string_t *src, string_t *dst)
 		if(speed_delay == 1000)
 		{
 			if(!config_open_write() ||
-					!config_delete("i2c.speed_delay", false, -1, -1) ||
+					!config_delete(config_key_i2c_speed_delay, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -1091,7 +1159,7 @@ static app_action_t application_function_i2c_speed(string_t *src, string_t *dst)
 		}
 		else
 			if(!config_open_write() ||
-					!config_set_int("i2c.speed_delay", speed_delay, -1, -1) ||
+					!config_set_int(config_key_i2c_speed_delay, speed_delay, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -1100,7 +1168,7 @@ static app_action_t application_function_i2c_speed(string_t *src, string_t *dst)
 			}
 	}
 
-	if(!config_get_uint("i2c.speed_delay", &speed_delay, -1, -1))
+	if(!config_get_uint(config_key_i2c_speed_delay, &speed_delay, -1, -1))
 		speed_delay = 1000;
 
 	i2c_init(-1, -1, speed_delay);
@@ -1225,16 +1293,16 @@ static app_action_t application_function_i2c_sensor_calibrate(string_t *src, str
 			return(app_action_error);
 		}
 
-		config_delete("i2s.%u.%u.", true, bus, sensor);
+		config_delete_wildcard("i2s.%u.%u.", bus, sensor);
 
-		if((int_factor != 1000) && !config_set_int("i2s.%u.%u.factor", int_factor, bus, sensor))
+		if((int_factor != 1000) && !config_set_int(config_key_i2s_factor, int_factor, bus, sensor))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set factor\n");
 			return(app_action_error);
 		}
 
-		if((int_offset != 0) && !config_set_int("i2s.%u.%u.offset", int_offset, bus, sensor))
+		if((int_offset != 0) && !config_set_int(config_key_i2s_offset, int_offset, bus, sensor))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set offset\n");
@@ -1248,10 +1316,10 @@ static app_action_t application_function_i2c_sensor_calibrate(string_t *src, str
 		}
 	}
 
-	if(!config_get_int("i2s.%u.%u.factor", &int_factor, bus, sensor))
+	if(!config_get_int(config_key_i2s_factor, &int_factor, bus, sensor))
 		int_factor = 1000;
 
-	if(!config_get_int("i2s.%u.%u.offset", &int_offset, bus, sensor))
+	if(!config_get_int(config_key_i2s_offset, &int_offset, bus, sensor))
 		int_offset = 0;
 
 	string_format(dst, "> i2c sensor %u/%u calibration set to factor %f, offset: %f\n", bus, sensor, int_factor / 1000.0, int_offset / 1000.0);
@@ -1428,21 +1496,21 @@ static app_action_t application_function_wlan_ap_configure(string_t *src, string
 			return(app_action_error);
 		}
 
-		if(!config_set_string("wlan.ap.ssid", string_to_cstr(&ssid), -1, -1))
+		if(!config_set_string(config_key_wlan_ap_ssid, string_to_cstr(&ssid), -1, -1))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set config (set ssid)\n");
 			return(app_action_error);
 		}
 
-		if(!config_set_string("wlan.ap.passwd", string_to_cstr(&passwd), -1, -1))
+		if(!config_set_string(config_key_wlan_ap_passwd, string_to_cstr(&passwd), -1, -1))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set config (passwd)\n");
 			return(app_action_error);
 		}
 
-		if(!config_set_int("wlan.ap.channel", channel, -1, -1))
+		if(!config_set_int(config_key_wlan_ap_channel, channel, -1, -1))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set config (channel)\n");
@@ -1459,19 +1527,19 @@ static app_action_t application_function_wlan_ap_configure(string_t *src, string
 	string_clear(&ssid);
 	string_clear(&passwd);
 
-	if(!config_get_string("wlan.ap.ssid", &ssid, -1, -1))
+	if(!config_get_string(config_key_wlan_ap_ssid, &ssid, -1, -1))
 	{
 		string_clear(&ssid);
 		string_append(&ssid, "<empty>");
 	}
 
-	if(!config_get_string("wlan.ap.passwd", &passwd, -1, -1))
+	if(!config_get_string(config_key_wlan_ap_passwd, &passwd, -1, -1))
 	{
 		string_clear(&passwd);
 		string_append(&passwd, "<empty>");
 	}
 
-	if(!config_get_uint("wlan.ap.channel", &channel, -1, -1))
+	if(!config_get_uint(config_key_wlan_ap_channel, &channel, -1, -1))
 		channel = 0;
 
 	string_format(dst, "> ssid: \"%s\", passwd: \"%s\", channel: %u\n",
@@ -1499,14 +1567,14 @@ static app_action_t application_function_wlan_client_configure(string_t *src, st
 			return(app_action_error);
 		}
 
-		if(!config_set_string("wlan.client.ssid", string_to_cstr(&ssid), -1, -1))
+		if(!config_set_string(config_key_wlan_client_ssid, string_to_cstr(&ssid), -1, -1))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set config (write ssid)\n");
 			return(app_action_error);
 		}
 
-		if(!config_set_string("wlan.client.passwd", string_to_cstr(&passwd), -1, -1))
+		if(!config_set_string(config_key_wlan_client_passwd, string_to_cstr(&passwd), -1, -1))
 		{
 			config_abort_write();
 			string_append(dst, "> cannot set config (write passwd)\n");
@@ -1523,13 +1591,13 @@ static app_action_t application_function_wlan_client_configure(string_t *src, st
 	string_clear(&ssid);
 	string_clear(&passwd);
 
-	if(!config_get_string("wlan.client.ssid", &ssid, -1, -1))
+	if(!config_get_string(config_key_wlan_client_ssid, &ssid, -1, -1))
 	{
 		string_clear(&ssid);
 		string_append(&ssid, "<empty>");
 	}
 
-	if(!config_get_string("wlan.client.passwd", &passwd, -1, -1))
+	if(!config_get_string(config_key_wlan_client_passwd, &passwd, -1, -1))
 	{
 		string_clear(&passwd);
 		string_append(&passwd, "<empty>");
@@ -1553,7 +1621,7 @@ static app_action_t application_function_wlan_mode(string_t *src, string_t *dst)
 			string_clear(dst);
 
 			if(!config_open_write() ||
-					!config_set_int("wlan.mode", config_wlan_mode_client, -1, -1) ||
+					!config_set_int(config_key_wlan_mode, config_wlan_mode_client, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -1571,7 +1639,7 @@ static app_action_t application_function_wlan_mode(string_t *src, string_t *dst)
 			string_clear(dst);
 
 			if(!config_open_write() ||
-					!config_set_int("wlan.mode", config_wlan_mode_ap, -1, -1) ||
+					!config_set_int(config_key_wlan_mode, config_wlan_mode_ap, -1, -1) ||
 					!config_close_write())
 			{
 				config_abort_write();
@@ -1591,7 +1659,7 @@ static app_action_t application_function_wlan_mode(string_t *src, string_t *dst)
 	string_clear(dst);
 	string_append(dst, "> current mode: ");
 
-	if(config_get_uint("wlan.mode", &int_mode, -1, -1))
+	if(config_get_uint(config_key_wlan_mode, &int_mode, -1, -1))
 	{
 		mode = (config_wlan_mode_t)int_mode;
 
@@ -1626,12 +1694,43 @@ static app_action_t application_function_wlan_mode(string_t *src, string_t *dst)
 
 static app_action_t application_function_log_display(string_t *src, string_t *dst)
 {
-	if(string_length(&logbuffer) == 0)
+	unsigned int from, to, space;
+	string_new(, since, 8);
+
+	if(parse_string(1, src, &since, ' ') == parse_ok)
+	{
+		if(!string_match_cstr(&since, "since") || (parse_uint(2, src, &from, 0, ' ') != parse_ok))
+		{
+			string_append(dst, "> usage: log-display [since <sequence number>]\n");
+			return(app_action_error);
+		}
+
+		// oldest entries have been overwritten already
+
+		if((logbuffer_next() - from) > (logbuffer_next() - logbuffer_first()))
+			from = logbuffer_first();
+
+		// reserve some space for the header, the collector can continue from "next" if not everything fits
+
+		to = logbuffer_next();
+		space = string_size(dst) - 64;
+
+		if((to - from) > space)
+			to = from + space;
+
+		string_clear(dst);
+		string_format(dst, "> log first: %u, from: %u, next: %u\n", logbuffer_first(), from, to);
+		logbuffer_get(dst, from, to);
+
+		return(app_action_normal);
+	}
+
+	if(logbuffer_first() == logbuffer_next())
 		string_append(dst, "<log empty>\n");
 	else
 	{
 		string_clear(dst);
-		string_append_string(dst, &logbuffer);
+		logbuffer_get(dst, logbuffer_first(), logbuffer_next());
 	}
 
 	return(app_action_normal);
@@ -1648,6 +1747,14 @@ static app_action_t application_function_log_clear(string_t *src, string_t *dst)
 	return(rv);
 }
 
+static app_action_t application_function_log_binary(string_t *src, string_t *dst)
+{
+	string_append(dst, "> seq timestamp format arg0 arg1 arg2 arg3\n");
+	log_deferred_dump(dst);
+
+	return(app_action_normal);
+}
+
 static app_action_t application_function_log_write(string_t *src, string_t *dst)
 {
 	string_new(, text, 64);
@@ -1690,12 +1797,12 @@ static app_action_t application_function_sntp_set(string_t *src, string_t *dst)
 			return(app_action_error);
 		}
 
-		config_delete("ntp.", true, -1, -1);
-		config_delete("sntp.", true, -1, -1);
+		config_delete_wildcard("ntp.", -1, -1);
+		config_delete_wildcard("sntp.", -1, -1);
 
 		if(!string_match_cstr(&ip, "0.0.0.0"))
 		{
-			if(!config_set_string("sntp.server", string_to_cstr(&ip), -1, -1))
+			if(!config_set_string(config_key_sntp_server, string_to_cstr(&ip), -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "cannot set config (set sntp server)\n");
@@ -1705,7 +1812,7 @@ static app_action_t application_function_sntp_set(string_t *src, string_t *dst)
 
 		if(timezone != 0)
 		{
-			if(!config_set_int("sntp.tz", timezone, -1, -1))
+			if(!config_set_int(config_key_sntp_tz, timezone, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "cannot set config (set sntp timezone)\n");
@@ -1723,9 +1830,9 @@ static app_action_t application_function_sntp_set(string_t *src, string_t *dst)
 	}
 
 	string_clear(&ip);
-	config_get_string("sntp.server", &ip, -1, -1);
+	config_get_string(config_key_sntp_server, &ip, -1, -1);
 	timezone = 0;
-	config_get_int("sntp.tz", &timezone, -1, -1);
+	config_get_int(config_key_sntp_tz, &timezone, -1, -1);
 
 	string_format(dst, "sntp-set: server: %s, timezone: %d\n", string_to_cstr(&ip), timezone);
 
@@ -1752,8 +1859,8 @@ static app_action_t application_function_gpio_status_set(string_t *src, string_t
 
 		if((trigger_io < 0) || (trigger_pin < 0))
 		{
-			if(!config_delete("trigger.status.io", false, -1, -1) ||
-					!config_delete("trigger.status.pin", false, -1, -1))
+			if(!config_delete(config_key_trigger_status_io, -1, -1) ||
+					!config_delete(config_key_trigger_status_pin, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "> cannot delete config (default values)\n");
@@ -1761,8 +1868,8 @@ static app_action_t application_function_gpio_status_set(string_t *src, string_t
 			}
 		}
 		else
-			if(!config_set_int("trigger.status.io", trigger_io, -1, -1) ||
-					!config_set_int("trigger.status.pin", trigger_pin, -1, -1))
+			if(!config_set_int(config_key_trigger_status_io, trigger_io, -1, -1) ||
+					!config_set_int(config_key_trigger_status_pin, trigger_pin, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "> cannot set config\n");
@@ -1776,10 +1883,10 @@ static app_action_t application_function_gpio_status_set(string_t *src, string_t
 		}
 	}
 
-	if(!config_get_int("trigger.status.io", &trigger_io, -1, -1))
+	if(!config_get_int(config_key_trigger_status_io, &trigger_io, -1, -1))
 		trigger_io = -1;
 
-	if(!config_get_int("trigger.status.pin", &trigger_pin, -1, -1))
+	if(!config_get_int(config_key_trigger_status_pin, &trigger_pin, -1, -1))
 		trigger_pin = -1;
 
 	string_format(dst, "status trigger at io %d/%d (-1 is disabled)\n",
@@ -1808,8 +1915,8 @@ static app_action_t application_function_gpio_assoc_set(string_t *src, string_t
 
 		if((trigger_io < 0) || (trigger_pin < 0))
 		{
-			if(!config_delete("trigger.assoc.io", false, -1, -1) ||
-					!config_delete("trigger.assoc.pin", false, -1, -1))
+			if(!config_delete(config_key_trigger_assoc_io, -1, -1) ||
+					!config_delete(config_key_trigger_assoc_pin, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "> cannot delete config (default values)\n");
@@ -1817,8 +1924,8 @@ static app_action_t application_function_gpio_assoc_set(string_t *src, string_t
 			}
 		}
 		else
-			if(!config_set_int("trigger.assoc.io", trigger_io, -1, -1) ||
-					!config_set_int("trigger.assoc.pin", trigger_pin, -1, -1))
+			if(!config_set_int(config_key_trigger_assoc_io, trigger_io, -1, -1) ||
+					!config_set_int(config_key_trigger_assoc_pin, trigger_pin, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "> cannot set config\n");
@@ -1832,10 +1939,10 @@ static app_action_t application_function_gpio_assoc_set(string_t *src, string_t
 		}
 	}
 
-	if(!config_get_int("trigger.assoc.io", &trigger_io, -1, -1))
+	if(!config_get_int(config_key_trigger_assoc_io, &trigger_io, -1, -1))
 		trigger_io = -1;
 
-	if(!config_get_int("trigger.assoc.pin", &trigger_pin, -1, -1))
+	if(!config_get_int(config_key_trigger_assoc_pin, &trigger_pin, -1, -1))
 		trigger_pin = -1;
 
 	string_format(dst, "wlan association trigger at io %d/%d (-1 is disabled)\n",
@@ -1932,9 +2039,14 @@ roflash static const char help_description_i2c_write_read[] =		"write data to i2
 roflash static const char help_description_spi_write_read[] =		"write data to spi and read back data";
 roflash static const char help_description_io_mode[] =				"config i/o pin";
 roflash static const char help_description_io_read[] =				"read from i/o pin";
+roflash static const char help_description_io_read_all[] =			"read all pins of all i/o's";
+roflash static const char help_description_io_events[] =			"show timestamped edges on counter pins, optionally only from sequence number [since <seq>]";
 roflash static const char help_description_io_trigger[] = 			"trigger i/o pin";
 roflash static const char help_description_trigger_remote[] = 		"remote trigger: <index> <ip>";
 roflash static const char help_description_io_write[] =				"write to i/o pin";
+roflash static const char help_description_io_ledpixel[] =			"set ledpixel strip pixels beyond the pins and show frame rate: [set <pixel> <value> ... | fill <pixel> <count> <value>]";
+roflash static const char help_description_io_fade[] =				"fade pwm pin to value in time: <io> <pin> <value> <ms> [linear|gamma]";
+roflash static const char help_description_io_write_multi[] =		"write to multiple pins, no rollback on error: <io> <pin> <value> [<io> <pin> <value> ...]";
 roflash static const char help_description_io_multiple[] =			"write to multiple pins from one I/O";
 roflash static const char help_description_io_set_flag[] =			"set i/o pin flag";
 roflash static const char help_description_pwm1_width[] =			"set pwm1 width";
@@ -1942,9 +2054,10 @@ roflash static const char help_description_io_clear_flag[] =		"clear i/o pin fla
 roflash static const char help_description_i2c_sensor_read[] =		"read from i2c sensor";
 roflash static const char help_description_i2c_sensor_calibrate[] =	"calibrate i2c sensor, use sensor factor offset";
 roflash static const char help_description_i2c_sensor_dump[] =		"dump all i2c sensors";
-roflash static const char help_description_log_display[] =			"display log";
+roflash static const char help_description_log_display[] =			"display log, optionally only from sequence number [since <seq>]";
 roflash static const char help_description_log_clear[] =			"display and clear the log";
 roflash static const char help_description_log_write[] =			"write to the log";
+roflash static const char help_description_log_binary[] =			"show the most recent deferred log entries in binary form (decode with logdecode.pl)";
 roflash static const char help_description_sntp_set[] =				"set sntp <ip addr> <timezone GMT+/-x>";
 roflash static const char help_description_time_set[] =				"set time base [h m (s)] or [unix timestamp tz_offset]";
 roflash static const char help_description_sequencer_add[] =		"add sequencer entry";
@@ -1959,6 +2072,7 @@ roflash static const char help_description_uart_stop[] =			"set uart stop bits [
 roflash static const char help_description_uart_parity[] =			"set uart parity [none/even/odd]";
 roflash static const char help_description_uart_loopback[] =		"set uart loopback mode [0/1]";
 roflash static const char help_description_uart_write[] =			"write text to uart";
+roflash static const char help_description_uart_frame[] =			"set uart frame detection gap in character times (0 = off) and timestamp prefix [0/1]";
 roflash static const char help_description_wlan_ap_config[] =		"configure access point mode wlan params, supply ssid, passwd and channel";
 roflash static const char help_description_wlan_client_config[] =	"configure client mode wlan params, supply ssid and passwd";
 roflash static const char help_description_wlan_mode[] =			"set wlan mode: client or ap";
@@ -1967,18 +2081,24 @@ roflash static const char help_description_config_query_string[] =	"query config
 roflash static const char help_description_config_query_int[] =		"query config int";
 roflash static const char help_description_config_set[] =			"set config entry";
 roflash static const char help_description_config_delete[] =		"delete config entry";
+roflash static const char help_description_config_commit[] =		"write uncommitted config changes to flash now";
 roflash static const char help_description_http_get[] =				"get access over http";
 roflash static const char help_description_i2c_sensor_init[] =		"(re-)init i2c sensor";
 roflash static const char help_description_flash_info[] =			"flash-info";
 roflash static const char help_description_flash_erase[] =			"flash-erase";
 roflash static const char help_description_flash_send[] =			"flash-send";
+roflash static const char help_description_flash_stream[] =			"flash-stream";
 roflash static const char help_description_flash_read[] =			"flash-read";
 roflash static const char help_description_flash_receive[] =		"flash-receive";
 roflash static const char help_description_flash_write[] =			"flash-write";
 roflash static const char help_description_flash_verify[] =			"flash-verify";
-roflash static const char help_description_flash_checksum[] =		"flash-checksum";
+roflash static const char help_description_flash_checksum[] =		"flash-checksum <address> <length> [sha1|crc32]";
+roflash static const char help_description_flash_checksum_start[] =	"start flash checksum in background <address> <length> [sha1|crc32]";
+roflash static const char help_description_flash_checksum_status[] =	"show progress and result of background flash checksum";
 roflash static const char help_description_flash_select[] =			"flash-select";
 roflash static const char help_description_flash_select_once[] =	"flash-select-once";
+roflash static const char help_description_flash_fetch[] =			"fetch image over http into slot <url> <slot> [permanent]";
+roflash static const char help_description_flash_fetch_status[] =	"show progress and result of flash-fetch";
 roflash static const char help_description_peek[] =					"peek at a memory address";
 roflash static const char help_description_poke[] =					"poke to a memory address";
 
@@ -2154,6 +2274,16 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_io_read,
 		help_description_io_read,
 	},
+	{
+		"ira", "io-read-all",
+		application_function_io_read_all,
+		help_description_io_read_all,
+	},
+	{
+		"ie", "io-events",
+		application_function_io_events,
+		help_description_io_events,
+	},
 	{
 		"it", "io-trigger",
 		application_function_io_trigger,
@@ -2169,6 +2299,21 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_io_write,
 		help_description_io_write,
 	},
+	{
+		"iwm", "io-write-multi",
+		application_function_io_write_multi,
+		help_description_io_write_multi,
+	},
+	{
+		"if", "io-fade",
+		application_function_io_fade,
+		help_description_io_fade,
+	},
+	{
+		"ilp", "io-ledpixel",
+		application_function_io_ledpixel,
+		help_description_io_ledpixel,
+	},
 	{
 		"ism", "io-set-mask",
 		application_function_io_set_mask,
@@ -2214,6 +2359,11 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_log_clear,
 		help_description_log_clear,
 	},
+	{
+		"lb", "log-binary",
+		application_function_log_binary,
+		help_description_log_binary,
+	},
 	{
 		"lw", "log-write",
 		application_function_log_write,
@@ -2284,6 +2434,11 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_uart_loopback,
 		help_description_uart_loopback,
 	},
+	{
+		"uf", "uart-frame",
+		application_function_uart_frame,
+		help_description_uart_frame,
+	},
 	{
 		"uw", "uart-write",
 		application_function_uart_write,
@@ -2329,6 +2484,11 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_config_delete,
 		help_description_config_delete,
 	},
+	{
+		"cc", "config-commit",
+		application_function_config_commit,
+		help_description_config_commit,
+	},
 	{
 		"GET", "http-get",
 		application_function_http_get,
@@ -2354,6 +2514,11 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_flash_send,
 		help_description_flash_send,
 	},
+	{
+		"flash-stream", "flash-stream",
+		application_function_flash_stream,
+		help_description_flash_stream,
+	},
 	{
 		"flash-read", "flash-read",
 		application_function_flash_read,
@@ -2379,6 +2544,16 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_flash_checksum,
 		help_description_flash_checksum,
 	},
+	{
+		"flash-checksum-start", "flash-checksum-start",
+		application_function_flash_checksum_start,
+		help_description_flash_checksum_start,
+	},
+	{
+		"flash-checksum-status", "flash-checksum-status",
+		application_function_flash_checksum_status,
+		help_description_flash_checksum_status,
+	},
 	{
 		"flash-select", "flash-select",
 		application_function_flash_select,
@@ -2389,6 +2564,16 @@ roflash static const application_function_table_t application_function_table[] =
 		application_function_flash_select_once,
 		help_description_flash_select_once,
 	},
+	{
+		"flash-fetch", "flash-fetch",
+		application_function_flash_fetch,
+		help_description_flash_fetch,
+	},
+	{
+		"flash-fetch-status", "flash-fetch-status",
+		application_function_flash_fetch_status,
+		help_description_flash_fetch_status,
+	},
 	{
 		"pe", "peek",
 		application_function_peek,
@@ -0,0 +1,258 @@
+// host benchmark for the config sector lookups, compares scanning the sector text (as config_get_* did)
+// against the hash index that is built once per sector load, the key and index code is config_index.h, the same
+// config.c uses; the scan is kept here as the reference, the firmware doesn't have it anymore
+// usage: bench-config [iterations]
+
+#include "config_keys.h"
+#include "config_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+enum
+{
+	sector_size = 4096,
+};
+
+static const char magic[] = "%4afc0002%";
+
+typedef struct
+{
+	const char		*pattern;
+	unsigned int	params;
+} key_info_t;
+
+static const key_info_t key_info[] =
+{
+#define config_key_entry(id, pattern, params) { pattern, params },
+	CONFIG_KEYS(config_key_entry)
+#undef config_key_entry
+};
+
+enum
+{
+	key_size = sizeof(key_info) / sizeof(*key_info),
+};
+
+typedef struct
+{
+	uint32_t		key;
+	char			name[48];
+	unsigned int	offset;
+} probe_t;
+
+static char sector[sector_size];
+static unsigned int sector_length;
+static config_index_t index_table;
+static probe_t probes[sector_size / config_index_min_entry_length];
+static unsigned int probes_size;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return(((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+static uint32_t key_encode(unsigned int id, int param1, int param2)
+{
+	return(config_key_make(id, key_info[id].params, param1, param2));
+}
+
+static void key_format(uint32_t key, char *name, unsigned int size)
+{
+	unsigned int param1 = (key >> 12) & config_key_param_none;
+	unsigned int param2 = (key >> 0) & config_key_param_none;
+
+	// the patterns come from the firmware, they only contain %u conversions
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+	snprintf(name, size, key_info[key >> 24].pattern, param1, param2);
+#pragma GCC diagnostic pop
+}
+
+// config_key_parse, the pattern is used from the table directly instead of through flash_to_dram
+
+static uint32_t key_parse(const char *name, unsigned int length)
+{
+	unsigned int id;
+	uint32_t key;
+
+	for(id = 0; id < key_size; id++)
+		if((key = config_key_match(id, key_info[id].pattern, key_info[id].params, name, length)) != config_key_invalid)
+			return(key);
+
+	return(config_key_invalid);
+}
+
+static bool index_build(void)
+{
+	unsigned int name_start, value_start;
+	const char *separator, *newline;
+	uint32_t key;
+
+	memset(&index_table, 0, sizeof(index_table));
+
+	for(name_start = sizeof(magic); name_start < sector_length; name_start = (newline - sector) + 1)
+	{
+		if(!(separator = memchr(sector + name_start, '=', sector_length - name_start)))
+			break;
+
+		value_start = (separator - sector) + 1;
+
+		if(!(newline = memchr(sector + value_start, '\n', sector_length - value_start)))
+			break;
+
+		if((key = key_parse(sector + name_start, value_start - name_start - 1)) == config_key_invalid)
+			continue;
+
+		if(!config_index_insert(&index_table, key, value_start))
+			return(false);
+	}
+
+	return(true);
+}
+
+// the lookup as it was: format the name, then compare it against every name in the sector
+
+static int scan_lookup(uint32_t key)
+{
+	char name[48];
+	unsigned int name_start, name_length, length;
+	const char *separator, *newline;
+
+	key_format(key, name, sizeof(name));
+	length = strlen(name);
+
+	for(name_start = sizeof(magic); name_start < sector_length; name_start = (newline - sector) + 1)
+	{
+		if(!(separator = memchr(sector + name_start, '=', sector_length - name_start)))
+			break;
+
+		if(!(newline = memchr(separator, '\n', sector_length - (separator - sector))))
+			break;
+
+		name_length = separator - (sector + name_start);
+
+		if((name_length == length) && !memcmp(sector + name_start, name, length))
+			return((separator - sector) + 1);
+	}
+
+	return(-1);
+}
+
+static bool sector_append(uint32_t key, const char *value)
+{
+	char name[48];
+	int length;
+
+	key_format(key, name, sizeof(name));
+	length = snprintf(sector + sector_length, sizeof(sector) - sector_length, "%s=%s\n", name, value);
+
+	if((length < 0) || ((sector_length + length) >= (sizeof(sector) - 1)))
+	{
+		sector[sector_length] = '\0';
+		return(false);
+	}
+
+	probes[probes_size].key = key;
+	snprintf(probes[probes_size].name, sizeof(probes[probes_size].name), "%s", name);
+	probes[probes_size].offset = sector_length + strlen(name) + 1;
+	probes_size++;
+	sector_length += length;
+
+	return(true);
+}
+
+// an io heavy configuration: every key without indices once, then mode and flags for every pin of every
+// io, then shortest possible entries until the sector is full, which is the worst case for the index
+
+static void sector_fill(void)
+{
+	unsigned int id, io, pin;
+
+	sector_length = snprintf(sector, sizeof(sector), "%s\n\n", magic) - 1;
+
+	for(id = 0; id < key_size; id++)
+		if(key_info[id].params == 0)
+			sector_append(key_encode(id, -1, -1), "1");
+
+	for(id = 0; id < key_size; id++)
+		if(!strcmp(key_info[id].pattern, "io.%u.%u.mode"))
+			break;
+
+	for(io = 0; io < 7; io++)
+		for(pin = 0; pin < 16; pin++)
+			if(!sector_append(key_encode(id, io, pin), "2") || !sector_append(key_encode(id + 1, io, pin), "0"))
+				return;
+
+	for(io = 7; io < 10; io++)
+		for(pin = 0; pin < 10; pin++)
+			if(!sector_append(key_encode(id, io, pin), "0"))
+				return;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int iterations, iteration, probe, errors;
+	uint64_t start, build_ns, scan_ns, index_ns;
+	volatile int sink = 0;
+
+	iterations = (argc > 1) ? (unsigned int)strtoul(argv[1], (char **)0, 0) : 1000;
+
+	if(iterations == 0)
+		iterations = 1;
+
+	sector_fill();
+
+	start = now_ns();
+
+	for(iteration = 0; iteration < iterations; iteration++)
+		if(!index_build())
+		{
+			fprintf(stderr, "index overflow at %u entries\n", index_table.entries);
+			return(1);
+		}
+
+	build_ns = (now_ns() - start) / iterations;
+
+	for(probe = 0, errors = 0; probe < probes_size; probe++)
+		if((scan_lookup(probes[probe].key) != (int)probes[probe].offset) || (config_index_find(&index_table, probes[probe].key) != (int)probes[probe].offset))
+		{
+			fprintf(stderr, "lookup mismatch for %s\n", probes[probe].name);
+			errors++;
+		}
+
+	start = now_ns();
+
+	for(iteration = 0; iteration < iterations; iteration++)
+		for(probe = 0; probe < probes_size; probe++)
+			sink += scan_lookup(probes[probe].key);
+
+	scan_ns = now_ns() - start;
+
+	start = now_ns();
+
+	for(iteration = 0; iteration < iterations; iteration++)
+		for(probe = 0; probe < probes_size; probe++)
+			sink += config_index_find(&index_table, probes[probe].key);
+
+	index_ns = now_ns() - start;
+
+	printf("sector: %u bytes, %u entries, index: %u slots, %u used (%u%%), max %u\n",
+			sector_length, probes_size, (unsigned int)config_index_size, index_table.entries,
+			(index_table.entries * 100) / config_index_size, (unsigned int)config_index_max_entries);
+	printf("index build (once per sector load): %llu ns\n", (unsigned long long)build_ns);
+	printf("lookup, sector scan: %llu ns average\n", (unsigned long long)(scan_ns / ((uint64_t)iterations * probes_size)));
+	printf("lookup, hash index:  %llu ns average\n", (unsigned long long)(index_ns / ((uint64_t)iterations * probes_size)));
+	printf("lookup mismatches: %u\n", errors);
+
+	return(errors ? 1 : 0);
+}
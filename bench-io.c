@@ -0,0 +1,270 @@
+// host benchmark for the io pin config and data layouts, compares the packed bitfield structs (as they were)
+// against the layouts from io_pin.h that the firmware uses now, with the fast tick timer step and a mode scan
+// over all pins of all io's; the aligned side runs the firmware's own io_pin_timer_step, the packed side a copy
+// of the same step on the old layout; the cold per-mode part of the old layout only stands in for its size
+// note: x86 handles the unaligned and bitfield accesses in hardware at little cost, on the xtensa core every
+// unaligned field is assembled from byte loads and every bitfield needs extra shift and mask instructions,
+// so the difference on the device is larger than shown here
+// usage: bench-io [iterations]
+
+#include "io_pin.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+enum
+{
+	cold_size = 5,
+};
+
+// the layouts before the split
+
+typedef struct attr_packed
+{
+	unsigned int	saved_value;
+	unsigned int	speed:22;
+	io_direction_t	direction:2;
+} packed_data_pin_t;
+
+typedef struct attr_packed
+{
+	unsigned int	mode:5;
+	unsigned int	llmode:4;
+	unsigned int	flags:11;
+	io_direction_t	direction:2;
+	unsigned int	speed:18;
+	uint8_t			cold[cold_size];
+} packed_config_pin_t;
+
+assert_size(packed_data_pin_t, 7);
+assert_size(packed_config_pin_t, 10);
+
+// the data struct is preceded by the detected flag word, which is what misaligns the packed pin entries
+
+typedef struct
+{
+	unsigned int		detected:1;
+	packed_data_pin_t	pin[max_pins_per_io];
+} packed_data_t;
+
+static packed_config_pin_t packed_config[io_id_size][max_pins_per_io];
+static packed_data_t packed_data[io_id_size];
+static io_config_pin_entry_t aligned_config[io_id_size][max_pins_per_io];
+static io_data_t aligned_data;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return(((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+// io_pin_timer_step as it was on the packed layout
+
+static int packed_timer_step(packed_data_pin_t *pin_data, const packed_config_pin_t *pin_config)
+{
+	int value;
+
+	if(pin_data->direction == io_dir_none)
+		return(-1);
+
+	if(pin_data->speed > ms_per_fast_tick)
+	{
+		pin_data->speed -= ms_per_fast_tick;
+		return(-1);
+	}
+
+	switch(pin_data->direction)
+	{
+		case(io_dir_up):
+		{
+			value = 1;
+			pin_data->direction = io_dir_down;
+			break;
+		}
+
+		case(io_dir_down):
+		{
+			value = 0;
+			pin_data->direction = io_dir_up;
+			break;
+		}
+
+		default:
+		{
+			value = -1;
+			break;
+		}
+	}
+
+	if(pin_config->flags & io_flag_repeat)
+		pin_data->speed = pin_config->speed;
+	else
+	{
+		pin_data->speed = 0;
+		pin_data->direction = io_dir_none;
+	}
+
+	return(value);
+}
+
+// the timer part of io_periodic_fast, run over every pin instead of the fast list so every entry is touched,
+// followed by the kind of scan io_gpio does to find its pwm pins; returns the amount of pins that were written
+
+#define define_tick(name, config, data, step) \
+static unsigned int name(void) \
+{ \
+	unsigned int io, pin, writes = 0; \
+	int value; \
+	\
+	for(io = 0; io < io_id_size; io++) \
+	{ \
+		for(pin = 0; pin < max_pins_per_io; pin++) \
+		{ \
+			if(config[io][pin].mode != io_pin_timer) \
+				continue; \
+			\
+			if((value = step(&data[io].pin[pin], &config[io][pin])) < 0) \
+				continue; \
+			\
+			data[io].pin[pin].saved_value = (unsigned int)value; \
+			writes++; \
+		} \
+	} \
+	\
+	for(io = 0; io < io_id_size; io++) \
+		for(pin = 0; pin < max_pins_per_io; pin++) \
+			if(config[io][pin].llmode == io_pin_ll_output_pwm1) \
+				writes += config[io][pin].direction; \
+	\
+	return(writes); \
+}
+
+define_tick(packed_tick, packed_config, packed_data, packed_timer_step)
+define_tick(aligned_tick, aligned_config, aligned_data, io_pin_timer_step)
+
+// every pin a timer with a random period, about half of them repeating, and some pwm pins for the scan
+
+static void setup(void)
+{
+	unsigned int io, pin, speed, flags;
+
+	srand(1);
+
+	for(io = 0; io < io_id_size; io++)
+	{
+		packed_data[io].detected = aligned_data[io].detected = 1;
+
+		for(pin = 0; pin < max_pins_per_io; pin++)
+		{
+			speed = 10 + (rand() % 1000);
+			flags = (rand() & 0x01) ? io_flag_repeat : 0;
+
+			packed_config[io][pin].mode = aligned_config[io][pin].mode = io_pin_timer;
+			packed_config[io][pin].llmode = aligned_config[io][pin].llmode = (pin & 0x03) ? 0 : io_pin_ll_output_pwm1;
+			packed_config[io][pin].flags = aligned_config[io][pin].flags = flags;
+			packed_config[io][pin].direction = aligned_config[io][pin].direction = io_dir_up;
+			packed_config[io][pin].speed = aligned_config[io][pin].speed = speed;
+
+			packed_data[io].pin[pin].saved_value = aligned_data[io].pin[pin].saved_value = 0;
+			packed_data[io].pin[pin].speed = aligned_data[io].pin[pin].speed = speed;
+			packed_data[io].pin[pin].direction = aligned_data[io].pin[pin].direction = io_dir_up;
+		}
+	}
+}
+
+// rearm the pins that stopped, so the loop keeps doing work
+
+#define define_rearm(name, config, data) \
+static void name(void) \
+{ \
+	unsigned int io, pin; \
+	\
+	for(io = 0; io < io_id_size; io++) \
+		for(pin = 0; pin < max_pins_per_io; pin++) \
+			if(data[io].pin[pin].direction == io_dir_none) \
+			{ \
+				data[io].pin[pin].direction = io_dir_up; \
+				data[io].pin[pin].speed = config[io][pin].speed; \
+			} \
+}
+
+define_rearm(packed_rearm, packed_config, packed_data)
+define_rearm(aligned_rearm, aligned_config, aligned_data)
+
+int main(int argc, char **argv)
+{
+	unsigned int iterations, iteration, packed_toggles, aligned_toggles, pins, visits;
+	uint64_t start, packed_ns, aligned_ns;
+
+	iterations = (argc > 1) ? (unsigned int)strtoul(argv[1], (char **)0, 0) : 100000;
+
+	if(iterations == 0)
+		iterations = 1;
+
+	setup();
+
+	for(iteration = 0, packed_toggles = 0, aligned_toggles = 0; iteration < 1000; iteration++)
+	{
+		packed_toggles += packed_tick();
+		aligned_toggles += aligned_tick();
+
+		if((iteration % 100) == 99)
+		{
+			packed_rearm();
+			aligned_rearm();
+		}
+	}
+
+	if(packed_toggles != aligned_toggles)
+	{
+		fprintf(stderr, "layouts disagree: packed %u, aligned %u toggles\n", packed_toggles, aligned_toggles);
+		return(1);
+	}
+
+	start = now_ns();
+
+	for(iteration = 0, packed_toggles = 0; iteration < iterations; iteration++)
+	{
+		packed_toggles += packed_tick();
+
+		if((iteration % 100) == 99)
+			packed_rearm();
+	}
+
+	packed_ns = now_ns() - start;
+
+	start = now_ns();
+
+	for(iteration = 0, aligned_toggles = 0; iteration < iterations; iteration++)
+	{
+		aligned_toggles += aligned_tick();
+
+		if((iteration % 100) == 99)
+			aligned_rearm();
+	}
+
+	aligned_ns = now_ns() - start;
+
+	pins = io_id_size * max_pins_per_io;
+	visits = pins * 2;
+
+	printf("config pin: packed %u bytes, aligned %u bytes; data pin: packed %u bytes, aligned %u bytes\n",
+			(unsigned int)sizeof(packed_config_pin_t), (unsigned int)sizeof(io_config_pin_entry_t),
+			(unsigned int)sizeof(packed_data_pin_t), (unsigned int)sizeof(io_data_pin_entry_t));
+	printf("config table: packed %u bytes, aligned %u bytes; data table: packed %u bytes, aligned %u bytes\n",
+			(unsigned int)sizeof(packed_config), (unsigned int)sizeof(aligned_config),
+			(unsigned int)sizeof(packed_data), (unsigned int)sizeof(aligned_data));
+	printf("fast tick over %u pins, packed:  %llu ns per tick, %.2f ns per pin visit\n", pins,
+			(unsigned long long)(packed_ns / iterations), (double)packed_ns / ((double)iterations * visits));
+	printf("fast tick over %u pins, aligned: %llu ns per tick, %.2f ns per pin visit\n", pins,
+			(unsigned long long)(aligned_ns / iterations), (double)aligned_ns / ((double)iterations * visits));
+
+	return((packed_toggles == aligned_toggles) ? 0 : 1);
+}
@@ -0,0 +1,222 @@
+// host harness for the pwm1 phase tables, applies random duty changes to single pins the way io_gpio_set does
+// (move one pin in the sorted list) and checks every resulting table against a full rebuild from all pins (as pwm_go does),
+// then times both paths; the list and phase table code is io_gpio_pwm.h, the same the firmware uses, the isr, timer and phase set
+// switching around it in io_gpio.c is left out
+// usage: bench-pwm [iterations] [width]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+enum
+{
+	pin_size = 16,
+};
+
+typedef struct
+{
+	int				pwm_next;
+	unsigned int	pwm_duty;
+} pin_t;
+
+static pin_t pin_data[pin_size];
+
+#define pwm_pin(pin) (pin_data[pin])
+#include "io_gpio_pwm.h"
+
+enum
+{
+	max_channels = io_gpio_pwm_max_channels,
+};
+
+// the pwm capable gpio pins of an esp8266 module, the first max_channels are used
+
+static const int pwm_pins[max_channels] = { 4, 5, 12, 14 };
+
+static pwm_pins_t pwm_list;
+static unsigned int width;
+static bool extend;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return(((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+static unsigned int period(void)
+{
+	return(1U << width);
+}
+
+static bool pin_is_pwm(int pin)
+{
+	unsigned int channel;
+
+	for(channel = 0; channel < max_channels; channel++)
+		if(pwm_pins[channel] == pin)
+			return(true);
+
+	return(false);
+}
+
+// pwm_go
+
+static void full(pwm_phases_t *phase_data)
+{
+	int pin;
+
+	pwm_pins_reset(&pwm_list);
+
+	for(pin = 0; pin < pin_size; pin++)
+		if(pin_is_pwm(pin))
+			pwm_pins_place(&pwm_list, pin, period());
+
+	pwm_pins_build(&pwm_list, phase_data, period(), extend);
+}
+
+// pwm_reposition + pwm_commit
+
+static void incremental(int pin, pwm_phases_t *phase_data)
+{
+	pwm_pins_reposition(&pwm_list, pin, period());
+	pwm_pins_build(&pwm_list, phase_data, period(), extend);
+}
+
+// only compare the fields the isr reads
+
+static bool phases_equal(const pwm_phases_t *a, const pwm_phases_t *b)
+{
+	unsigned int phase;
+
+	if((a->amount_phases != b->amount_phases) ||
+			(a->static_pins_on_mask != b->static_pins_on_mask) ||
+			(a->static_pins_off_mask != b->static_pins_off_mask) ||
+			(a->active_pins_all_set_mask != b->active_pins_all_set_mask) ||
+			(a->active_pins_noduty1_set_mask != b->active_pins_noduty1_set_mask) ||
+			(a->active_pins_duty1_clear_mask != b->active_pins_duty1_clear_mask))
+		return(false);
+
+	for(phase = 0; phase < a->amount_phases; phase++)
+		if((a->phase[phase].phase_delay != b->phase[phase].phase_delay) ||
+				(a->phase[phase].phase_active_pins_clear_mask != b->phase[phase].phase_active_pins_clear_mask))
+			return(false);
+
+	return(true);
+}
+
+// mostly random values, with a fair share of the special cases: off, full on, 1 and duplicates of another pin
+
+static unsigned int random_duty(void)
+{
+	switch(rand() % 8)
+	{
+		case(0): return(0);
+		case(1): return(period() - 1);
+		case(2): return(1);
+		case(3): return(pin_data[pwm_pins[rand() % max_channels]].pwm_duty);
+		default: return((unsigned int)rand() % period());
+	}
+}
+
+int main(int argc, char **argv)
+{
+	pwm_phases_t incremental_phases, full_phases;
+	pin_t saved_pin_data[pin_size];
+	pwm_pins_t saved_list;
+	unsigned int iterations, iteration, errors;
+	unsigned int *duties;
+	int *pins;
+	uint64_t start, incremental_ns, full_ns;
+	volatile unsigned int sink = 0;
+
+	iterations = (argc > 1) ? (unsigned int)strtoul(argv[1], (char **)0, 0) : 1000000;
+	width = (argc > 2) ? (unsigned int)strtoul(argv[2], (char **)0, 0) : 16;
+
+	if(iterations == 0)
+		iterations = 1;
+
+	if((width < 4) || (width > 18))
+	{
+		fprintf(stderr, "width should be 4 - 18\n");
+		return(1);
+	}
+
+	if(!(duties = malloc(iterations * sizeof(*duties))) || !(pins = malloc(iterations * sizeof(*pins))))
+	{
+		fprintf(stderr, "out of memory\n");
+		return(1);
+	}
+
+	srand(1);
+
+	// correctness: after every single pin change the incremental table must equal a table built from scratch
+
+	for(errors = 0, iteration = 0; iteration < iterations; iteration++)
+	{
+		extend = (iteration & 0x100) != 0;
+		pins[iteration] = pwm_pins[rand() % max_channels];
+		duties[iteration] = random_duty();
+
+		if(iteration == 0)
+			full(&incremental_phases);
+
+		pin_data[pins[iteration]].pwm_duty = duties[iteration];
+		incremental(pins[iteration], &incremental_phases);
+
+		// the rebuild must not touch the list the incremental path keeps working on
+
+		memcpy(saved_pin_data, pin_data, sizeof(saved_pin_data));
+		saved_list = pwm_list;
+
+		full(&full_phases);
+
+		memcpy(pin_data, saved_pin_data, sizeof(pin_data));
+		pwm_list = saved_list;
+
+		if(!phases_equal(&incremental_phases, &full_phases))
+		{
+			if(errors++ < 8)
+				fprintf(stderr, "mismatch at change %u: pin %d duty %u\n", iteration, pins[iteration], duties[iteration]);
+		}
+	}
+
+	extend = false;
+
+	start = now_ns();
+
+	for(iteration = 0; iteration < iterations; iteration++)
+	{
+		pin_data[pins[iteration]].pwm_duty = duties[iteration];
+		incremental(pins[iteration], &incremental_phases);
+		sink += incremental_phases.amount_phases;
+	}
+
+	incremental_ns = now_ns() - start;
+
+	start = now_ns();
+
+	for(iteration = 0; iteration < iterations; iteration++)
+	{
+		pin_data[pins[iteration]].pwm_duty = duties[iteration];
+		full(&full_phases);
+		sink += full_phases.amount_phases;
+	}
+
+	full_ns = now_ns() - start;
+
+	printf("pwm1 width %u (period %u), %u channels, %u single pin duty changes\n", width, period(), (unsigned int)max_channels, iterations);
+	printf("update, full rebuild: %llu ns average\n", (unsigned long long)(full_ns / iterations));
+	printf("update, incremental:  %llu ns average\n", (unsigned long long)(incremental_ns / iterations));
+	printf("table mismatches: %u\n", errors);
+
+	free(duties);
+	free(pins);
+
+	return(errors ? 1 : 0);
+}
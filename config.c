@@ -1,4 +1,5 @@
 #include "config.h"
+#include "config_index.h"
 
 #include "util.h"
 #include "sys_string.h"
@@ -12,6 +13,7 @@
 #include <stdbool.h>
 
 #define CONFIG_MAGIC "%4afc0002%"
+#define CONFIG_HASH_INIT 2166136261UL // FNV-1a
 
 typedef struct
 {
@@ -19,45 +21,803 @@ typedef struct
 	attr_flash_align const char *name;
 } config_flag_name_t;
 
+// the config leases a sector buffer from the pool and keeps it as cache after reading, when the pool runs out,
+// the cache is given up (see config_buffer_reclaim) and the config is loaded from flash again on the next read
+
+typedef enum
+{
+	cb_free,
+	cb_read,
+	cb_write,
+	cb_write_dirty,
+	cb_cache,
+	cb_cache_dirty,
+} config_buffer_state_t;
+
+static string_t *config_buffer = (string_t *)0;
+static config_buffer_state_t config_buffer_state = cb_free;
+
 assert_size(config_flag_name_t, 8);
 
-roflash static const config_flag_name_t config_flag_names[] =
-{
-	{	flag_strip_telnet,			"strip-telnet",				},
-	{	flag_log_to_uart,			"log-to-uart",				},
-	{	flag_tsl_high_sens,			"tsl-high-sens",			},
-	{	flag_bh_high_sens,			"bh-high-sens",				},
-	{	flag_cpu_high_speed,		"cpu-high-speed",			},
-	{	flag_wlan_power_save,		"wlan-power-save",			},
-	{	flag_enable_eastrising,		"enable-eastrising",		},
-	{	flag_eastrising_fontchip,	"eastrising-use-fontchip",	},
-	{	flag_log_to_buffer,			"log-to-buffer",			},
-	{	flag_auto_sequencer,		"auto-sequencer",			},
-	{	flag_pwm1_extend,			"pwm1-extend",				},
-	{	flag_tmd_high_sens,			"tmd-high-sens",			},
-	{	flag_apds3_high_sens,		"apds3-high-sens",			},
-	{	flag_apds6_high_sens,		"apds6-high-sens",			},
-	{	flag_dummy2,				"dummy2",					},
-	{	flag_udp_term_empty,		"udp-term-empty",			},
-	{	flag_enable_orbital,		"enable-orbital",			},
-	{	flag_cmd_from_uart,			"cmd-from-uart",			},
-	{	flag_log_to_display,		"log-to-display",			},
-	{	flag_ssd_height_32,			"ssd-height-32",			},
-	{	flag_none,					"",							},
-};
+roflash static const config_flag_name_t config_flag_names[] =
+{
+	{	flag_strip_telnet,			"strip-telnet",				},
+	{	flag_log_to_uart,			"log-to-uart",				},
+	{	flag_tsl_high_sens,			"tsl-high-sens",			},
+	{	flag_bh_high_sens,			"bh-high-sens",				},
+	{	flag_cpu_high_speed,		"cpu-high-speed",			},
+	{	flag_wlan_power_save,		"wlan-power-save",			},
+	{	flag_enable_eastrising,		"enable-eastrising",		},
+	{	flag_eastrising_fontchip,	"eastrising-use-fontchip",	},
+	{	flag_log_to_buffer,			"log-to-buffer",			},
+	{	flag_auto_sequencer,		"auto-sequencer",			},
+	{	flag_pwm1_extend,			"pwm1-extend",				},
+	{	flag_tmd_high_sens,			"tmd-high-sens",			},
+	{	flag_apds3_high_sens,		"apds3-high-sens",			},
+	{	flag_apds6_high_sens,		"apds6-high-sens",			},
+	{	flag_log_deferred,			"log-deferred",				},
+	{	flag_udp_term_empty,		"udp-term-empty",			},
+	{	flag_enable_orbital,		"enable-orbital",			},
+	{	flag_cmd_from_uart,			"cmd-from-uart",			},
+	{	flag_log_to_display,		"log-to-display",			},
+	{	flag_ssd_height_32,			"ssd-height-32",			},
+	{	flag_none,					"",							},
+};
+
+unsigned int config_flags;
+
+static unsigned int config_current_index;
+
+typedef struct
+{
+	attr_flash_align const char *pattern;
+	attr_flash_align uint32_t params;
+} config_key_info_t;
+
+assert_size(config_key_info_t, 8);
+
+roflash static const config_key_info_t config_key_info[config_key_size] =
+{
+#define config_key_entry(id, pattern, params) { pattern, params },
+	CONFIG_KEYS(config_key_entry)
+#undef config_key_entry
+};
+
+// the binary key layout is in config_index.h
+
+attr_pure static uint32_t config_key_encode(unsigned int id, int param1, int param2)
+{
+	return(config_key_make(id, config_key_info[id].params, param1, param2));
+}
+
+static void config_key_decode(uint32_t key, string_t *name)
+{
+	int param1, param2;
+
+	param1 = (key >> 12) & config_key_param_none;
+	param2 = (key >> 0) & config_key_param_none;
+
+	string_clear(name);
+	string_format_flash_ptr(name, config_key_info[key >> 24].pattern,
+			(param1 == config_key_param_none) ? -1 : param1,
+			(param2 == config_key_param_none) ? -1 : param2);
+}
+
+// find the key id and indices for a name (that's stored as text in the config sector)
+
+static uint32_t config_key_parse(const string_t *name)
+{
+	char pattern[48];
+	unsigned int id;
+	uint32_t key;
+
+	for(id = 0; id < config_key_size; id++)
+	{
+		flash_to_dram(true, config_key_info[id].pattern, pattern, sizeof(pattern));
+
+		if((key = config_key_match(id, pattern, config_key_info[id].params, string_buffer(name), string_length(name))) != config_key_invalid)
+			return(key);
+	}
+
+	return(config_key_invalid);
+}
+
+// in-RAM hash index over the config sector in config_buffer, for O(1) lookups by binary key,
+// it's built whenever the sector is (re)loaded, which converts all names to keys, entries are added on set
+// and it's invalidated on delete, when it fills up, lookups fall back to scanning the sector
+
+// the shortest entry that can occur more than once is an indexed key with single digit indices and value,
+// like "io.0.0.mode=0\n", a sector can't hold more of them than this, the few shorter keys without
+// indices occur only once each, so the index is sized to never fill up, even with every io pin configured
+
+enum
+{
+	config_index_sector_entries = (SPI_FLASH_SEC_SIZE - sizeof(CONFIG_MAGIC)) / config_index_min_entry_length,
+};
+
+_Static_assert(config_index_sector_entries + config_key_size <= config_index_max_entries, "config index too small for a full sector");
+
+static config_index_t config_index;
+static bool config_index_valid = false;
+static bool config_index_stale = true;
+
+attr_pure static uint32_t config_hash_update(uint32_t hash, const void *data, unsigned int length)
+{
+	const uint8_t *byte = (const uint8_t *)data;
+
+	for(; length > 0; length--, byte++)
+	{
+		hash ^= *byte;
+		hash *= 16777619UL;
+	}
+
+	return(hash);
+}
+
+static void config_index_add(uint32_t key, unsigned int offset)
+{
+	if(!config_index_valid || (key == config_key_invalid))
+		return;
+
+	if(!config_index_insert(&config_index, key, offset))
+	{
+		stat_config_index_overflows++;
+		config_index_valid = false;
+	}
+}
+
+static void config_index_remove(unsigned int value_offset, unsigned int position, unsigned int length)
+{
+	if(config_index_valid)
+		config_index_erase(&config_index, value_offset, position, length);
+}
+
+static void config_index_clear(void)
+{
+	memset(&config_index, 0, sizeof(config_index));
+	config_index_valid = true;
+	config_index_stale = false;
+}
+
+// only needed for a config sector in text form, a config loaded from the log is indexed while it's replayed
+
+static void config_index_build(void)
+{
+	string_new(, name, 64);
+	int name_start_index, value_start_index, next_name_start_index;
+
+	stat_config_index_builds++;
+
+	config_index_clear();
+
+	name_start_index = sizeof(CONFIG_MAGIC); // magic + \n
+
+	while(config_index_valid &&
+			((value_start_index = string_sep(config_buffer, name_start_index, 1, '=')) > 0) &&
+			((next_name_start_index = string_sep(config_buffer, value_start_index, 1, '\n')) > 0))
+	{
+		string_splice(&name, 0, config_buffer, name_start_index, value_start_index - name_start_index - 1);
+		config_index_add(config_key_parse(&name), value_start_index);
+		name_start_index = next_name_start_index;
+	}
+}
+
+// config cache, see config.h, the generation is bumped on every change to the config image,
+// replaying the log when (re)loading the config reproduces the stored config and doesn't count as a change
+
+unsigned int config_cache_generation = 1;
+unsigned int config_cache_loaded_generation = 0;
+static config_cache_t *config_cache_list = (config_cache_t *)0;
+
+static void config_cache_store(uint32_t key, const string_t *value)
+{
+	config_cache_t *cache;
+	config_cache_slot_t *slot;
+	int param1, param2;
+	int int_value;
+	unsigned int uint_value;
+
+	param1 = (key >> 12) & config_key_param_none;
+	param2 = (key >> 0) & config_key_param_none;
+
+	if(param1 == config_key_param_none)
+		param1 = -1;
+
+	if(param2 == config_key_param_none)
+		param2 = -1;
+
+	for(cache = config_cache_list; cache; cache = cache->next)
+	{
+		if((unsigned int)cache->id != (key >> 24))
+			continue;
+
+		if(cache->is_unsigned)
+		{
+			if(parse_uint(0, value, &uint_value, 0, '\n') != parse_ok)
+				continue;
+
+			int_value = (int)uint_value;
+		}
+		else
+		{
+			if(parse_int(0, value, &int_value, 0, '\n') != parse_ok)
+				continue;
+		}
+
+		if(cache->entries >= cache->size)
+		{
+			if(!cache->overflow)
+				stat_config_cache_overflows++;
+
+			cache->overflow = 1;
+			continue;
+		}
+
+		slot = &cache->slots[cache->entries++];
+		slot->param1 = param1;
+		slot->param2 = param2;
+		slot->value = int_value;
+	}
+}
+
+void config_cache_reload(void)
+{
+	string_new(, name, 64);
+	string_new(, value, 64);
+	config_cache_t *cache;
+	unsigned int slot, generation;
+	int value_end_index;
+
+	// the config can't be read while the sector buffer is in use otherwise,
+	// keep the current values and try again on the next lookup
+
+	if((config_buffer_state != cb_free) && (config_buffer_state != cb_cache) && (config_buffer_state != cb_cache_dirty))
+		return;
+
+	if(!config_open_read())
+		return;
+
+	generation = config_cache_generation;
+
+	for(cache = config_cache_list; cache; cache = cache->next)
+	{
+		cache->entries = 0;
+		cache->overflow = 0;
+	}
+
+	if(config_index_valid)
+	{
+		for(slot = 0; slot < config_index_size; slot++)
+		{
+			if((config_index.offset[slot] == 0) ||
+					((value_end_index = string_sep(config_buffer, config_index.offset[slot], 1, '\n')) < 0))
+				continue;
+
+			string_splice(&value, 0, config_buffer, config_index.offset[slot], value_end_index - config_index.offset[slot] - 1);
+			config_cache_store(config_index.key[slot], &value);
+		}
+	}
+	else
+		while(config_walk(&name, &value))
+			config_cache_store(config_key_parse(&name), &value);
+
+	config_close_read();
+
+	config_cache_loaded_generation = generation;
+	stat_config_cache_reloads++;
+}
+
+void config_cache_register(config_cache_t *cache, config_cache_slot_t *slots, unsigned int size, config_key_t id, bool is_unsigned, int default_value)
+{
+	config_cache_t *current;
+
+	for(current = config_cache_list; current; current = current->next)
+		if(current == cache)
+			return;
+
+	cache->slots = slots;
+	cache->size = size;
+	cache->entries = 0;
+	cache->id = id;
+	cache->default_value = default_value;
+	cache->is_unsigned = is_unsigned ? 1 : 0;
+	cache->overflow = 0;
+	cache->next = config_cache_list;
+	config_cache_list = cache;
+
+	config_cache_loaded_generation = config_cache_generation - 1;
+	config_cache_reload();
+}
+
+int config_cache_fallback(const config_cache_t *cache, int param1, int param2)
+{
+	int int_value;
+	unsigned int uint_value;
+
+	if(cache->is_unsigned)
+		return(config_get_uint(cache->id, &uint_value, param1, param2) ? (int)uint_value : cache->default_value);
+
+	return(config_get_int(cache->id, &int_value, param1, param2) ? int_value : cache->default_value);
+}
+
+// wear levelled config store, used when the image has at least two log sectors (see Makefile)
+// the config image in config_buffer remains the working copy, the log is only used to persist it
+// each log sector starts with a header, the active sector is the valid one with the highest sequence number,
+// the header is followed by records, a set or delete record for each change and a commit record closing each
+// transaction, the commit record holds a hash over the records of the transaction, records not followed by a
+// valid commit are ignored; transactions are appended to the active sector, when it's full, or when it contains
+// garbage after an interrupted write, the whole config is written as snapshot into the next sector,
+// its header is written last, so the old sector remains valid until the snapshot is complete
+// set and delete records of known keys store the binary key instead of the name, names that don't match
+// a known key (and records written by older firmware) are stored as text
+
+enum
+{
+	config_log_sectors = USER_CONFIG_LOG_SECTORS,
+	config_log_magic = 0x474f4c43, // "CLOG"
+	config_log_journal_size = 512,
+	config_log_record_max = 256,
+};
+
+typedef enum
+{
+	config_log_record_set = 1,
+	config_log_record_delete,
+	config_log_record_commit,
+	config_log_record_set_key,		// payload is the binary key followed by the value
+	config_log_record_delete_key,	// payload is the binary key
+} config_log_record_type_t;
+
+typedef struct
+{
+	uint32_t	magic;
+	uint32_t	sequence;
+	uint32_t	sequence_inverted;
+	uint32_t	spare; // left erased
+} config_log_header_t;
+
+assert_size(config_log_header_t, 16);
+
+typedef struct
+{
+	uint8_t		type;
+	uint8_t		spare;
+	uint16_t	length; // length of the payload, the payload is padded to a multiple of 4 bytes
+} config_log_record_t;
+
+assert_size(config_log_record_t, 4);
+
+static uint32_t config_log_journal[config_log_journal_size / sizeof(uint32_t)];
+static unsigned int config_log_journal_length;
+static bool config_log_journal_overflow;
+static uint32_t config_log_buffer[1 + (config_log_record_max / sizeof(uint32_t)) + 1]; // record header + payload + terminating zero
+static int config_log_sector = -1;
+static uint32_t config_log_sequence;
+static unsigned int config_log_offset;
+static bool config_log_needs_compaction = true;
+
+// write-back: closing a write transaction only marks the config as pending, it's committed to flash
+// after config_commit_delay ms without further changes, on config-commit or before a reset, so
+// a series of changes results in one flash write; the journal holds all pending changes, an aborted
+// transaction is rolled back by reloading the config from flash and replaying the journal up to the
+// start of the transaction; a crash or power loss before the commit loses the pending changes only,
+// the config in flash is left intact
+
+enum
+{
+	config_commit_delay = 2000,
+};
+
+static bool config_pending = false;
+static unsigned int config_log_journal_mark;
+static os_timer_t config_commit_timer;
+
+static unsigned int config_delete_entry(const string_t *match_name, uint32_t key, bool wildcard, bool journal);
+static void config_set_entry(const string_t *name, uint32_t key, const char *value, bool journal);
+
+attr_const attr_inline unsigned int config_log_padded(unsigned int length)
+{
+	return((length + 3) & ~3U);
+}
+
+attr_const attr_inline uint32_t config_log_address(unsigned int sector, unsigned int offset)
+{
+	return(((USER_CONFIG_LOG_SECTOR + sector) * SPI_FLASH_SEC_SIZE) + offset);
+}
+
+static bool config_log_header_read(unsigned int sector, uint32_t *sequence)
+{
+	config_log_header_t header;
+
+	if(spi_flash_read(config_log_address(sector, 0), &header, sizeof(header)) != SPI_FLASH_RESULT_OK)
+		return(false);
+
+	if((header.magic != config_log_magic) || (header.sequence != ~header.sequence_inverted))
+		return(false);
+
+	*sequence = header.sequence;
+
+	return(true);
+}
+
+static bool config_log_find(void)
+{
+	int sector;
+	uint32_t sequence;
+
+	config_log_sector = -1;
+	config_log_sequence = 0;
+	config_log_offset = 0;
+	config_log_needs_compaction = true;
+
+	if(config_log_sectors < 2)
+		return(false);
+
+	for(sector = 0; sector < config_log_sectors; sector++)
+	{
+		if(!config_log_header_read(sector, &sequence))
+			continue;
+
+		if((config_log_sector < 0) || ((int32_t)(sequence - config_log_sequence) > 0))
+		{
+			config_log_sector = sector;
+			config_log_sequence = sequence;
+		}
+	}
+
+	return(config_log_sector >= 0);
+}
+
+static void config_log_apply(const config_log_record_t *record, char *payload)
+{
+	string_new(, key_name, 64);
+	string_t name;
+	int separator;
+	uint32_t key;
+
+	payload[record->length] = '\0';
+
+	switch(record->type)
+	{
+		case(config_log_record_set_key):
+		case(config_log_record_delete_key):
+		{
+			memcpy(&key, payload, sizeof(key));
+
+			if((key >> 24) >= config_key_size)
+				return;
+
+			config_key_decode(key, &key_name);
+
+			if(record->type == config_log_record_delete_key)
+				config_delete_entry(&key_name, key, false, false);
+			else
+				config_set_entry(&key_name, key, payload + sizeof(key), false);
+
+			return;
+		}
+
+		case(config_log_record_delete):
+		{
+			string_set(&name, payload, record->length + 1, record->length);
+			config_delete_entry(&name, config_key_invalid, false, false);
+			return;
+		}
+
+		default:
+		{
+			string_set(&name, payload, record->length + 1, record->length);
+
+			if((separator = string_find(&name, 0, '=')) < 0)
+				return;
+
+			// text records are written for unknown names only, but logs from older firmware may have them for known keys
+
+			string_setlength(&name, separator);
+			config_set_entry(&name, config_key_parse(&name), payload + separator + 1, false);
+			return;
+		}
+	}
+}
+
+// returns the offset after the last valid commit record or -1 on read errors
+// when replay_limit is non-zero, all records before that offset are applied to the config image
+
+static int config_log_scan(unsigned int sector, unsigned int replay_limit, bool *garbage)
+{
+	config_log_record_t *record = (config_log_record_t *)&config_log_buffer[0];
+	char *payload = (char *)&config_log_buffer[1];
+	unsigned int offset, committed, size;
+	uint32_t hash;
+
+	committed = sizeof(config_log_header_t);
+	hash = CONFIG_HASH_INIT;
+	size = 0;
+	*garbage = false;
+
+	for(offset = committed; (offset + sizeof(*record)) <= SPI_FLASH_SEC_SIZE; offset += sizeof(*record) + size)
+	{
+		if(spi_flash_read(config_log_address(sector, offset), record, sizeof(*record)) != SPI_FLASH_RESULT_OK)
+			return(-1);
+
+		if(config_log_buffer[0] == 0xffffffff)
+			break;
+
+		size = config_log_padded(record->length);
+
+		if((record->type < config_log_record_set) || (record->type > config_log_record_delete_key) ||
+				(record->length == 0) || (record->length > config_log_record_max) ||
+				((record->type == config_log_record_set_key) && (record->length < sizeof(uint32_t))) ||
+				((record->type == config_log_record_delete_key) && (record->length != sizeof(uint32_t))) ||
+				((offset + sizeof(*record) + size) > SPI_FLASH_SEC_SIZE))
+		{
+			*garbage = true;
+			break;
+		}
+
+		if(spi_flash_read(config_log_address(sector, offset + sizeof(*record)), payload, size) != SPI_FLASH_RESULT_OK)
+			return(-1);
+
+		if(record->type == config_log_record_commit)
+		{
+			if((record->length != sizeof(uint32_t)) || (config_log_buffer[1] != hash))
+			{
+				*garbage = true;
+				break;
+			}
+
+			committed = offset + sizeof(*record) + size;
+			hash = CONFIG_HASH_INIT;
+			continue;
+		}
+
+		hash = config_hash_update(hash, config_log_buffer, sizeof(*record) + size);
+
+		if(offset < replay_limit)
+			config_log_apply(record, payload);
+	}
+
+	// uncommitted records, the next transaction can't be appended behind them
+
+	if(offset != committed)
+		*garbage = true;
+
+	return(committed);
+}
+
+static bool config_log_load(void)
+{
+	int committed;
+	bool garbage;
+
+	if((committed = config_log_scan(config_log_sector, 0, &garbage)) < 0)
+		return(false);
+
+	string_clear(config_buffer);
+	string_format(config_buffer, "%s\n\n", CONFIG_MAGIC);
+	config_index_clear();
+
+	if(config_log_scan(config_log_sector, committed, &garbage) < 0)
+		return(false);
+
+	config_log_offset = committed;
+	config_log_needs_compaction = garbage;
+	stat_config_log_replays++;
+
+	return(true);
+}
+
+// build a set or delete record at buffer, a binary key record if the name is a known key,
+// a text record otherwise, returns the size of the record including the padding or 0 if it doesn't fit
+
+static unsigned int config_log_record_build(uint32_t *buffer, unsigned int size, bool set,
+		const string_t *name, uint32_t key, const char *value, unsigned int value_length)
+{
+	config_log_record_t *record = (config_log_record_t *)&buffer[0];
+	uint8_t *payload = (uint8_t *)&buffer[1];
+	unsigned int name_length, length;
+
+	if(key != config_key_invalid)
+		name_length = sizeof(key);
+	else
+		name_length = string_length(name) + (set ? 1 : 0);
+
+	length = name_length + (set ? value_length : 0);
+
+	if((length > config_log_record_max) || ((sizeof(*record) + config_log_padded(length)) > size))
+		return(0);
+
+	if(key != config_key_invalid)
+	{
+		record->type = set ? config_log_record_set_key : config_log_record_delete_key;
+		memcpy(payload, &key, sizeof(key));
+	}
+	else
+	{
+		record->type = set ? config_log_record_set : config_log_record_delete;
+		memcpy(payload, string_buffer(name), string_length(name));
+
+		if(set)
+			payload[name_length - 1] = '=';
+	}
+
+	record->spare = 0;
+	record->length = length;
+
+	if(set)
+		memcpy(payload + name_length, value, value_length);
+
+	memset(payload + length, 0, config_log_padded(length) - length);
+
+	return(sizeof(*record) + config_log_padded(length));
+}
+
+static void config_log_journal_add(bool set, const string_t *name, uint32_t key, const char *value)
+{
+	unsigned int size, length;
+
+	// always leave room for the commit record
+
+	length = 0;
+
+	if((config_log_journal_length + sizeof(config_log_record_t) + sizeof(uint32_t)) <= sizeof(config_log_journal))
+	{
+		size = sizeof(config_log_journal) - config_log_journal_length - sizeof(config_log_record_t) - sizeof(uint32_t);
+		length = config_log_record_build(&config_log_journal[config_log_journal_length / sizeof(uint32_t)], size,
+				set, name, key, value, value ? strlen(value) : 0);
+	}
+
+	if(length == 0)
+	{
+		config_log_journal_overflow = true;
+		return;
+	}
+
+	config_log_journal_length += length;
+}
+
+static bool config_log_append(void)
+{
+	config_log_record_t *record;
+	unsigned int length;
+	bool garbage;
+
+	record = (config_log_record_t *)&config_log_journal[config_log_journal_length / sizeof(uint32_t)];
+	record->type = config_log_record_commit;
+	record->spare = 0;
+	record->length = sizeof(uint32_t);
+	config_log_journal[(config_log_journal_length / sizeof(uint32_t)) + 1] = config_hash_update(CONFIG_HASH_INIT, config_log_journal, config_log_journal_length);
+	length = config_log_journal_length + sizeof(*record) + sizeof(uint32_t);
+
+	if(spi_flash_write(config_log_address(config_log_sector, config_log_offset), config_log_journal, length) != SPI_FLASH_RESULT_OK)
+	{
+		log("config log: append failed, write failed\n");
+		config_log_needs_compaction = true;
+		return(false);
+	}
+
+	if((config_log_scan(config_log_sector, 0, &garbage) != (int)(config_log_offset + length)) || garbage)
+	{
+		log("config log: append failed, verify failed\n");
+		config_log_needs_compaction = true;
+		return(false);
+	}
+
+	config_log_offset += length;
+	stat_config_log_appends++;
+
+	return(true);
+}
+
+static bool config_log_compact(void)
+{
+	string_new(, name, 64);
+	config_log_record_t *record = (config_log_record_t *)&config_log_buffer[0];
+	config_log_header_t header;
+	unsigned int offset, length, size;
+	int sector, name_start_index, value_start_index, next_name_start_index;
+	uint32_t hash, sequence;
+	bool garbage;
+
+	sector = config_log_sector + 1;
+
+	if(sector >= config_log_sectors)
+		sector = 0;
+
+	if(spi_flash_erase_sector(USER_CONFIG_LOG_SECTOR + sector) != SPI_FLASH_RESULT_OK)
+	{
+		log("config log: compact failed, erase failed\n");
+		return(false);
+	}
+
+	offset = sizeof(header);
+	hash = CONFIG_HASH_INIT;
+
+	for(name_start_index = sizeof(CONFIG_MAGIC);
+			(next_name_start_index = string_sep(config_buffer, name_start_index, 1, '\n')) > 0;
+			name_start_index = next_name_start_index)
+	{
+		if(next_name_start_index == (name_start_index + 1)) // \n\n = end of config
+			break;
+
+		if(((value_start_index = string_sep(config_buffer, name_start_index, 1, '=')) < 0) ||
+				(value_start_index >= next_name_start_index))
+			continue;
+
+		string_splice(&name, 0, config_buffer, name_start_index, value_start_index - name_start_index - 1);
+		length = next_name_start_index - value_start_index - 1;
+
+		if(((size = config_log_record_build(config_log_buffer, sizeof(config_log_buffer) - sizeof(uint32_t), true, &name, config_key_parse(&name),
+						string_buffer(config_buffer) + value_start_index, length)) == 0) ||
+				((offset + size + sizeof(*record) + sizeof(uint32_t)) > SPI_FLASH_SEC_SIZE))
+		{
+			log("config log: compact failed, config too large\n");
+			return(false);
+		}
+
+		if(spi_flash_write(config_log_address(sector, offset), config_log_buffer, size) != SPI_FLASH_RESULT_OK)
+			goto write_error;
+
+		hash = config_hash_update(hash, config_log_buffer, size);
+		offset += size;
+	}
+
+	record->type = config_log_record_commit;
+	record->spare = 0;
+	record->length = sizeof(uint32_t);
+	config_log_buffer[1] = hash;
+
+	if(spi_flash_write(config_log_address(sector, offset), config_log_buffer, sizeof(*record) + sizeof(uint32_t)) != SPI_FLASH_RESULT_OK)
+		goto write_error;
+
+	offset += sizeof(*record) + sizeof(uint32_t);
+
+	header.magic = config_log_magic;
+	header.sequence = config_log_sequence + 1;
+	header.sequence_inverted = ~header.sequence;
+	header.spare = 0xffffffff;
+
+	if(spi_flash_write(config_log_address(sector, 0), &header, sizeof(header)) != SPI_FLASH_RESULT_OK)
+		goto write_error;
+
+	if(!config_log_header_read(sector, &sequence) || (sequence != header.sequence) ||
+			(config_log_scan(sector, 0, &garbage) != (int)offset) || garbage)
+	{
+		log("config log: compact failed, verify failed\n");
+		return(false);
+	}
+
+	config_log_sector = sector;
+	config_log_sequence = sequence;
+	config_log_offset = offset;
+	config_log_needs_compaction = false;
+	stat_config_log_compactions++;
 
-unsigned int config_flags;
+	return(true);
 
-static unsigned int config_current_index;
+write_error:
+	log("config log: compact failed, write failed\n");
+	return(false);
+}
+
+static bool config_log_commit(void)
+{
+	if(!config_log_needs_compaction && !config_log_journal_overflow && (config_log_sector >= 0) &&
+			((config_log_offset + config_log_journal_length + sizeof(config_log_record_t) + sizeof(uint32_t)) <= SPI_FLASH_SEC_SIZE) &&
+			config_log_append())
+		return(true);
+
+	return(config_log_compact());
+}
 
 static int config_tail(void)
 {
 	int current, c[2];
 
-	for(current = sizeof(CONFIG_MAGIC) - 1; (current + 1) < string_size(&flash_sector_buffer); current++)
+	for(current = sizeof(CONFIG_MAGIC) - 1; (current + 1) < string_size(config_buffer); current++)
 	{
-		c[0] = string_at(&flash_sector_buffer, current + 0);
-		c[1] = string_at(&flash_sector_buffer, current + 1);
+		c[0] = string_at(config_buffer, current + 0);
+		c[1] = string_at(config_buffer, current + 1);
 
 		if(c[0] == '\0')
 		{
@@ -75,13 +835,50 @@ static int config_tail(void)
 	return(current);
 }
 
+static void config_commit_timer_callback(void *arg)
+{
+	dispatch_post_task(2, task_config_commit, 0);
+}
+
 bool config_init(void)
 {
+	os_timer_setfn(&config_commit_timer, config_commit_timer_callback, (void *)0);
+
 	config_flags = flag_log_to_uart | flag_log_to_buffer | flag_cmd_from_uart;
 
-	if(!config_get_uint("flags", &config_flags, -1, -1))
+	if(!config_get_uint(config_key_flags, &config_flags, -1, -1))
+		return(false);
+
+	return(true);
+}
+
+// the index refers to the contents of the buffer, so it goes with it
+
+static void config_buffer_free(void)
+{
+	if(config_buffer)
+		flash_buffer_release(config_buffer);
+
+	config_buffer = (string_t *)0;
+	config_buffer_state = cb_free;
+	config_index_valid = false;
+	config_index_stale = true;
+}
+
+// called from the buffer pool when it has run out, pending changes are committed first,
+// returns false if the config can't give up its buffer now
+
+bool config_buffer_reclaim(void)
+{
+	if((config_buffer_state == cb_cache_dirty) && !config_commit())
 		return(false);
 
+	if(config_buffer_state != cb_cache)
+		return(false);
+
+	config_buffer_free();
+	stat_config_buffer_reclaims++;
+
 	return(true);
 }
 
@@ -91,176 +888,294 @@ bool config_open_read(void)
 
 	stat_config_read_requests++;
 
-	if(flash_sector_buffer_use != fsb_config_cache)
+	if((config_buffer_state != cb_cache) && (config_buffer_state != cb_cache_dirty))
 	{
-		if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_display_picture))
+		if(config_buffer_state != cb_free)
 		{
-			logf("config_open_read: sector buffer in use: %u\n", flash_sector_buffer_use);
+			logf("config_open_read: sector buffer in use: %u\n", config_buffer_state);
 			return(false);
 		}
 
-		if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
+		if(!(config_buffer = flash_buffer_lease(fsb_config_cache)))
 		{
-			logf("config_open_read: sector buffer too small: %u\n", flash_sector_buffer_use);
+			log("config_open_read: no sector buffer available\n");
 			return(false);
 		}
 
-		flash_sector_buffer_use = fsb_config_read;
+		config_buffer_state = cb_read;
 
-		if(spi_flash_read(USER_CONFIG_SECTOR * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+		if(config_log_find())
 		{
-			logf("config_open_read: failed to read config sector 0x%x\n", (unsigned int)USER_CONFIG_SECTOR);
-			flash_sector_buffer_use = fsb_free;
-			return(false);
+			if(!config_log_load())
+			{
+				logf("config_open_read: failed to read config log sector 0x%x\n", (unsigned int)(USER_CONFIG_LOG_SECTOR + config_log_sector));
+				config_buffer_free();
+				return(false);
+			}
 		}
+		else
+		{
+			// no config log (yet), the first write will migrate the config sector to the log
 
-		string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
+			if(spi_flash_read(USER_CONFIG_SECTOR * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(config_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+			{
+				logf("config_open_read: failed to read config sector 0x%x\n", (unsigned int)USER_CONFIG_SECTOR);
+				config_buffer_free();
+				return(false);
+			}
+
+			string_setlength(config_buffer, SPI_FLASH_SEC_SIZE);
+			config_index_stale = true;
+		}
 
 		stat_config_read_loads++;
 	}
 
 	string_format(&magic_string, "%s\n", CONFIG_MAGIC);
 
-	if(!string_nmatch_string(&flash_sector_buffer, &magic_string, string_length(&magic_string)))
+	if(!string_nmatch_string(config_buffer, &magic_string, string_length(&magic_string)))
 	{
 		log("config_open_read: magic mismatch\n");
-		string_clear(&flash_sector_buffer);
-		string_append_string(&flash_sector_buffer, &magic_string);
-		string_append(&flash_sector_buffer, "\n"); // config sector should end at \n\n
+		string_clear(config_buffer);
+		string_append_string(config_buffer, &magic_string);
+		string_append(config_buffer, "\n"); // config sector should end at \n\n
+		config_index_stale = true;
 	}
 
+	if(config_index_stale)
+		config_index_build();
+
 	config_current_index = string_length(&magic_string);
-	flash_sector_buffer_use = fsb_config_read;
+	config_buffer_state = cb_read;
 
 	return(true);
 }
 
 bool config_close_read(void)
 {
-	if(flash_sector_buffer_use != fsb_config_read)
+	if(config_buffer_state != cb_read)
 	{
-		logf("config_close_read: sector buffer in use: %u\n", flash_sector_buffer_use);
+		logf("config_close_read: sector buffer in use: %u\n", config_buffer_state);
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_config_cache;
+	config_buffer_state = config_pending ? cb_cache_dirty : cb_cache;
 
 	return(true);
 }
 
 bool config_open_write(void)
 {
+	// make sure the journal holds all pending changes and has space left, so this transaction can be rolled back
+
+	if(config_pending && (config_log_journal_overflow || (config_log_journal_length > (sizeof(config_log_journal) / 2))) && !config_commit())
+		return(false);
+
 	if(!config_open_read())
 		return(false);
 
-	if(flash_sector_buffer_use != fsb_config_read)
+	if(config_buffer_state != cb_read)
 		return(false);
 
 	stat_config_write_requests++;
-	flash_sector_buffer_use = fsb_config_write;
+	config_buffer_state = cb_write;
+	config_log_journal_mark = config_log_journal_length;
 
 	return(true);
 }
 
-bool config_close_write(void)
+static bool config_sector_write(void)
 {
 	int tail;
+	unsigned int offset;
+	uint32_t verify[64];
 
 	SHA_CTX sha_context;
 	uint8_t sha_result1[SHA_DIGEST_LENGTH];
 	uint8_t sha_result2[SHA_DIGEST_LENGTH];
 
-	if(flash_sector_buffer_use == fsb_config_write_dirty)
-	{
-		stat_config_write_saved++;
+	tail = config_tail();
 
-		tail = config_tail();
+	memset(string_buffer_nonconst(config_buffer) + tail + 1, '.', string_size(config_buffer) - tail - 1);
 
-		memset(string_buffer_nonconst(&flash_sector_buffer) + tail + 1, '.', string_size(&flash_sector_buffer) - tail - 1);
+	SHA1Init(&sha_context);
+	SHA1Update(&sha_context, string_buffer(config_buffer), SPI_FLASH_SEC_SIZE);
+	SHA1Final(sha_result1, &sha_context);
 
-		SHA1Init(&sha_context);
-		SHA1Update(&sha_context, string_buffer(&flash_sector_buffer), SPI_FLASH_SEC_SIZE);
-		SHA1Final(sha_result1, &sha_context);
+	if(spi_flash_erase_sector(USER_CONFIG_SECTOR) != SPI_FLASH_RESULT_OK)
+	{
+		log("config close write: write failed, erase failed\n");
+		return(false);
+	}
 
-		if(spi_flash_erase_sector(USER_CONFIG_SECTOR) != SPI_FLASH_RESULT_OK)
-		{
-			log("config close write: write failed, erase failed\n");
-			goto error;
-		}
+	if(spi_flash_write(USER_CONFIG_SECTOR * SPI_FLASH_SEC_SIZE, string_buffer(config_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+	{
+		log("config close write: write failed, write failed\n");
+		return(false);
+	}
 
-		if(spi_flash_write(USER_CONFIG_SECTOR * SPI_FLASH_SEC_SIZE, string_buffer(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
-		{
-			log("config close write: write failed, write failed\n");
-			goto error;
-		}
+	// verify in chunks, the buffer must remain intact, it's needed for a retry when the write failed
 
-		if(spi_flash_read(USER_CONFIG_SECTOR * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+	SHA1Init(&sha_context);
+
+	for(offset = 0; offset < SPI_FLASH_SEC_SIZE; offset += sizeof(verify))
+	{
+		if(spi_flash_read((USER_CONFIG_SECTOR * SPI_FLASH_SEC_SIZE) + offset, verify, sizeof(verify)) != SPI_FLASH_RESULT_OK)
 		{
 			log("config close write: write failed, verify failed\n");
-			goto error;
+			return(false);
 		}
 
-		SHA1Init(&sha_context);
-		SHA1Update(&sha_context, string_buffer(&flash_sector_buffer), SPI_FLASH_SEC_SIZE);
-		SHA1Final(sha_result2, &sha_context);
+		SHA1Update(&sha_context, verify, sizeof(verify));
+	}
+
+	SHA1Final(sha_result2, &sha_context);
 
-		if(memcmp(sha_result1, sha_result2, SHA_DIGEST_LENGTH))
-		{
-			log("config close write: write failed, sha mismatch\n");
-			goto error;
-		}
+	if(memcmp(sha_result1, sha_result2, SHA_DIGEST_LENGTH))
+	{
+		log("config close write: write failed, sha mismatch\n");
+		return(false);
+	}
+
+	return(true);
+}
 
-		flash_sector_buffer_use = fsb_config_write;
+bool config_close_write(void)
+{
+	if(config_buffer_state == cb_write_dirty)
+	{
+		stat_config_write_deferred++;
+		config_pending = true;
+		os_timer_disarm(&config_commit_timer);
+		os_timer_arm(&config_commit_timer, config_commit_delay, false);
+		config_buffer_state = cb_write;
 	}
 
-	if(flash_sector_buffer_use != fsb_config_write)
+	if(config_buffer_state != cb_write)
 	{
-		logf("config_close_write: sector buffer in use: %u\n", flash_sector_buffer_use);
+		logf("config_close_write: sector buffer in use: %u\n", config_buffer_state);
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_config_cache;
+	config_buffer_state = config_pending ? cb_cache_dirty : cb_cache;
 	return(true);
+}
 
-error:
-	flash_sector_buffer_use = fsb_free;
-	return(false);
+bool config_commit(void)
+{
+	bool success;
+
+	if(!config_pending)
+		return(true);
+
+	if(config_buffer_state != cb_cache_dirty)
+	{
+		logf("config_commit: sector buffer in use: %u\n", config_buffer_state);
+		return(false);
+	}
+
+	os_timer_disarm(&config_commit_timer);
+	stat_config_write_saved++;
+
+	if(config_log_sectors > 1)
+		success = config_log_commit();
+	else
+		success = config_sector_write();
+
+	// a flash error may well be transient, keep the changes (dirty buffer and journal) and try again later
+
+	if(!success)
+	{
+		stat_config_write_failed++;
+		log("config_commit: write failed, retrying later\n");
+		os_timer_arm(&config_commit_timer, config_commit_delay, false);
+		return(false);
+	}
+
+	config_pending = false;
+	config_log_journal_length = 0;
+	config_log_journal_overflow = false;
+	config_buffer_state = cb_cache;
+
+	return(true);
+}
+
+bool config_commit_pending(void)
+{
+	return(config_pending);
+}
+
+static void config_rollback(void)
+{
+	config_log_record_t record;
+	unsigned int offset, size;
+
+	config_buffer_free();
+	config_cache_generation++;
+
+	if(config_pending && config_open_read())
+	{
+		for(offset = 0; offset < config_log_journal_mark; offset += sizeof(record) + size)
+		{
+			memcpy(&record, &config_log_journal[offset / sizeof(uint32_t)], sizeof(record));
+			size = config_log_padded(record.length);
+			memcpy(config_log_buffer, &config_log_journal[offset / sizeof(uint32_t)], sizeof(record) + size);
+			config_log_apply(&record, (char *)&config_log_buffer[1]);
+		}
+
+		config_log_journal_length = config_log_journal_mark;
+		config_log_journal_overflow = false;
+		config_close_read();
+		return;
+	}
+
+	if(config_pending)
+		log("config_abort_write: pending changes lost\n");
+
+	os_timer_disarm(&config_commit_timer);
+	config_pending = false;
+	config_log_journal_length = 0;
+	config_log_journal_overflow = false;
 }
 
 void config_abort_write(void)
 {
 	stat_config_write_aborted++;
 
-	if(flash_sector_buffer_use == fsb_config_write)
-		flash_sector_buffer_use = fsb_config_cache;
+	if(config_buffer_state == cb_write)
+	{
+		config_log_journal_length = config_log_journal_mark;
+		config_log_journal_overflow = false;
+		config_buffer_state = config_pending ? cb_cache_dirty : cb_cache;
+	}
 
-	if(flash_sector_buffer_use == fsb_config_write_dirty)
-		flash_sector_buffer_use = fsb_free;
+	if(config_buffer_state == cb_write_dirty)
+		config_rollback();
 }
 
 bool config_walk(string_t *id, string_t *value)
 {
 	int id_start_index, id_end_index, value_start_index, value_end_index;
 
-	if(flash_sector_buffer_use != fsb_config_read)
+	if(config_buffer_state != cb_read)
 	{
-		logf("config get entry: sector buffer in use: %u\n", flash_sector_buffer_use);
+		logf("config get entry: sector buffer in use: %u\n", config_buffer_state);
 		return(false);
 	}
 
-	if((id_start_index = config_current_index) > string_length(&flash_sector_buffer))
+	if((id_start_index = config_current_index) > string_length(config_buffer))
 	{
 		log("config get entry: sector length overrun\n");
 		return(false);
 	}
 
-	if(((value_start_index = string_sep(&flash_sector_buffer, id_start_index, 1, '=')) > 0) &&
-		((value_end_index = string_sep(&flash_sector_buffer, value_start_index, 1, '\n')) > 0))
+	if(((value_start_index = string_sep(config_buffer, id_start_index, 1, '=')) > 0) &&
+		((value_end_index = string_sep(config_buffer, value_start_index, 1, '\n')) > 0))
 	{
 		id_end_index = value_start_index - 1;
 
-		string_splice(id, 0, &flash_sector_buffer, id_start_index, id_end_index - id_start_index);
-		string_splice(value, 0, &flash_sector_buffer, value_start_index, value_end_index - value_start_index - 1);
+		string_splice(id, 0, config_buffer, id_start_index, id_end_index - id_start_index);
+		string_splice(value, 0, config_buffer, value_start_index, value_end_index - value_start_index - 1);
 
 		config_current_index = value_end_index;
 
@@ -270,20 +1185,42 @@ bool config_walk(string_t *id, string_t *value)
 	return(false);
 }
 
-bool config_get_string_flashptr(const char *match_name_flash, string_t *return_value, int param1, int param2)
+// look up by binary key using the index, fall back to scanning the sector by name if the index isn't usable
+
+static bool config_get_entry(uint32_t key, const string_t *match_name, string_t *return_value)
 {
-	string_new(, match_name, 64);
+	string_new(, key_name, 64);
 	string_new(, name, 64);
 	string_new(, value, 64);
+	int value_start_index, value_end_index;
 
 	if(!config_open_read())
 		return(false);
 
-	string_format_flash_ptr(&match_name, match_name_flash, param1, param2);
+	if(config_index_valid && (key != config_key_invalid))
+	{
+		if(((value_start_index = config_index_find(&config_index, key)) < 0) ||
+				((value_end_index = string_sep(config_buffer, value_start_index, 1, '\n')) < 0))
+		{
+			config_close_read();
+			return(false);
+		}
+
+		string_splice(&value, 0, config_buffer, value_start_index, value_end_index - value_start_index - 1);
+		string_append_string(return_value, &value);
+		config_close_read();
+		return(true);
+	}
+
+	if(!match_name)
+	{
+		config_key_decode(key, &key_name);
+		match_name = &key_name;
+	}
 
 	while(config_walk(&name, &value))
 	{
-		if(string_match_string(&match_name, &name))
+		if(string_match_string(match_name, &name))
 		{
 			string_append_string(return_value, &value);
 			config_close_read();
@@ -295,6 +1232,15 @@ bool config_get_string_flashptr(const char *match_name_flash, string_t *return_v
 	return(false);
 }
 
+bool config_get_string_flashptr(const char *match_name_flash, string_t *return_value, int param1, int param2)
+{
+	string_new(, match_name, 64);
+
+	string_format_flash_ptr(&match_name, match_name_flash, param1, param2);
+
+	return(config_get_entry(config_key_parse(&match_name), &match_name, return_value));
+}
+
 bool config_get_int_flashptr(const char *match_name_flash, int *return_value, int param1, int param2)
 {
 	string_new(, value, 16);
@@ -315,72 +1261,106 @@ bool config_get_uint_flashptr(const char *match_name_flash, unsigned int *return
 	return(parse_uint(0, &value, return_value, 0, '\n') == parse_ok);
 }
 
-unsigned int config_delete_flashptr(const char *match_name_flash, bool wildcard, int param1, int param2)
+// key is the binary key of match_name if it's known, a wildcard delete parses the name of every match
+
+static unsigned int config_delete_entry(const string_t *match_name, uint32_t key, bool wildcard, bool journal)
 {
 	string_new(, name, 64);
-	string_new(, match_name, 64);
 	unsigned int deleted;
 	int name_start_index, value_start_index, next_name_start_index;
-	char *flash_sector_buffer_buffer;
-
-	if((flash_sector_buffer_use != fsb_config_write) && (flash_sector_buffer_use != fsb_config_write_dirty))
-	{
-		logf("config delete: sector buffer in use: %u\n", flash_sector_buffer_use);
-		return(0);
-	}
+	char *config_buffer_buffer;
 
-	flash_sector_buffer_buffer = string_buffer_nonconst(&flash_sector_buffer);
-	string_format_flash_ptr(&match_name, match_name_flash, param1, param2);
+	config_buffer_buffer = string_buffer_nonconst(config_buffer);
 
 	deleted = 0;
-	name_start_index = config_current_index;
+	name_start_index = sizeof(CONFIG_MAGIC); // magic + \n
 
-	if(name_start_index > string_length(&flash_sector_buffer))
+	if(name_start_index > string_length(config_buffer))
 	{
 		log("config delete: sector length overrun\n");
 		return(0);
 	}
 
-	while(((value_start_index = string_sep(&flash_sector_buffer, name_start_index, 1, '=')) > 0) &&
-			((next_name_start_index = string_sep(&flash_sector_buffer, value_start_index, 1, '\n')) > 0))
+	while(((value_start_index = string_sep(config_buffer, name_start_index, 1, '=')) > 0) &&
+			((next_name_start_index = string_sep(config_buffer, value_start_index, 1, '\n')) > 0))
 	{
-		string_splice(&name, 0, &flash_sector_buffer, name_start_index, value_start_index - name_start_index - 1);
+		string_splice(&name, 0, config_buffer, name_start_index, value_start_index - name_start_index - 1);
 
-		if((!wildcard && string_match_string(&match_name, &name)) ||
-				(wildcard && string_nmatch_string(&match_name, &name, string_length(&match_name))))
+		if((!wildcard && string_match_string(match_name, &name)) ||
+				(wildcard && string_nmatch_string(match_name, &name, string_length(match_name))))
 		{
-			memmove(&flash_sector_buffer_buffer[name_start_index], &flash_sector_buffer_buffer[next_name_start_index], SPI_FLASH_SEC_SIZE - next_name_start_index);
+			memmove(&config_buffer_buffer[name_start_index], &config_buffer_buffer[next_name_start_index], SPI_FLASH_SEC_SIZE - next_name_start_index);
+			config_index_remove(value_start_index, name_start_index, next_name_start_index - name_start_index);
 			deleted++;
+
+			// wildcard deletes are journalled as separate deletes
+
+			if(journal)
+				config_log_journal_add(false, &name, wildcard ? config_key_parse(&name) : key, (const char *)0);
 		}
 		else
 			name_start_index = next_name_start_index;
 	}
 
-	if(deleted > 0)
-		flash_sector_buffer_use = fsb_config_write_dirty;
+	if(journal && (deleted > 0))
+		config_cache_generation++;
 
 	return(deleted);
 }
 
-bool config_set_string_flashptr(const char *match_name_flash, const char *value, int param1, int param2)
+static void config_set_entry(const string_t *name, uint32_t key, const char *value, bool journal)
 {
 	int current;
 
-	if((flash_sector_buffer_use != fsb_config_write) && (flash_sector_buffer_use != fsb_config_write_dirty))
+	config_delete_entry(name, key, false, false);
+
+	current = config_tail();
+
+	string_setlength(config_buffer, current);
+	string_append_string(config_buffer, name);
+	string_format(config_buffer, "=%s\n\n", value);
+	config_index_add(key, current + string_length(name) + 1);
+
+	if(journal)
 	{
-		logf("config set string: sector buffer in use: %u\n", flash_sector_buffer_use);
-		return(false);
+		config_log_journal_add(true, name, key, value);
+		config_cache_generation++;
 	}
+}
 
-	config_delete_flashptr(match_name_flash, false, param1, param2);
+unsigned int config_delete_flashptr(const char *match_name_flash, bool wildcard, int param1, int param2)
+{
+	string_new(, match_name, 64);
+	unsigned int deleted;
 
-	current = config_tail();
+	if((config_buffer_state != cb_write) && (config_buffer_state != cb_write_dirty))
+	{
+		logf("config delete: sector buffer in use: %u\n", config_buffer_state);
+		return(0);
+	}
+
+	string_format_flash_ptr(&match_name, match_name_flash, param1, param2);
+
+	if((deleted = config_delete_entry(&match_name, wildcard ? config_key_invalid : config_key_parse(&match_name), wildcard, true)) > 0)
+		config_buffer_state = cb_write_dirty;
+
+	return(deleted);
+}
+
+bool config_set_string_flashptr(const char *match_name_flash, const char *value, int param1, int param2)
+{
+	string_new(, name, 64);
+
+	if((config_buffer_state != cb_write) && (config_buffer_state != cb_write_dirty))
+	{
+		logf("config set string: sector buffer in use: %u\n", config_buffer_state);
+		return(false);
+	}
 
-	string_setlength(&flash_sector_buffer, current);
-	string_format_flash_ptr(&flash_sector_buffer, match_name_flash, param1, param2);
-	string_format(&flash_sector_buffer, "=%s\n\n", value);
+	string_format_flash_ptr(&name, match_name_flash, param1, param2);
+	config_set_entry(&name, config_key_parse(&name), value, true);
 
-	flash_sector_buffer_use = fsb_config_write_dirty;
+	config_buffer_state = cb_write_dirty;
 
 	return(true);
 }
@@ -389,9 +1369,9 @@ bool config_set_int_flashptr(const char *match_name_flash, int value, int param1
 {
 	string_new(, string_value, 16);
 
-	if((flash_sector_buffer_use != fsb_config_write) && (flash_sector_buffer_use != fsb_config_write_dirty))
+	if((config_buffer_state != cb_write) && (config_buffer_state != cb_write_dirty))
 	{
-		logf("config set int: sector buffer in use: %u\n", flash_sector_buffer_use);
+		logf("config set int: sector buffer in use: %u\n", config_buffer_state);
 		return(false);
 	}
 
@@ -404,9 +1384,9 @@ bool config_set_uint_flashptr(const char *match_name_flash, unsigned int value,
 {
 	string_new(, string_value, 16);
 
-	if((flash_sector_buffer_use != fsb_config_write) && (flash_sector_buffer_use != fsb_config_write_dirty))
+	if((config_buffer_state != cb_write) && (config_buffer_state != cb_write_dirty))
 	{
-		logf("config set uint: sector buffer in use: %u\n", flash_sector_buffer_use);
+		logf("config set uint: sector buffer in use: %u\n", config_buffer_state);
 		return(false);
 	}
 
@@ -415,6 +1395,99 @@ bool config_set_uint_flashptr(const char *match_name_flash, unsigned int value,
 	return(config_set_string_flashptr(match_name_flash, string_buffer(&string_value), param1, param2));
 }
 
+bool config_get_string(config_key_t id, string_t *return_value, int param1, int param2)
+{
+	return(config_get_entry(config_key_encode(id, param1, param2), (const string_t *)0, return_value));
+}
+
+bool config_get_int(config_key_t id, int *return_value, int param1, int param2)
+{
+	string_new(, value, 16);
+
+	if(!config_get_string(id, &value, param1, param2))
+		return(false);
+
+	return(parse_int(0, &value, return_value, 0, '\n') == parse_ok);
+}
+
+bool config_get_uint(config_key_t id, unsigned int *return_value, int param1, int param2)
+{
+	string_new(, value, 16);
+
+	if(!config_get_string(id, &value, param1, param2))
+		return(false);
+
+	return(parse_uint(0, &value, return_value, 0, '\n') == parse_ok);
+}
+
+// the key id variants have the binary key already, the name is only needed for the text in the sector
+
+unsigned int config_delete(config_key_t id, int param1, int param2)
+{
+	string_new(, name, 64);
+	unsigned int deleted;
+	uint32_t key;
+
+	if((config_buffer_state != cb_write) && (config_buffer_state != cb_write_dirty))
+	{
+		logf("config delete: sector buffer in use: %u\n", config_buffer_state);
+		return(0);
+	}
+
+	if((key = config_key_encode(id, param1, param2)) == config_key_invalid)
+		return(0);
+
+	config_key_decode(key, &name);
+
+	if((deleted = config_delete_entry(&name, key, false, true)) > 0)
+		config_buffer_state = cb_write_dirty;
+
+	return(deleted);
+}
+
+bool config_set_string(config_key_t id, const char *value, int param1, int param2)
+{
+	string_new(, name, 64);
+	uint32_t key;
+
+	if((config_buffer_state != cb_write) && (config_buffer_state != cb_write_dirty))
+	{
+		logf("config set string: sector buffer in use: %u\n", config_buffer_state);
+		return(false);
+	}
+
+	if((key = config_key_encode(id, param1, param2)) == config_key_invalid)
+	{
+		logf("config set string: invalid index %d/%d\n", param1, param2);
+		return(false);
+	}
+
+	config_key_decode(key, &name);
+	config_set_entry(&name, key, value, true);
+
+	config_buffer_state = cb_write_dirty;
+
+	return(true);
+}
+
+bool config_set_int(config_key_t id, int value, int param1, int param2)
+{
+	string_new(, string_value, 16);
+
+	string_format(&string_value, "%d", value);
+
+	return(config_set_string(id, string_buffer(&string_value), param1, param2));
+}
+
+bool config_set_uint(config_key_t id, unsigned int value, int param1, int param2)
+{
+	string_new(, string_value, 16);
+
+	string_format(&string_value, "%u", value);
+
+	return(config_set_string(id, string_buffer(&string_value), param1, param2));
+}
+
 bool config_dump(string_t *dst)
 {
 	int int_value, amount;
@@ -439,7 +1512,7 @@ bool config_dump(string_t *dst)
 		amount++;
 	}
 
-	string_format(dst, "\ntotal config entries: %d, flags: %04x\n", amount, config_flags);
+	string_format(dst, "\ntotal config entries: %d, flags: %04x, uncommitted changes: %s\n", amount, config_flags, yesno(config_pending));
 
 	return(config_close_read());
 }
@@ -457,7 +1530,7 @@ bool config_flag_change(unsigned int flag, bool set)
 	config_flag_change_nosave(flag, set);
 
 	if(config_open_write() &&
-			config_set_uint("flags", config_flags, -1, -1) &&
+			config_set_uint(config_key_flags, config_flags, -1, -1) &&
 			config_close_write())
 		return(true);
 
@@ -4,6 +4,7 @@
 #include "uart.h"
 #include "util.h"
 #include "stats.h"
+#include "config_keys.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -31,7 +32,7 @@ enum
 	flag_tmd_high_sens =		1 << 11,
 	flag_apds3_high_sens =		1 << 12,
 	flag_apds6_high_sens =		1 << 13,
-	flag_dummy2 =				1 << 14,
+	flag_log_deferred =			1 << 14,
 	flag_udp_term_empty =		1 << 15,
 	flag_enable_orbital =		1 << 16,
 	flag_cmd_from_uart =		1 << 17,
@@ -39,6 +40,16 @@ enum
 	flag_ssd_height_32 =		1 << 19,
 };
 
+typedef enum
+{
+#define config_key_entry(id, pattern, params) config_key_ ## id,
+	CONFIG_KEYS(config_key_entry)
+#undef config_key_entry
+	config_key_size,
+} config_key_t;
+
+_Static_assert(config_key_size < 255, "too many config keys");
+
 void			config_flags_to_string(bool nl, const char *, string_t *);
 bool			config_flag_change(unsigned int flag, bool set);
 void			config_flag_change_nosave(unsigned int flag, bool set);
@@ -57,51 +68,81 @@ bool			config_set_int_flashptr(const char *match_name, int value, int index1, in
 bool			config_set_uint_flashptr(const char *match_name, unsigned int value, int index1, int index2);
 bool			config_close_write(void);
 void			config_abort_write(void);
+bool			config_commit(void);
+bool			config_commit_pending(void);
+bool			config_buffer_reclaim(void);
 
 bool			config_get_string_flashptr(const char *id, string_t *value, int param1, int param2);
 bool			config_get_int_flashptr(const char *match_name, int *return_value, int param1, int param2);
 bool			config_get_uint_flashptr(const char *match_name, unsigned int *return_value, int param1, int param2);
 
-#define config_get_string(name, value, p1, p2) \
-({ \
-	static roflash const char name_flash[] = name; \
-	config_get_string_flashptr(name_flash, value, p1, p2); \
-})
+bool			config_get_string(config_key_t key, string_t *value, int param1, int param2);
+bool			config_get_int(config_key_t key, int *value, int param1, int param2);
+bool			config_get_uint(config_key_t key, unsigned int *value, int param1, int param2);
+unsigned int	config_delete(config_key_t key, int param1, int param2);
+bool			config_set_string(config_key_t key, const char *value, int param1, int param2);
+bool			config_set_int(config_key_t key, int value, int param1, int param2);
+bool			config_set_uint(config_key_t key, unsigned int value, int param1, int param2);
+
+// RAM cache for config values that are read on hot paths, a subsystem registers a cache for a key
+// and provides the slots, one for each combination of indices it wants to have cached (or one for a key without indices),
+// all caches are populated from the config when registered and reloaded after any change to the config,
+// a lookup of a value that's not in the config returns the default value;
+// when the config has more values for a key than the cache has slots, lookups fall back to reading the config
+
+typedef struct
+{
+	int16_t	param1;
+	int16_t	param2;
+	int		value;
+} config_cache_slot_t;
 
-#define config_get_int(name, value, p1, p2) \
-({ \
-	static roflash const char name_flash[] = name; \
-	config_get_int_flashptr(name_flash, value, p1, p2); \
-})
+assert_size(config_cache_slot_t, 8);
 
-#define config_get_uint(name, value, p1, p2) \
-({ \
-	static roflash const char name_flash[] = name; \
-	config_get_uint_flashptr(name_flash, value, p1, p2); \
-})
+typedef struct config_cache_T
+{
+	struct config_cache_T	*next;
+	config_cache_slot_t		*slots;
+	config_key_t			id;
+	unsigned int			size;
+	unsigned int			entries;
+	int						default_value;
+	unsigned int			is_unsigned:1;
+	unsigned int			overflow:1;
+} config_cache_t;
+
+void			config_cache_register(config_cache_t *cache, config_cache_slot_t *slots, unsigned int size, config_key_t id, bool is_unsigned, int default_value);
+void			config_cache_reload(void);
+int				config_cache_fallback(const config_cache_t *cache, int param1, int param2);
+
+attr_inline int config_cache_int(const config_cache_t *cache, int param1, int param2)
+{
+	extern unsigned int config_cache_generation, config_cache_loaded_generation;
+	const config_cache_slot_t *slot;
+	unsigned int entry;
 
-#define config_delete(name, wildcard, p1, p2) \
-({ \
-	static roflash const char name_flash[] = name; \
-	config_delete_flashptr(name_flash, wildcard, p1, p2); \
-})
+	if(config_cache_loaded_generation != config_cache_generation)
+		config_cache_reload();
 
-#define config_set_string(name, value, p1, p2) \
-({ \
-	static roflash const char name_flash[] = name; \
-	config_set_string_flashptr(name_flash, value, p1, p2); \
-})
+	if(cache->overflow)
+		return(config_cache_fallback(cache, param1, param2));
 
-#define config_set_int(name, value, p1, p2) \
-({ \
-	static roflash const char name_flash[] = name; \
-	config_set_int_flashptr(name_flash, value, p1, p2); \
-})
+	for(entry = 0, slot = cache->slots; entry < cache->entries; entry++, slot++)
+		if((slot->param1 == param1) && (slot->param2 == param2))
+			return(slot->value);
+
+	return(cache->default_value);
+}
+
+attr_inline unsigned int config_cache_uint(const config_cache_t *cache, int param1, int param2)
+{
+	return((unsigned int)config_cache_int(cache, param1, param2));
+}
 
-#define config_set_uint(name, value, p1, p2) \
+#define config_delete_wildcard(name, p1, p2) \
 ({ \
 	static roflash const char name_flash[] = name; \
-	config_set_uint_flashptr(name_flash, value, p1, p2); \
+	config_delete_flashptr(name_flash, true, p1, p2); \
 })
 
 attr_inline uint32_t config_flags_match(uint32_t match_flags)
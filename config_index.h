@@ -0,0 +1,164 @@
+#ifndef config_index_h
+#define config_index_h
+
+// binary config keys and the hash index over the config sector, only depends on attribute.h so host tools (bench-config) can use them
+
+#include "attribute.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// a binary key holds the key id and both indices, unused indices are stored as config_key_param_none
+
+enum
+{
+	config_key_param_none = 0xfff,
+	config_key_invalid = 0xffffffff,
+};
+
+attr_const attr_inline uint32_t config_key_make(unsigned int id, unsigned int params, int param1, int param2)
+{
+	if((params < 1) || (param1 < 0))
+		param1 = config_key_param_none;
+
+	if((params < 2) || (param2 < 0))
+		param2 = config_key_param_none;
+
+	if((param1 > config_key_param_none) || (param2 > config_key_param_none))
+		return(config_key_invalid);
+
+	return((id << 24) | (param1 << 12) | (param2 << 0));
+}
+
+// match a name against the pattern of one key id and return the key, or config_key_invalid,
+// only canonical numbers (no leading zeroes) match an index, so every key has exactly one name
+
+attr_inline uint32_t config_key_match(unsigned int id, const char *pattern, unsigned int params, const char *name, unsigned int length)
+{
+	unsigned int current, amount, value;
+	int param[2];
+
+	for(current = 0, amount = 0; *pattern; )
+	{
+		if((pattern[0] == '%') && (pattern[1] == 'u'))
+		{
+			if((amount >= 2) || (current >= length) || (name[current] < '0') || (name[current] > '9') ||
+					((name[current] == '0') && ((current + 1) < length) && (name[current + 1] >= '0') && (name[current + 1] <= '9')))
+				return(config_key_invalid);
+
+			for(value = 0; (current < length) && (name[current] >= '0') && (name[current] <= '9'); current++)
+				if(value <= config_key_param_none)
+					value = (value * 10) + (name[current] - '0');
+
+			param[amount++] = value;
+			pattern += 2;
+			continue;
+		}
+
+		if((current >= length) || (name[current] != *pattern))
+			return(config_key_invalid);
+
+		current++;
+		pattern++;
+	}
+
+	if(current != length)
+		return(config_key_invalid);
+
+	return(config_key_make(id, params, (amount > 0) ? param[0] : -1, (amount > 1) ? param[1] : -1));
+}
+
+// in-RAM hash index over the config sector, for O(1) lookups by binary key, open addressing with linear probing
+
+enum
+{
+	config_index_min_entry_length = 14,
+	config_index_bits = 9,
+	config_index_size = 1 << config_index_bits,
+	config_index_max_entries = (config_index_size * 3) / 4,
+};
+
+// keys and offsets are kept in separate arrays, as a struct they would need two bytes of padding per slot
+
+typedef struct
+{
+	uint32_t		key[config_index_size];		// binary key
+	uint16_t		offset[config_index_size];	// offset of the value in the sector, 0 = free slot
+	unsigned int	entries;
+} config_index_t;
+
+assert_size(config_index_t, (config_index_size * 6) + 4);
+
+attr_const attr_inline unsigned int config_index_slot(uint32_t key)
+{
+	return((uint32_t)(key * 2654435761UL) >> (32 - config_index_bits));
+}
+
+// returns false if the index is full
+
+attr_inline bool config_index_insert(config_index_t *index, uint32_t key, unsigned int offset)
+{
+	unsigned int slot;
+
+	if(index->entries >= config_index_max_entries)
+		return(false);
+
+	for(slot = config_index_slot(key); index->offset[slot] != 0; slot = (slot + 1) & (config_index_size - 1))
+		(void)0;
+
+	index->key[slot] = key;
+	index->offset[slot] = offset;
+	index->entries++;
+
+	return(true);
+}
+
+attr_inline int config_index_find(const config_index_t *index, uint32_t key)
+{
+	unsigned int slot, offset;
+
+	for(slot = config_index_slot(key); (offset = index->offset[slot]) != 0; slot = (slot + 1) & (config_index_size - 1))
+		if(index->key[slot] == key)
+			return(offset);
+
+	return(-1);
+}
+
+// an entry has been removed from the sector, drop its slot and move the offsets of the entries that followed,
+// so the index doesn't need to be rebuilt (which would have to parse every name in the sector)
+
+attr_inline void config_index_erase(config_index_t *index, unsigned int value_offset, unsigned int position, unsigned int length)
+{
+	unsigned int slot, next, home;
+
+	for(slot = 0; slot < config_index_size; slot++)
+		if(index->offset[slot] == value_offset)
+			break;
+
+	if(slot < config_index_size)
+	{
+		// backward shift deletion, keeps the probe sequences of the remaining entries intact
+
+		for(next = (slot + 1) & (config_index_size - 1); index->offset[next] != 0; next = (next + 1) & (config_index_size - 1))
+		{
+			home = config_index_slot(index->key[next]);
+
+			if(((next - home) & (config_index_size - 1)) >= ((next - slot) & (config_index_size - 1)))
+			{
+				index->key[slot] = index->key[next];
+				index->offset[slot] = index->offset[next];
+				slot = next;
+			}
+		}
+
+		index->key[slot] = 0;
+		index->offset[slot] = 0;
+		index->entries--;
+	}
+
+	for(slot = 0; slot < config_index_size; slot++)
+		if(index->offset[slot] > position)
+			index->offset[slot] -= length;
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef config_keys_h
+#define config_keys_h
+
+// no includes, this table is also used by host tools
+
+// all config keys known at compile time: id, name pattern and the number of %u indices in the pattern
+// the log stores the id instead of the name, so only ever append new keys at the end
+
+#define CONFIG_KEYS(config_key_entry) \
+	config_key_entry(flags,							"flags",							0) \
+	config_key_entry(identification,				"identification",					0) \
+	config_key_entry(wlan_mode,						"wlan.mode",						0) \
+	config_key_entry(wlan_client_ssid,				"wlan.client.ssid",					0) \
+	config_key_entry(wlan_client_passwd,			"wlan.client.passwd",				0) \
+	config_key_entry(wlan_ap_ssid,					"wlan.ap.ssid",						0) \
+	config_key_entry(wlan_ap_passwd,				"wlan.ap.passwd",					0) \
+	config_key_entry(wlan_ap_channel,				"wlan.ap.channel",					0) \
+	config_key_entry(bridge_port,					"bridge.port",						0) \
+	config_key_entry(cmd_port,						"cmd.port",							0) \
+	config_key_entry(uart_baud,						"uart.baud.%u",						1) \
+	config_key_entry(uart_data,						"uart.data.%u",						1) \
+	config_key_entry(uart_stop,						"uart.stop.%u",						1) \
+	config_key_entry(uart_parity,					"uart.parity.%u",					1) \
+	config_key_entry(uart_frame_gap,				"uart.frame.gap.%u",				1) \
+	config_key_entry(uart_frame_timestamp,			"uart.frame.timestamp.%u",			1) \
+	config_key_entry(i2c_speed_delay,				"i2c.speed_delay",					0) \
+	config_key_entry(i2s_factor,					"i2s.%u.%u.factor",					2) \
+	config_key_entry(i2s_offset,					"i2s.%u.%u.offset",					2) \
+	config_key_entry(sntp_server,					"sntp.server",						0) \
+	config_key_entry(sntp_tz,						"sntp.tz",							0) \
+	config_key_entry(trigger_status_io,				"trigger.status.io",				0) \
+	config_key_entry(trigger_status_pin,			"trigger.status.pin",				0) \
+	config_key_entry(trigger_assoc_io,				"trigger.assoc.io",					0) \
+	config_key_entry(trigger_assoc_pin,				"trigger.assoc.pin",				0) \
+	config_key_entry(trigger_remote,				"trigger.remote.%u.%u",				2) \
+	config_key_entry(display_fliptimeout,			"display.fliptimeout",				0) \
+	config_key_entry(picture_autoload,				"picture.autoload",					0) \
+	config_key_entry(pwm_period,					"pwm.period",						0) \
+	config_key_entry(pwm_width,						"pwm.width",						0) \
+	config_key_entry(io_mode,						"io.%u.%u.mode",					2) \
+	config_key_entry(io_llmode,						"io.%u.%u.llmode",					2) \
+	config_key_entry(io_flags,						"io.%u.%u.flags",					2) \
+	config_key_entry(io_counter_debounce,			"io.%u.%u.counter.debounce",		2) \
+	config_key_entry(io_renc_debounce,				"io.%u.%u.renc.debounce",			2) \
+	config_key_entry(io_renc_pintype,				"io.%u.%u.renc.pintype",			2) \
+	config_key_entry(io_renc_trigger_pin_io,		"io.%u.%u.renc.trigger_pin.io",		2) \
+	config_key_entry(io_renc_trigger_pin_pin,		"io.%u.%u.renc.trigger_pin.pin",	2) \
+	config_key_entry(io_renc_remote,				"io.%u.%u.renc.remote",				2) \
+	config_key_entry(io_trigger_debounce,			"io.%u.%u.trigger.debounce",		2) \
+	config_key_entry(io_trigger_io,					"io.%u.%u.trigger.io",				2) \
+	config_key_entry(io_trigger_pin,				"io.%u.%u.trigger.pin",				2) \
+	config_key_entry(io_trigger_type,				"io.%u.%u.trigger.type",			2) \
+	config_key_entry(io_trigger_0_io,				"io.%u.%u.trigger.0.io",			2) \
+	config_key_entry(io_trigger_0_pin,				"io.%u.%u.trigger.0.pin",			2) \
+	config_key_entry(io_trigger_0_type,				"io.%u.%u.trigger.0.type",			2) \
+	config_key_entry(io_trigger_1_io,				"io.%u.%u.trigger.1.io",			2) \
+	config_key_entry(io_trigger_1_pin,				"io.%u.%u.trigger.1.pin",			2) \
+	config_key_entry(io_trigger_1_type,				"io.%u.%u.trigger.1.type",			2) \
+	config_key_entry(io_timer_delay,				"io.%u.%u.timer.delay",				2) \
+	config_key_entry(io_timer_direction,			"io.%u.%u.timer.direction",			2) \
+	config_key_entry(io_outputa_speed,				"io.%u.%u.outputa.speed",			2) \
+	config_key_entry(io_outputa_lower,				"io.%u.%u.outputa.lower",			2) \
+	config_key_entry(io_outputa_upper,				"io.%u.%u.outputa.upper",			2) \
+	config_key_entry(io_i2c_pinmode,				"io.%u.%u.i2c.pinmode",				2) \
+	config_key_entry(io_lcd_pin,					"io.%u.%u.lcd.pin",					2) \
+	config_key_entry(io_mcp_intpin,					"io.mcp.intpin",					0) \
+	config_key_entry(io_frequency_gate,				"io.%u.%u.frequency.gate",			2) \
+	config_key_entry(io_ledpixel_length,			"io.ledpixel.length",				0) \
+
+#endif
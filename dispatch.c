@@ -4,6 +4,8 @@
 #include "sys_string.h"
 #include "application.h"
 #include "io.h"
+#include "io_gpio.h"
+#include "io_ledpixel.h"
 #include "stats.h"
 #include "i2c.h"
 #include "display.h"
@@ -14,10 +16,13 @@
 #include "config.h"
 #include "lwip-interface.h"
 #include "remote_trigger.h"
+#include "flash_job.h"
+#include "ota.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <string.h>
 
 typedef enum
 {
@@ -35,15 +40,34 @@ enum
 
 static os_event_t task_queue[3][task_queue_length];
 
-flash_sector_buffer_use_t flash_sector_buffer_use;
-string_new(attr_flash_align, flash_sector_buffer, 4096);
+enum
+{
+	flash_buffer_pool_size = 2,
+	flash_buffer_waiters_size = 4,
+};
+
+typedef struct
+{
+	unsigned int	prio;
+	task_id_t		task;
+	unsigned int	argument;
+} flash_buffer_waiter_t;
+
+static attr_flash_align char flash_buffer_pool_data[flash_buffer_pool_size][SPI_FLASH_SEC_SIZE];
+static string_t flash_buffer_pool[flash_buffer_pool_size];
+static flash_sector_buffer_use_t flash_buffer_pool_use[flash_buffer_pool_size];
+static flash_buffer_waiter_t flash_buffer_waiters[flash_buffer_waiters_size];
+static unsigned int flash_buffer_waiters_length;
+static unsigned int flash_buffer_leases, flash_buffer_lease_failures, flash_buffer_waits, flash_buffer_in_use_max;
 
 string_new(static attr_flash_align, command_socket_receive_buffer, 4096 + 64);
 string_new(static attr_flash_align, command_socket_send_buffer, 4096 + 64);
 static lwip_if_socket_t command_socket;
 
-string_new(static, uart_socket_receive_buffer, 128);
-string_new(static, uart_socket_send_buffer, 128);
+string_new(static, uart_socket_receive_buffer, 1460); // a complete tcp segment, so nothing gets truncated
+static unsigned int uart_socket_receive_offset = 0;
+static telnet_strip_state_t uart_socket_telnet_strip_state = ts_copy;
+string_new(static, uart_socket_send_buffer, 256 + 4); // room for a complete modbus rtu frame plus timestamp
 static lwip_if_socket_t uart_socket;
 
 bool uart_bridge_active = false;
@@ -53,16 +77,37 @@ static os_timer_t slow_timer;
 
 typedef struct
 {
-	int	io;
-	int	pin;
+	config_cache_t		io;
+	config_cache_t		pin;
+	config_cache_slot_t	io_slot;
+	config_cache_slot_t	pin_slot;
 } trigger_t;
 
-static trigger_t trigger_alert = { -1, -1 };
-static trigger_t assoc_alert = { -1, -1 };
+static trigger_t trigger_alert;
+static trigger_t assoc_alert;
+
+static void trigger_register(trigger_t *trigger, config_key_t io, config_key_t pin)
+{
+	config_cache_register(&trigger->io, &trigger->io_slot, 1, io, false, -1);
+	config_cache_register(&trigger->pin, &trigger->pin_slot, 1, pin, false, -1);
+}
+
+static void trigger_fire(const trigger_t *trigger, io_trigger_t action)
+{
+	int io, pin;
+
+	io = config_cache_int(&trigger->io, -1, -1);
+	pin = config_cache_int(&trigger->pin, -1, -1);
+
+	if((io >= 0) && (pin >= 0))
+		io_trigger_pin((string_t *)0, io, pin, action);
+}
 
 static void background_task_bridge_uart(void)
 {
-	unsigned int byte;
+	unsigned int byte, gap, length;
+	uint32_t timestamp;
+	bool timestamp_enabled;
 
 	if(uart_empty(0))
 		return;
@@ -96,8 +141,41 @@ static void background_task_bridge_uart(void)
 
 	string_clear(&uart_socket_send_buffer);
 
-	while(!uart_empty(0) && string_space(&uart_socket_send_buffer))
-		string_append_byte(&uart_socket_send_buffer, uart_receive(0));
+	uart_get_frame_mode(0, &gap, &timestamp_enabled);
+
+	if(gap > 0)
+	{
+		// framing mode, send exactly one complete frame per segment/datagram
+
+		if(!uart_frame_available(0, &length, &timestamp))
+			return;
+
+		if(timestamp_enabled)
+		{
+			string_append_byte(&uart_socket_send_buffer, (timestamp >> 24) & 0xff);
+			string_append_byte(&uart_socket_send_buffer, (timestamp >> 16) & 0xff);
+			string_append_byte(&uart_socket_send_buffer, (timestamp >>  8) & 0xff);
+			string_append_byte(&uart_socket_send_buffer, (timestamp >>  0) & 0xff);
+		}
+
+		for(; (length > 0) && !uart_empty(0) && string_space(&uart_socket_send_buffer); length--)
+			string_append_byte(&uart_socket_send_buffer, uart_receive(0));
+
+		// drop the remainder of frames that don't fit, they can't be sent in one segment anyway
+
+		if(length > 0)
+		{
+			stat_uart_rx_frames_truncated++;
+
+			for(; (length > 0) && !uart_empty(0); length--)
+				(void)uart_receive(0);
+		}
+
+		uart_frame_done(0);
+	}
+	else
+		while(!uart_empty(0) && string_space(&uart_socket_send_buffer))
+			string_append_byte(&uart_socket_send_buffer, uart_receive(0));
 
 	if(string_empty(&uart_socket_send_buffer))
 		return;
@@ -107,6 +185,85 @@ static void background_task_bridge_uart(void)
 		stat_uart_send_buffer_overflow++;
 		log("lwip uart send failed\n");
 	}
+
+	// more frames waiting, try again, if the socket is still busy, the slow timer will pick them up
+
+	if((gap > 0) && uart_frame_available(0, &length, &timestamp))
+		dispatch_post_task(0, task_uart_bridge, 0);
+}
+
+static void bridge_socket_to_uart(void)
+{
+	const char *buffer, *iac;
+	unsigned int length, chunk;
+	bool strip_telnet;
+
+	length = string_length(&uart_socket_receive_buffer);
+	buffer = string_buffer(&uart_socket_receive_buffer);
+	strip_telnet = config_flags_match(flag_strip_telnet);
+
+	// a new connection never continues an IAC sequence from the previous one
+
+	if(lwip_if_accepted(&uart_socket))
+		uart_socket_telnet_strip_state = ts_copy;
+
+	while(uart_socket_receive_offset < length)
+	{
+		switch(uart_socket_telnet_strip_state)
+		{
+			case(ts_copy):
+			{
+				chunk = length - uart_socket_receive_offset;
+
+				// fast path: copy everything up to the next IAC (or end of buffer) in one go
+
+				if(strip_telnet && (iac = memchr(buffer + uart_socket_receive_offset, 0xff, chunk)))
+					chunk = iac - (buffer + uart_socket_receive_offset);
+
+				if(chunk == 0)
+				{
+					uart_socket_telnet_strip_state = ts_dodont;
+					uart_socket_receive_offset++;
+					break;
+				}
+
+				chunk = uart_send_bytes(0, chunk, buffer + uart_socket_receive_offset);
+
+				// uart send queue is full, continue when it has been drained by the uart
+
+				if(chunk == 0)
+					goto stalled;
+
+				uart_socket_receive_offset += chunk;
+
+				break;
+			}
+
+			case(ts_dodont):
+			{
+				uart_socket_telnet_strip_state = ts_data;
+				uart_socket_receive_offset++;
+				break;
+			}
+
+			case(ts_data):
+			{
+				uart_socket_telnet_strip_state = ts_copy;
+				uart_socket_receive_offset++;
+				break;
+			}
+		}
+	}
+
+	// everything has been queued, the receive buffer can be released,
+	// the telnet state is retained, an IAC sequence may continue in the next packet
+
+	uart_socket_receive_offset = 0;
+	string_clear(&uart_socket_receive_buffer);
+	lwip_if_receive_buffer_unlock(&uart_socket);
+
+stalled:
+	uart_flush(0);
 }
 
 static void generic_task_handler(unsigned int prio, task_id_t command, unsigned int argument)
@@ -125,15 +282,13 @@ static void generic_task_handler(unsigned int prio, task_id_t command, unsigned
 			break;
 		}
 
-		case(task_uart_fetch_fifo):
-		{
-			uart_task_handler_fetch_fifo(argument);
-			break;
-		}
-
 		case(task_uart_fill_fifo):
 		{
 			uart_task_handler_fill_fifo(argument);
+
+			if((argument == 0) && uart_bridge_active && !string_empty(&uart_socket_receive_buffer))
+				bridge_socket_to_uart();
+
 			break;
 		}
 
@@ -279,24 +434,21 @@ static void generic_task_handler(unsigned int prio, task_id_t command, unsigned
 
 		case(task_alert_pin_changed):
 		{
-			if((trigger_alert.io >= 0) && (trigger_alert.pin >= 0))
-				io_trigger_pin((string_t *)0, trigger_alert.io, trigger_alert.pin, io_trigger_on);
+			trigger_fire(&trigger_alert, io_trigger_on);
 
 			break;
 		}
 
 		case(task_alert_association):
 		{
-			if((assoc_alert.io >= 0) && (assoc_alert.pin >= 0))
-				io_trigger_pin((string_t *)0, assoc_alert.io, assoc_alert.pin, io_trigger_on);
+			trigger_fire(&assoc_alert, io_trigger_on);
 
 			break;
 		}
 
 		case(task_alert_disassociation):
 		{
-			if((assoc_alert.io >= 0) && (assoc_alert.pin >= 0))
-				io_trigger_pin((string_t *)0, assoc_alert.io, assoc_alert.pin, io_trigger_off);
+			trigger_fire(&assoc_alert, io_trigger_off);
 
 			break;
 		}
@@ -306,6 +458,48 @@ static void generic_task_handler(unsigned int prio, task_id_t command, unsigned
 			remote_trigger_send(argument);
 			break;
 		}
+
+		case(task_log_deferred):
+		{
+			log_deferred_render();
+			break;
+		}
+
+		case(task_config_commit):
+		{
+			config_commit();
+			break;
+		}
+
+		case(task_flash_job):
+		{
+			flash_job_run();
+			break;
+		}
+
+		case(task_flash_checksum):
+		{
+			ota_checksum_run();
+			break;
+		}
+
+		case(task_io_expander_interrupt):
+		{
+			io_expander_interrupt();
+			break;
+		}
+
+		case(task_io_edge_events):
+		{
+			io_gpio_edge_events_drain();
+			break;
+		}
+
+		case(task_ledpixel_send):
+		{
+			io_ledpixel_send();
+			break;
+		}
 	}
 }
 
@@ -324,20 +518,25 @@ static void user_task_prio_0_handler(struct ETSEventTag *event)
 	generic_task_handler(2, (task_id_t)event->sig, event->par);
 }
 
-void dispatch_post_task(unsigned int prio, task_id_t command, unsigned int argument)
+// returns false when the task queue is full, callers that depend on the task running must handle that
+
+bool dispatch_post_task(unsigned int prio, task_id_t command, unsigned int argument)
 {
 	static roflash const unsigned int sdk_task_id[3] = { USER_TASK_PRIO_2, USER_TASK_PRIO_1, USER_TASK_PRIO_0 };
 
-	if(system_os_post(sdk_task_id[prio], command, argument))
+	if(!system_os_post(sdk_task_id[prio], command, argument))
 	{
-		stat_task_posted[prio]++;
-		stat_task_current_queue[prio]++;
-
-		if(stat_task_current_queue[prio] > stat_task_max_queue[prio])
-			stat_task_max_queue[prio] = stat_task_current_queue[prio];
-	}
-	else
 		stat_task_post_failed[prio]++;
+		return(false);
+	}
+
+	stat_task_posted[prio]++;
+	stat_task_current_queue[prio]++;
+
+	if(stat_task_current_queue[prio] > stat_task_max_queue[prio])
+		stat_task_max_queue[prio] = stat_task_current_queue[prio];
+
+	return(true);
 }
 
 iram static void fast_timer_callback(void *arg)
@@ -373,6 +572,7 @@ iram static void slow_timer_callback(void *arg)
 	if(!stat_flags.wlan_recovery_mode_active && (stat_slow_timer == 300) && (wifi_station_get_connect_status() != STATION_GOT_IP))
 		dispatch_post_task(1, task_fallback_wlan, 0);
 
+	flash_job_kick();
 	io_periodic_slow();
 	os_timer_arm(&slow_timer, 100, 0);
 }
@@ -422,15 +622,28 @@ static void wlan_event_handler(System_Event_t *event)
 static void socket_command_callback_data_received(lwip_if_socket_t *socket, unsigned int length)
 {
 	static unsigned int command_left_to_read = 0;
-	static const char command_string[] = "flash-send ";
-	unsigned int chunk_length;
+	static const char command_send[] = "flash-send ";
+	static const char command_stream[] = "flash-stream ";
+	unsigned int chunk_length, length_field;
 	int chunk_offset;
 
-	if((command_left_to_read == 0) &&
-			string_nmatch_cstr(&command_socket_receive_buffer, command_string, sizeof(command_string) - 1) &&
-			(parse_uint(2, &command_socket_receive_buffer, &chunk_length, 10, ' ') == parse_ok) &&
-			((chunk_offset = string_sep(&command_socket_receive_buffer, 0, 3, ' ')) >= 0))
-		command_left_to_read = chunk_offset + chunk_length;
+	// binary data follows the length field, wait for all of it before handling the command
+
+	if(command_left_to_read == 0)
+	{
+		if(string_nmatch_cstr(&command_socket_receive_buffer, command_send, sizeof(command_send) - 1))
+			length_field = 2;
+		else
+			if(string_nmatch_cstr(&command_socket_receive_buffer, command_stream, sizeof(command_stream) - 1))
+				length_field = 3;
+			else
+				length_field = 0;
+
+		if((length_field > 0) &&
+				(parse_uint(length_field, &command_socket_receive_buffer, &chunk_length, 10, ' ') == parse_ok) &&
+				((chunk_offset = string_sep(&command_socket_receive_buffer, 0, length_field + 1, ' ')) >= 0))
+			command_left_to_read = chunk_offset + chunk_length;
+	}
 
 	if(command_left_to_read > 0)
 	{
@@ -448,57 +661,136 @@ static void socket_command_callback_data_received(lwip_if_socket_t *socket, unsi
 
 static void socket_uart_callback_data_received(lwip_if_socket_t *socket, unsigned int received)
 {
-	int current, length;
-	uint8_t byte;
-	bool strip_telnet;
-	telnet_strip_state_t telnet_strip_state;
+	// the receive buffer stays locked until all data has been queued to the uart,
+	// this throttles the sender (tcp) instead of losing data
 
-	length = string_length(&uart_socket_receive_buffer);
+	bridge_socket_to_uart();
+}
 
-	strip_telnet = config_flags_match(flag_strip_telnet);
-	telnet_strip_state = ts_copy;
+static bool flash_buffer_available(void)
+{
+	unsigned int current;
 
-	for(current = 0; current < length; current++)
-	{
-		byte = string_at(&uart_socket_receive_buffer, current);
+	for(current = 0; current < flash_buffer_pool_size; current++)
+		if(flash_buffer_pool_use[current] == fsb_free)
+			return(true);
 
-		switch(telnet_strip_state)
-		{
-			case(ts_copy):
-			{
-				if(strip_telnet && (byte == 0xff))
-					telnet_strip_state = ts_dodont;
-				else
-				{
-					if(uart_full(0))
-						stat_uart_receive_buffer_overflow++;
-					else
-						uart_send(0, byte);
-				}
+	return(false);
+}
 
+string_t *flash_buffer_lease(flash_sector_buffer_use_t user)
+{
+	unsigned int current, leased, in_use;
+
+	// buffers handed to the flash job queue are released on completion and the config only keeps its buffer
+	// as cache, so when the pool is exhausted, complete the pending jobs first, then take the config's buffer
+
+	if(!flash_buffer_available() && flash_job_pending())
+		flash_job_flush();
+
+	if(!flash_buffer_available())
+		for(current = 0; current < flash_buffer_pool_size; current++)
+			if((flash_buffer_pool_use[current] == fsb_config_cache) && config_buffer_reclaim())
 				break;
-			}
-			case(ts_dodont):
-			{
-				telnet_strip_state = ts_data;
-				break;
-			}
-			case(ts_data):
-			{
-				telnet_strip_state = ts_copy;
-				break;
-			}
+
+	for(current = 0, leased = flash_buffer_pool_size, in_use = 0; current < flash_buffer_pool_size; current++)
+	{
+		if((flash_buffer_pool_use[current] == fsb_free) && (leased >= flash_buffer_pool_size))
+		{
+			flash_buffer_pool_use[current] = user;
+			leased = current;
 		}
+
+		if(flash_buffer_pool_use[current] != fsb_free)
+			in_use++;
 	}
 
-	string_clear(&uart_socket_receive_buffer);
-	lwip_if_receive_buffer_unlock(socket);
-	uart_flush(0);
+	if(leased >= flash_buffer_pool_size)
+	{
+		flash_buffer_lease_failures++;
+		return((string_t *)0);
+	}
+
+	if(in_use > flash_buffer_in_use_max)
+		flash_buffer_in_use_max = in_use;
+
+	flash_buffer_leases++;
+	string_set(&flash_buffer_pool[leased], flash_buffer_pool_data[leased], SPI_FLASH_SEC_SIZE, 0);
+
+	return(&flash_buffer_pool[leased]);
+}
+
+void flash_buffer_release(string_t *buffer)
+{
+	unsigned int current;
+	flash_buffer_waiter_t waiter;
+
+	for(current = 0; current < flash_buffer_pool_size; current++)
+		if(buffer == &flash_buffer_pool[current])
+			break;
+
+	if((current >= flash_buffer_pool_size) || (flash_buffer_pool_use[current] == fsb_free))
+	{
+		log("flash buffer release: buffer not leased\n");
+		return;
+	}
+
+	flash_buffer_pool_use[current] = fsb_free;
+
+	if(flash_buffer_waiters_length > 0)
+	{
+		waiter = flash_buffer_waiters[0];
+		memmove(&flash_buffer_waiters[0], &flash_buffer_waiters[1], (flash_buffer_waiters_length - 1) * sizeof(flash_buffer_waiters[0]));
+		flash_buffer_waiters_length--;
+		dispatch_post_task(waiter.prio, waiter.task, waiter.argument);
+	}
+}
+
+bool flash_buffer_wait(unsigned int prio, task_id_t task, unsigned int argument)
+{
+	unsigned int current;
+
+	for(current = 0; current < flash_buffer_waiters_length; current++)
+		if((flash_buffer_waiters[current].task == task) && (flash_buffer_waiters[current].argument == argument))
+			return(true);
+
+	if(flash_buffer_waiters_length >= flash_buffer_waiters_size)
+		return(false);
+
+	flash_buffer_waiters[flash_buffer_waiters_length].prio = prio;
+	flash_buffer_waiters[flash_buffer_waiters_length].task = task;
+	flash_buffer_waiters[flash_buffer_waiters_length].argument = argument;
+	flash_buffer_waiters_length++;
+	flash_buffer_waits++;
+
+	return(true);
+}
+
+void flash_buffer_stats(string_t *dst)
+{
+	unsigned int current;
+
+	string_format(dst, ">  pool size: %u, in use:", (unsigned int)flash_buffer_pool_size);
+
+	for(current = 0; current < flash_buffer_pool_size; current++)
+		string_format(dst, " %u", flash_buffer_pool_use[current]);
+
+	string_format(dst, ", max in use: %u\n", flash_buffer_in_use_max);
+	string_format(dst, ">  leases: %u, failed: %u, waits: %u, waiting: %u\n",
+			flash_buffer_leases, flash_buffer_lease_failures, flash_buffer_waits, flash_buffer_waiters_length);
 }
 
 void dispatch_init1(void)
 {
-	flash_sector_buffer_use = fsb_free;
+	unsigned int current;
+
+	for(current = 0; current < flash_buffer_pool_size; current++)
+	{
+		flash_buffer_pool_use[current] = fsb_free;
+		string_set(&flash_buffer_pool[current], flash_buffer_pool_data[current], SPI_FLASH_SEC_SIZE, 0);
+	}
+
+	flash_buffer_waiters_length = 0;
 
 	system_os_task(user_task_prio_0_handler, USER_TASK_PRIO_0, task_queue[0], task_queue_length);
 	system_os_task(user_task_prio_1_handler, USER_TASK_PRIO_1, task_queue[1], task_queue_length);
@@ -507,38 +799,26 @@ void dispatch_init1(void)
 
 void dispatch_init2(void)
 {
-	int io, pin;
 	unsigned int cmd_port, uart_port;
 
-	if(config_get_int("trigger.status.io", &io, -1, -1) &&
-			config_get_int("trigger.status.pin", &pin, -1, -1))
-	{
-		trigger_alert.io = io;
-		trigger_alert.pin = pin;
-	}
-
-	if(config_get_int("trigger.assoc.io", &io, -1, -1) &&
-			config_get_int("trigger.assoc.pin", &pin, -1, -1))
-	{
-		assoc_alert.io = io;
-		assoc_alert.pin = pin;
-	}
+	trigger_register(&trigger_alert, config_key_trigger_status_io, config_key_trigger_status_pin);
+	trigger_register(&assoc_alert, config_key_trigger_assoc_io, config_key_trigger_assoc_pin);
 
-	if(!config_get_uint("cmd.port", &cmd_port, -1, -1))
+	if(!config_get_uint(config_key_cmd_port, &cmd_port, -1, -1))
 		cmd_port = 24;
 
-	if(!config_get_uint("bridge.port", &uart_port, -1, -1))
+	if(!config_get_uint(config_key_bridge_port, &uart_port, -1, -1))
 		uart_port = 0;
 
 	wifi_set_event_handler_cb(wlan_event_handler);
 
 	lwip_if_socket_create(&command_socket, &command_socket_receive_buffer, &command_socket_send_buffer, cmd_port,
-			true, config_flags_match(flag_udp_term_empty), socket_command_callback_data_received);
+			true, config_flags_match(flag_udp_term_empty), false, socket_command_callback_data_received);
 
 	if(uart_port > 0)
 	{
 		lwip_if_socket_create(&uart_socket, &uart_socket_receive_buffer, &uart_socket_send_buffer, uart_port,
-			true, config_flags_match(flag_udp_term_empty), socket_uart_callback_data_received);
+			true, config_flags_match(flag_udp_term_empty), true, socket_uart_callback_data_received);
 
 		uart_bridge_active = true;
 	}
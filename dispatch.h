@@ -6,7 +6,6 @@
 typedef enum
 {
 	task_invalid,
-	task_uart_fetch_fifo,
 	task_uart_fill_fifo,
 	task_uart_bridge,
 	task_alert_pin_changed,
@@ -22,26 +21,36 @@ typedef enum
 	task_fallback_wlan,
 	task_update_time,
 	task_remote_trigger,
+	task_log_deferred,
+	task_config_commit,
+	task_flash_job,
+	task_flash_checksum,
+	task_io_expander_interrupt,
+	task_io_edge_events,
+	task_ledpixel_send,
 } task_id_t;
 
 typedef enum
 {
 	fsb_free,
-	fsb_config_read,
-	fsb_config_write,
-	fsb_config_write_dirty,
-	fsb_config_cache,
 	fsb_ota,
 	fsb_sequencer,
 	fsb_display_picture,
+	fsb_config_cache,
 } flash_sector_buffer_use_t;
 
 extern	bool uart_bridge_active;
 
-extern	string_t					flash_sector_buffer;
-extern	flash_sector_buffer_use_t	flash_sector_buffer_use;
-
 void	dispatch_init1(void);
 void	dispatch_init2(void);
-void	dispatch_post_task(unsigned int prio, task_id_t, unsigned int argument);
+bool	dispatch_post_task(unsigned int prio, task_id_t, unsigned int argument);
+
+// pool of flash sector buffers, a buffer is leased for the duration of an operation (which may span
+// multiple tasks or commands) and released afterwards; when no buffer is available, a user can queue
+// a task that's posted when a buffer is released, the config has a buffer of its own
+
+string_t	*flash_buffer_lease(flash_sector_buffer_use_t user);
+void		flash_buffer_release(string_t *buffer);
+bool		flash_buffer_wait(unsigned int prio, task_id_t task, unsigned int argument);
+void		flash_buffer_stats(string_t *dst);
 #endif
@@ -252,7 +252,7 @@ static void display_update(bool advance)
 
 	if(!strcmp(display_text, "%%%%"))
 	{
-		config_get_string("identification", &info_text, -1, -1);
+		config_get_string(config_key_identification, &info_text, -1, -1);
 		string_format(&info_text, "\n%s\n%s", display_info_entry->name, display_info_entry->description);
 		display_text = string_to_cstr(&info_text);
 	}
@@ -444,12 +444,11 @@ void display_periodic(void) // gets called 10 times per second
 
 	if(log_to_display)
 	{
-		uint8_t current;
+		char current;
 
-		while(logbuffer_display_current < (unsigned int)string_length(&logbuffer))
+		while(logbuffer_get_char(&logbuffer_display_current, &current))
 		{
-			current = string_at(&logbuffer, logbuffer_display_current++);
-			if(!display_info_entry->output_fn(current))
+			if(!display_info_entry->output_fn((uint8_t)current))
 			{
 				log("display update: display output (3) failed\n");
 				display_data.detected = -1;
@@ -531,7 +530,7 @@ void display_init(void)
 		display_slot[slot].content[0] = '\0';
 	}
 
-	if(!config_get_uint("display.fliptimeout", &flip_timeout, -1, -1))
+	if(!config_get_uint(config_key_display_fliptimeout, &flip_timeout, -1, -1))
 		flip_timeout = 4;
 
 	// for log to display
@@ -549,7 +548,7 @@ void display_init(void)
 	}
 
 	if(display_info_entry->picture_load_fn &&
-			config_get_uint("picture.autoload", &picture_autoload_index, -1, -1) &&
+			config_get_uint(config_key_picture_autoload, &picture_autoload_index, -1, -1) &&
 			(picture_autoload_index < 2) &&
 			!display_info_entry->picture_load_fn(picture_autoload_index))
 	{
@@ -652,7 +651,7 @@ app_action_t application_function_display_flip_timeout(string_t *src, string_t *
 
 		if(timeout == 4)
 		{
-			if(!config_delete("display.fliptimeout", false, -1, -1))
+			if(!config_delete(config_key_display_fliptimeout, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "> cannot delete config (default values)\n");
@@ -660,7 +659,7 @@ app_action_t application_function_display_flip_timeout(string_t *src, string_t *
 			}
 		}
 		else
-			if(!config_set_int("display.fliptimeout", timeout, -1, -1))
+			if(!config_set_int(config_key_display_fliptimeout, timeout, -1, -1))
 			{
 				config_abort_write();
 				string_append(dst, "> cannot set config\n");
@@ -674,7 +673,7 @@ app_action_t application_function_display_flip_timeout(string_t *src, string_t *
 		}
 	}
 
-	if(!config_get_uint("display.fliptimeout", &timeout, -1, -1))
+	if(!config_get_uint(config_key_display_fliptimeout, &timeout, -1, -1))
 		timeout = 4;
 
 	flip_timeout = timeout;
@@ -847,7 +846,7 @@ app_action_t application_function_display_picture_load(string_t *src, string_t *
 		return(app_action_error);
 	}
 
-	if((!parse_uint(1, src, &entry, 0, ' ') == parse_ok) && (!config_get_uint("picture.autoload", &entry, -1, -1)))
+	if((!parse_uint(1, src, &entry, 0, ' ') == parse_ok) && (!config_get_uint(config_key_picture_autoload, &entry, -1, -1)))
 		entry = 0;
 
 	if(entry > 1)
@@ -883,7 +882,7 @@ app_action_t application_function_display_picture_autoload(string_t *src, string
 			return(app_action_error);
 		}
 
-		if(!config_set_uint("picture.autoload", entry, -1, -1))
+		if(!config_set_uint(config_key_picture_autoload, entry, -1, -1))
 		{
 			string_append(dst, "picture set autoload: config set failed\n");
 			config_abort_write();
@@ -891,7 +890,7 @@ app_action_t application_function_display_picture_autoload(string_t *src, string
 		}
 	}
 	else
-		config_delete("picture.autoload", false, -1, -1);
+		config_delete(config_key_picture_autoload, -1, -1);
 
 	if(!config_close_write())
 	{
@@ -899,7 +898,7 @@ app_action_t application_function_display_picture_autoload(string_t *src, string
 		return(app_action_error);
 	}
 
-	if(!config_get_uint("picture.autoload", &entry, -1, -1))
+	if(!config_get_uint(config_key_picture_autoload, &entry, -1, -1))
 	{
 		string_append(dst, "picture set autoload: not set\n");
 		return(app_action_normal);
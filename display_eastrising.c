@@ -498,6 +498,7 @@ static int display_current_slot;
 static picture_load_state_t picture_load_state = pls_idle;
 static unsigned int picture_load_index = 0;
 static unsigned int picture_load_flash_sector = 0, picture_load_sector_offset = 0, picture_load_current = 0;
+static string_t *picture_load_buffer = (string_t *)0;
 
 static bool attr_result_used display_render_line_16x32(bool ucs2, unsigned int line, unsigned int length, const uint8_t *text);
 
@@ -1809,34 +1810,34 @@ bool display_eastrising_periodic(void)
 
 		case(pls_start):
 		{
-			if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
+			if(!(picture_load_buffer = flash_buffer_lease(fsb_display_picture)))
 			{
-				logf("display eastrising: load picture: sector buffer too small: %u\n", flash_sector_buffer_use);
-				goto error1;
-			}
+				// all buffers in use, try again when one is released
+
+				if(!flash_buffer_wait(2, task_display_update, 0))
+					log("display eastrising: load picture: wait queue full\n");
 
-			if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache))
-				return(true); // buffer currently in use, try again later
+				return(true);
+			}
 
 			picture_load_flash_sector = (picture_load_index ? PICTURE_FLASH_OFFSET_1 : PICTURE_FLASH_OFFSET_0) / SPI_FLASH_SEC_SIZE;
-			flash_sector_buffer_use = fsb_display_picture;
 
-			if(spi_flash_read(picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+			if(spi_flash_read(picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(picture_load_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
 			{
 				logf("display eastrising: load picture: failed to read first sector: 0x%x\n", picture_load_flash_sector);
 				goto error2;
 			}
 
-			string_setlength(&flash_sector_buffer, sizeof(ppm_header) - 1);
+			string_setlength(picture_load_buffer, sizeof(ppm_header) - 1);
 
-			if(!string_match_cstr(&flash_sector_buffer, ppm_header))
+			if(!string_match_cstr(picture_load_buffer, ppm_header))
 			{
-				logf("display eastrising: show picture: invalid image header: %s\n", string_to_cstr(&flash_sector_buffer));
+				logf("display eastrising: show picture: invalid image header: %s\n", string_to_cstr(picture_load_buffer));
 				success = true;
 				goto error2;
 			}
 
-			string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
+			string_setlength(picture_load_buffer, SPI_FLASH_SEC_SIZE);
 
 			picture_load_sector_offset = sizeof(ppm_header) - 1;
 			picture_load_current = 0;
@@ -1864,7 +1865,7 @@ bool display_eastrising_periodic(void)
 			unsigned int output_buffer_offset;
 			unsigned int rgb_offset;
 			unsigned int rgb[3];
-			uint8_t *sector_buffer = (uint8_t *)string_buffer_nonconst(&flash_sector_buffer);
+			uint8_t *sector_buffer = (uint8_t *)string_buffer_nonconst(picture_load_buffer);
 
 			if(picture_load_current >= picture_ppm_data_length)
 			{
@@ -1872,20 +1873,6 @@ bool display_eastrising_periodic(void)
 				goto error2;
 			}
 
-			if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache) && (flash_sector_buffer_use != fsb_display_picture))
-				return(true); // buffer currently in use, try again later
-
-			if(flash_sector_buffer_use != fsb_display_picture)
-			{
-				flash_sector_buffer_use = fsb_display_picture;
-
-				if(spi_flash_read(picture_load_flash_sector * SPI_FLASH_SEC_SIZE, sector_buffer, SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
-				{
-					logf("display eastrising: show picture: failed to re-read sector: 0x%x\n", picture_load_flash_sector);
-					goto error2;
-				}
-			}
-
 			chunk_length = umin(picture_ppm_data_length - picture_load_current, 1024 /*sizeof(flash_dram_buffer)*/ / 4);
 			output_buffer_offset = 0;
 
@@ -1949,8 +1936,8 @@ bool display_eastrising_periodic(void)
 error3:
 	display_write(reg_mwcr0, mwcr0);
 error2:
-	flash_sector_buffer_use = fsb_free;
-error1:
+	flash_buffer_release(picture_load_buffer);
+	picture_load_buffer = (string_t *)0;
 	picture_load_state = pls_idle;
 
 	return(success);
@@ -564,12 +564,6 @@ bool display_lcd_picture_load(unsigned int picture_load_index)
 {
 	display_picture_load_flash_sector = (picture_load_index ? PICTURE_FLASH_OFFSET_1 : PICTURE_FLASH_OFFSET_0) / SPI_FLASH_SEC_SIZE;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		logf("display lcd: load picture: sector buffer too small: %u\n", flash_sector_buffer_use);
-		return(false);
-	}
-
 	return(true);
 }
 
@@ -581,6 +575,7 @@ bool display_lcd_layer_select(unsigned int layer)
 	unsigned int udg, udg_line, udg_bit, udg_value;
 	unsigned int byte_offset, bit_offset;
 	const uint8_t *bitmap;
+	string_t *sector_buffer;
 
 	if(layer == 0)
 	{
@@ -596,30 +591,28 @@ bool display_lcd_layer_select(unsigned int layer)
 
 	display_disable_text = true;
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache))
+	if(!(sector_buffer = flash_buffer_lease(fsb_display_picture)))
 	{
-		logf("display lcd: load picture: flash buffer not free, used by: %u\n", flash_sector_buffer_use);
+		log("display lcd: load picture: no sector buffer available\n");
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_display_picture;
-
-	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
 	{
 		logf("display lcd: load picture: failed to read sector: 0x%x\n", display_picture_load_flash_sector);
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, sizeof(pbm_header) - 1);
 
-	if(!string_match_cstr(&flash_sector_buffer, pbm_header))
+	if(!string_match_cstr(sector_buffer, pbm_header))
 	{
-		logf("display lcd: show picture: invalid image header: %s\n", string_to_cstr(&flash_sector_buffer));
+		logf("display lcd: show picture: invalid image header: %s\n", string_to_cstr(sector_buffer));
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
-	bitmap = (const uint8_t *)string_buffer(&flash_sector_buffer) + (sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, SPI_FLASH_SEC_SIZE);
+	bitmap = (const uint8_t *)string_buffer(sector_buffer) + (sizeof(pbm_header) - 1);
 
 	if(!send_byte(cmd_set_udg_ptr, false))
 		goto error;
@@ -653,12 +646,12 @@ bool display_lcd_layer_select(unsigned int layer)
 	}
 
 	if(!send_byte(cmd_clear_screen, false))
-		return(false);
+		goto error;
 
 	for(row = 0; row < 2; row++)
 	{
 		if(!send_byte(cmd_set_ram_ptr | (ram_offsets[row + 1] + 8), false))
-			return(false);
+			goto error;
 
 		msleep(2);
 
@@ -673,7 +666,7 @@ bool display_lcd_layer_select(unsigned int layer)
 	success = true;
 
 error:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	if(!text_goto(-1, -1))
 		return(false);
 
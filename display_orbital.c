@@ -524,12 +524,6 @@ bool display_orbital_picture_load(unsigned int picture_load_index)
 {
 	display_picture_load_flash_sector = (picture_load_index ? PICTURE_FLASH_OFFSET_1 : PICTURE_FLASH_OFFSET_0) / SPI_FLASH_SEC_SIZE;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		logf("display orbital: load picture: sector buffer too small: %u\n", flash_sector_buffer_use);
-		return(false);
-	}
-
 	return(true);
 }
 
@@ -541,6 +535,7 @@ bool display_orbital_layer_select(unsigned int layer)
 	unsigned int udg, udg_line, udg_bit, udg_value;
 	unsigned int byte_offset, bit_offset;
 	const uint8_t *bitmap;
+	string_t *sector_buffer;
 
 	if(layer == 0)
 	{
@@ -553,30 +548,28 @@ bool display_orbital_layer_select(unsigned int layer)
 
 	display_disable_text = true;
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache))
+	if(!(sector_buffer = flash_buffer_lease(fsb_display_picture)))
 	{
-		logf("display orbital: load picture: flash buffer not free, used by: %u\n", flash_sector_buffer_use);
+		log("display orbital: load picture: no sector buffer available\n");
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_display_picture;
-
-	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
 	{
 		logf("display orbital: load picture: failed to read sector: 0x%x\n", display_picture_load_flash_sector);
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, sizeof(pbm_header) - 1);
 
-	if(!string_match_cstr(&flash_sector_buffer, pbm_header))
+	if(!string_match_cstr(sector_buffer, pbm_header))
 	{
-		logf("display orbital: show picture: invalid image header: %s\n", string_to_cstr(&flash_sector_buffer));
+		logf("display orbital: show picture: invalid image header: %s\n", string_to_cstr(sector_buffer));
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
-	bitmap = (const uint8_t *)string_buffer(&flash_sector_buffer) + (sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, SPI_FLASH_SEC_SIZE);
+	bitmap = (const uint8_t *)string_buffer(sector_buffer) + (sizeof(pbm_header) - 1);
 
 	for(udg = 0; udg < 8; udg++)
 	{
@@ -621,7 +614,7 @@ bool display_orbital_layer_select(unsigned int layer)
 	success = true;
 
 error:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	if(!display_data_flush())
 		return(false);
 	if(!text_goto(-1, -1))
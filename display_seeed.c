@@ -502,12 +502,6 @@ bool display_seeed_picture_load(unsigned int picture_load_index)
 {
 	display_picture_load_flash_sector = (picture_load_index ? PICTURE_FLASH_OFFSET_1 : PICTURE_FLASH_OFFSET_0) / SPI_FLASH_SEC_SIZE;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		logf("display seeed: load picture: sector buffer too small: %u\n", flash_sector_buffer_use);
-		return(false);
-	}
-
 	return(true);
 }
 
@@ -517,6 +511,7 @@ bool display_seeed_layer_select(unsigned int layer)
 	bool success = false;
 	unsigned int row, column, output, bit, offset, bitoffset;
 	const uint8_t *bitmap;
+	string_t *sector_buffer;
 
 	if(layer == 0)
 	{
@@ -526,40 +521,38 @@ bool display_seeed_layer_select(unsigned int layer)
 
 	display_disable_text = true;
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache))
+	if(!(sector_buffer = flash_buffer_lease(fsb_display_picture)))
 	{
-		logf("display seeed: load picture: flash buffer not free, used by: %u\n", flash_sector_buffer_use);
+		log("display seeed: load picture: no sector buffer available\n");
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_display_picture;
-
-	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
 	{
 		logf("display seeed: load picture: failed to read sector: 0x%x\n", display_picture_load_flash_sector);
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, sizeof(pbm_header) - 1);
 
-	if(!string_match_cstr(&flash_sector_buffer, pbm_header))
+	if(!string_match_cstr(sector_buffer, pbm_header))
 	{
-		logf("display seeed: show picture: invalid image header: %s\n", string_to_cstr(&flash_sector_buffer));
+		logf("display seeed: show picture: invalid image header: %s\n", string_to_cstr(sector_buffer));
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
-	bitmap = (const uint8_t *)string_buffer(&flash_sector_buffer) + (sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, SPI_FLASH_SEC_SIZE);
+	bitmap = (const uint8_t *)string_buffer(sector_buffer) + (sizeof(pbm_header) - 1);
 
 	i2c_send2(display_address, reg_WorkingModeRegAddr, workmode_extra | workmode_ram | workmode_backlight_on | workmode_logo_off);
 
 	for(row = 0; row < (display_height / 8); row++)
 	{
 		if(!display_data_flush())
-			return(false);
+			goto error;
 
 		if(i2c_send3(display_address, reg_WriteRAM_XPosRegAddr, 0, row) != i2c_error_ok)
-			return(false);
+			goto error;
 
 		for(column = 0; column < display_width; column++)
 		{
@@ -577,14 +570,14 @@ bool display_seeed_layer_select(unsigned int layer)
 			}
 
 			if(!display_data_output(output))
-				return(false);
+				goto error;
 		}
 	}
 
 	success = true;
 
 error:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	if(!display_data_flush())
 		return(false);
 	if(i2c_send2(display_address, reg_WorkingModeRegAddr, workmode_extra | workmode_char | workmode_backlight_on | workmode_logo_off) != i2c_error_ok)
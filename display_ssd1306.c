@@ -585,12 +585,6 @@ bool display_ssd1306_picture_load(unsigned int picture_load_index)
 {
 	display_picture_load_flash_sector = (picture_load_index ? PICTURE_FLASH_OFFSET_1 : PICTURE_FLASH_OFFSET_0) / SPI_FLASH_SEC_SIZE;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		logf("display ssd1306: load picture: sector buffer too small: %u\n", flash_sector_buffer_use);
-		return(false);
-	}
-
 	return(true);
 }
 
@@ -600,6 +594,7 @@ bool display_ssd1306_layer_select(unsigned int layer)
 	bool success = false;
 	unsigned int row, column, output, bit, offset, bitoffset;
 	const uint8_t *bitmap;
+	string_t *sector_buffer;
 
 	if(layer == 0)
 	{
@@ -609,35 +604,33 @@ bool display_ssd1306_layer_select(unsigned int layer)
 
 	display_disable_text = true;
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache))
+	if(!(sector_buffer = flash_buffer_lease(fsb_display_picture)))
 	{
-		logf("display ssd1306: load picture: flash buffer not free, used by: %u\n", flash_sector_buffer_use);
+		log("display ssd1306: load picture: no sector buffer available\n");
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_display_picture;
-
-	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+	if(spi_flash_read(display_picture_load_flash_sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(sector_buffer), SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
 	{
 		logf("display ssd1306: load picture: failed to read sector: 0x%x\n", display_picture_load_flash_sector);
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, sizeof(pbm_header) - 1);
 
-	if(!string_match_cstr(&flash_sector_buffer, pbm_header))
+	if(!string_match_cstr(sector_buffer, pbm_header))
 	{
-		logf("display ssd1306: show picture: invalid image header: %s\n", string_to_cstr(&flash_sector_buffer));
+		logf("display ssd1306: show picture: invalid image header: %s\n", string_to_cstr(sector_buffer));
 		goto error;
 	}
 
-	string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
-	bitmap = (const uint8_t *)string_buffer(&flash_sector_buffer) + (sizeof(pbm_header) - 1);
+	string_setlength(sector_buffer, SPI_FLASH_SEC_SIZE);
+	bitmap = (const uint8_t *)string_buffer(sector_buffer) + (sizeof(pbm_header) - 1);
 
 	for(row = 0; row < (display_height / 8); row++)
 	{
 		if(!display_cursor_row_column(row, 0))
-			return(false);
+			goto error;
 
 		for(column = 0; column < display_width; column++)
 		{
@@ -655,14 +648,14 @@ bool display_ssd1306_layer_select(unsigned int layer)
 			}
 
 			if(!display_data_output(output))
-				return(false);
+				goto error;
 		}
 	}
 
 	success = true;
 
 error:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	if(!display_data_flush())
 		return(false);
 	return(success);
@@ -271,7 +271,7 @@ static void process(GenericSocket &channel, const std::string &send_string, std:
 void command_write(GenericSocket &channel, int fd,
 		uint64_t file_length, unsigned int start,
 		int flash_sector_size, int chunk_size,
-		bool verbose, action_t action, bool erase_before_write)
+		bool verbose, action_t action, bool erase_before_write, bool stream)
 {
 	int64_t file_offset;
 	unsigned char sector_buffer[flash_sector_size];
@@ -284,6 +284,8 @@ void command_write(GenericSocket &channel, int fd,
 	struct timeval time_start, time_now;
 	std::string sha_local_hash_text;
 	std::string sha_remote_hash_text;
+	std::string stream_hash_text;
+	int stream_same, stream_erased;
 	std::string send_string;
 	std::string reply;
 	std::string operation;
@@ -295,6 +297,11 @@ void command_write(GenericSocket &channel, int fd,
 
 	operation = action == action_simulate ? "simulate" : (action == action_verify ? "verify" : "write");
 
+	// streaming sends chunks tagged with their sector, the remote writes a sector as soon as it's complete
+
+	if(action != action_write)
+		stream = false;
+
 	std::cout << "start " << operation << ", at address: 0x" << std::hex << std::setw(6) << std::setfill('0') << start << ", length: " << std::dec << std::setw(0) << file_length
 			<< ", flash buffer size: " << flash_sector_size << ", chunk size: " << chunk_size << std::endl;
 
@@ -363,6 +370,10 @@ void command_write(GenericSocket &channel, int fd,
 
 		for(sector_attempt = max_attempts; sector_attempt > 0; sector_attempt--)
 		{
+			stream_hash_text.clear();
+			stream_same = 0;
+			stream_erased = 0;
+
 			if(verbose)
 				std::cout << "sending sector: " << (file_offset * 1.0 / flash_sector_size)
 					<< " (offset: " << file_offset << "), length: " << sector_length << ", try #" << (max_attempts - sector_attempt) << std::endl;
@@ -377,10 +388,31 @@ void command_write(GenericSocket &channel, int fd,
 							std::cout << "sending chunk: " << chunk_offset / chunk_size << " (offset " << (file_offset / flash_sector_size) - 1
 									<< " length: " << chunk_size << ", try #" << max_attempts - chunk_attempt << std::endl;
 
-						send_string = "flash-send " + std::to_string(chunk_offset) + " " + std::to_string(chunk_size) + " ";
-						send_string.append((const char *)&sector_buffer[chunk_offset], chunk_size);
+						if(stream)
+						{
+							send_string = "flash-stream " + std::to_string(current / flash_sector_size) + " " + std::to_string(chunk_offset) + " " + std::to_string(chunk_size) + " ";
+							send_string.append((const char *)&sector_buffer[chunk_offset], chunk_size);
+
+							process(channel, send_string, reply, "OK flash-stream: received bytes: ([0-9]+), at offset: ([0-9]+), sector: ([0-9]+), complete: (0|1)"
+									"(?:, same: (0|1), erased: (0|1), checksum: ([0-9a-f]+))?\\s*", string_value, int_value, verbose);
+
+							if(int_value[2] != (current / flash_sector_size))
+								throw(std::string("local sector (") + std::to_string(current / flash_sector_size) + ") != remote sector (" + std::to_string(int_value[2]) + ")");
 
-						process(channel, send_string, reply, "OK flash-send: received bytes: ([0-9]+), at offset: ([0-9]+)\\s*", string_value, int_value, verbose);
+							if(int_value[3] != 0)
+							{
+								stream_same = int_value[4];
+								stream_erased = int_value[5];
+								stream_hash_text = string_value[6];
+							}
+						}
+						else
+						{
+							send_string = "flash-send " + std::to_string(chunk_offset) + " " + std::to_string(chunk_size) + " ";
+							send_string.append((const char *)&sector_buffer[chunk_offset], chunk_size);
+
+							process(channel, send_string, reply, "OK flash-send: received bytes: ([0-9]+), at offset: ([0-9]+)\\s*", string_value, int_value, verbose);
+						}
 
 						if(int_value[0] != chunk_size)
 							throw(std::string("local chunk size (") + std::to_string(chunk_size) + ") != remote chunk size (" + std::to_string(int_value[0]) + ")");
@@ -447,10 +479,29 @@ void command_write(GenericSocket &channel, int fd,
 						if(verbose)
 							std::cout << "writing sector at 0x" << std::hex << std::setw(6) << std::setfill('0') << current << std::dec << std::setw(0) << std::endl;
 
-						send_string = std::string("flash-write ") + std::to_string(current);
-						process(channel, send_string, reply, "OK flash-write: written bytes: ([0-9]+), to address: ([0-9]+) \\([0-9]+\\), same: (0|1), erased: (0|1), checksum: ([0-9a-f]+)\\s*", string_value, int_value, verbose);
+						if(stream)
+						{
+							// the sector has been queued for writing when its last chunk arrived
+
+							if(stream_hash_text.empty())
+								throw(std::string("sector incomplete"));
+
+							int_value = { flash_sector_size, current, stream_same, stream_erased };
+							sha_remote_hash_text = stream_hash_text;
+						}
+						else
+						{
+							send_string = std::string("flash-write ") + std::to_string(current);
+
+							// let the remote erase the next sector in the background while we send it
+
+							if(!erase_before_write && (file_offset < (int64_t)file_length))
+								send_string += std::string(" ") + std::to_string(current + flash_sector_size);
 
-						sha_remote_hash_text = string_value[4];
+							process(channel, send_string, reply, "OK flash-write: written bytes: ([0-9]+), to address: ([0-9]+) \\([0-9]+\\), same: (0|1), erased: (0|1), checksum: ([0-9a-f]+)\\s*", string_value, int_value, verbose);
+
+							sha_remote_hash_text = string_value[4];
+						}
 
 						if(verbose)
 						{
@@ -878,6 +929,7 @@ int main(int argc, const char **argv)
 		bool otawrite = false;
 		bool use_force = false;
 		bool erase_before_write = false;
+		bool stream = false;
 		bool cmd_write = false;
 		bool cmd_simulate = false;
 		bool cmd_verify = false;
@@ -898,6 +950,7 @@ int main(int argc, const char **argv)
 			("noreset,N",	po::bool_switch(&noreset)->implicit_value(true),					"don't reset after commit")
 			("notemp,t",	po::bool_switch(&notemp)->implicit_value(true),						"don't commit temporarily, commit to flash")
 			("port,p",		po::value<std::string>(&port)->default_value("24"),					"port to connect to")
+			("stream,P",	po::bool_switch(&stream)->implicit_value(true),						"stream sectors, write while receiving the next sector (WRITE)")
 			("start,s",		po::value<std::string>(&start_string)->default_value("2147483647"),	"send/receive start address")
 			("read,R",		po::bool_switch(&cmd_read)->implicit_value(true),					"READ")
 			("simulate,S",	po::bool_switch(&cmd_simulate)->implicit_value(true),				"WRITE simulate")
@@ -1105,7 +1158,7 @@ int main(int argc, const char **argv)
 			case(action_simulate):
 			case(action_verify):
 			{
-				command_write(channel, fd, file_length, start, flash_sector_size, chunk_size, verbose, action, erase_before_write);
+				command_write(channel, fd, file_length, start, flash_sector_size, chunk_size, verbose, action, erase_before_write, stream);
 				break;
 			}
 
@@ -0,0 +1,208 @@
+#include "flash_job.h"
+
+#include "dispatch.h"
+#include "sys_time.h"
+#include "sys_string.h"
+#include "sdk.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum
+{
+	flash_job_queue_size = 8,
+	flash_job_verify_chunk = 64,
+};
+
+typedef struct
+{
+	flash_job_type_t		type;
+	unsigned int			address;
+	const void				*data;
+	unsigned int			length;
+	flash_job_callback_t	callback;
+	void					*context;
+	uint64_t				queued;
+} flash_job_t;
+
+static flash_job_t flash_job_queue[flash_job_queue_size];
+static unsigned int flash_job_queue_out;
+static unsigned int flash_job_queue_length;
+static bool flash_job_task_posted;
+
+static unsigned int flash_job_submitted;
+static unsigned int flash_job_done;
+static unsigned int flash_job_failed;
+static unsigned int flash_job_verify_failed;
+static unsigned int flash_job_queue_full;
+static unsigned int flash_job_queue_length_max;
+static unsigned int flash_job_latency_max;
+static uint64_t flash_job_latency_total;
+
+bool flash_job_submit(flash_job_type_t type, unsigned int address, const void *data, unsigned int length,
+		flash_job_callback_t callback, void *context)
+{
+	flash_job_t *job;
+
+	if(flash_job_queue_length >= flash_job_queue_size)
+	{
+		flash_job_queue_full++;
+		return(false);
+	}
+
+	if((type != flash_job_erase) && (((uint32_t)data & 0x03) || (address & 0x03) || (length & 0x03)))
+	{
+		logf("flash job: unaligned write: %x %u\n", address, length);
+		return(false);
+	}
+
+	job = &flash_job_queue[(flash_job_queue_out + flash_job_queue_length) % flash_job_queue_size];
+
+	job->type = type;
+	job->address = address;
+	job->data = data;
+	job->length = length;
+	job->callback = callback;
+	job->context = context;
+	job->queued = time_get_us();
+
+	flash_job_queue_length++;
+	flash_job_kick();
+
+	if(flash_job_queue_length > flash_job_queue_length_max)
+		flash_job_queue_length_max = flash_job_queue_length;
+
+	flash_job_submitted++;
+
+	return(true);
+}
+
+// read back what has just been written, in small chunks to keep the stack usage low
+
+static bool flash_job_verify(unsigned int address, const void *data, unsigned int length)
+{
+	uint32_t chunk[flash_job_verify_chunk / sizeof(uint32_t)];
+	unsigned int offset, size;
+
+	for(offset = 0; offset < length; offset += size)
+	{
+		size = length - offset;
+
+		if(size > sizeof(chunk))
+			size = sizeof(chunk);
+
+		if(spi_flash_read(address + offset, chunk, size) != SPI_FLASH_RESULT_OK)
+			return(false);
+
+		if(memcmp(chunk, (const uint8_t *)data + offset, size))
+			return(false);
+	}
+
+	return(true);
+}
+
+static void flash_job_execute(void)
+{
+	flash_job_t job;
+	bool success;
+	unsigned int latency;
+
+	if(flash_job_queue_length == 0)
+		return;
+
+	job = flash_job_queue[flash_job_queue_out];
+	flash_job_queue_out = (flash_job_queue_out + 1) % flash_job_queue_size;
+	flash_job_queue_length--;
+
+	success = true;
+
+	if((job.type == flash_job_erase) || (job.type == flash_job_erase_write))
+		if(spi_flash_erase_sector(job.address / SPI_FLASH_SEC_SIZE) != SPI_FLASH_RESULT_OK)
+			success = false;
+
+	if(success && ((job.type == flash_job_write) || (job.type == flash_job_erase_write)))
+		if(spi_flash_write(job.address, job.data, job.length) != SPI_FLASH_RESULT_OK)
+			success = false;
+
+	if(success && ((job.type == flash_job_write) || (job.type == flash_job_erase_write)) && !flash_job_verify(job.address, job.data, job.length))
+	{
+		flash_job_verify_failed++;
+		success = false;
+	}
+
+	latency = time_get_us() - job.queued;
+
+	if(latency > flash_job_latency_max)
+		flash_job_latency_max = latency;
+
+	flash_job_latency_total += latency;
+	flash_job_done++;
+
+	if(!success)
+	{
+		logf("flash job: %s failed at %x\n", (job.type == flash_job_erase) ? "erase" : "write", job.address);
+		flash_job_failed++;
+	}
+
+	if(job.callback)
+		job.callback(success, job.address, job.context);
+}
+
+void flash_job_run(void)
+{
+	flash_job_task_posted = false;
+
+	flash_job_execute();
+	flash_job_kick();
+}
+
+// post the task if there are jobs and it isn't posted yet, when the task queue is full,
+// the slow timer calls this again, so the queue never stalls
+
+void flash_job_kick(void)
+{
+	if((flash_job_queue_length > 0) && !flash_job_task_posted)
+		flash_job_task_posted = dispatch_post_task(2, task_flash_job, 0);
+}
+
+// complete all queued jobs now, for users that need the result in flash (read back, checksum, reset)
+
+void flash_job_flush(void)
+{
+	while(flash_job_queue_length > 0)
+	{
+		system_soft_wdt_feed();
+		flash_job_execute();
+	}
+}
+
+unsigned int flash_job_pending(void)
+{
+	return(flash_job_queue_length);
+}
+
+bool flash_job_pending_sector(unsigned int sector)
+{
+	unsigned int current;
+	const flash_job_t *job;
+
+	for(current = 0; current < flash_job_queue_length; current++)
+	{
+		job = &flash_job_queue[(flash_job_queue_out + current) % flash_job_queue_size];
+
+		if((job->address / SPI_FLASH_SEC_SIZE) == sector)
+			return(true);
+	}
+
+	return(false);
+}
+
+void flash_job_stats(string_t *dst)
+{
+	string_format(dst, ">  submitted: %u, done: %u, failed: %u (verify: %u), queue full: %u\n",
+			flash_job_submitted, flash_job_done, flash_job_failed, flash_job_verify_failed, flash_job_queue_full);
+	string_format(dst, ">  queue depth: %u, max: %u, latency avg: %u us, max: %u us\n",
+			flash_job_queue_length, flash_job_queue_length_max,
+			flash_job_done ? (unsigned int)(flash_job_latency_total / flash_job_done) : 0,
+			flash_job_latency_max);
+}
@@ -0,0 +1,31 @@
+#ifndef flash_job_h
+#define flash_job_h
+
+#include "util.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// queue of flash erase and write jobs, executed one job at a time from a low priority task,
+// so higher priority tasks (uart bridge, commands) run in between; the data of a write job must remain
+// valid (and 4 byte aligned) until the completion callback has been called, written data is read back
+// and compared before the job is reported successful
+
+typedef enum
+{
+	flash_job_erase,
+	flash_job_write,
+	flash_job_erase_write,
+} flash_job_type_t;
+
+typedef void (*flash_job_callback_t)(bool success, unsigned int address, void *context);
+
+bool			flash_job_submit(flash_job_type_t type, unsigned int address, const void *data, unsigned int length,
+						flash_job_callback_t callback, void *context);
+void			flash_job_run(void);
+void			flash_job_kick(void);
+void			flash_job_flush(void);
+unsigned int	flash_job_pending(void);
+bool			flash_job_pending_sector(unsigned int sector);
+void			flash_job_stats(string_t *dst);
+#endif
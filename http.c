@@ -458,19 +458,19 @@ static app_action_t handler_resetwlan(const string_t *src, string_t *dst)
 	if(!config_open_write())
 		goto config_error;
 
-	if(!config_set_string("wlan.client.ssid", string_to_cstr(&ssid), -1, -1))
+	if(!config_set_string(config_key_wlan_client_ssid, string_to_cstr(&ssid), -1, -1))
 	{
 		config_abort_write();
 		goto config_error;
 	}
 
-	if(!config_set_string("wlan.client.passwd", string_to_cstr(&passwd), -1, -1))
+	if(!config_set_string(config_key_wlan_client_passwd, string_to_cstr(&passwd), -1, -1))
 	{
 		config_abort_write();
 		goto config_error;
 	}
 
-	if(!config_set_int("wlan.mode", config_wlan_mode_client, -1, -1))
+	if(!config_set_int(config_key_wlan_mode, config_wlan_mode_client, -1, -1))
 	{
 		config_abort_write();
 		goto config_error;
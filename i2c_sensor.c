@@ -10,6 +10,25 @@
 
 static i2c_sensor_device_data_t device_data[i2c_sensor_size];
 
+enum
+{
+	calibration_cache_size = 16,
+};
+
+static config_cache_slot_t calibration_factor_slots[calibration_cache_size];
+static config_cache_slot_t calibration_offset_slots[calibration_cache_size];
+static config_cache_t calibration_factor;
+static config_cache_t calibration_offset;
+
+static void calibration_cache_init(void)
+{
+	if(calibration_factor.slots)
+		return;
+
+	config_cache_register(&calibration_factor, calibration_factor_slots, calibration_cache_size, config_key_i2s_factor, false, 1000);
+	config_cache_register(&calibration_offset, calibration_offset_slots, calibration_cache_size, config_key_i2s_offset, false, 0);
+}
+
 static void sensor_register(int bus, i2c_sensor_t sensor_id)
 {
 	if(sensor_id >= i2c_sensor_size)
@@ -4867,6 +4886,7 @@ bool i2c_sensors_init(void)
 	{
 		sensor_info.init_started_us = time_get_us();
 		sensor_info.init_started = 1;
+		calibration_cache_init();
 	}
 
 	if(sensor_info.init_finished)
@@ -5014,6 +5034,10 @@ bool i2c_sensor_read(string_t *dst, int bus, i2c_sensor_t sensor, bool verbose,
 
 	error = i2c_error_ok;
 
+	calibration_cache_init();
+	int_factor = config_cache_int(&calibration_factor, bus, sensor);
+	int_offset = config_cache_int(&calibration_offset, bus, sensor);
+
 	if(html)
 		string_format(dst, "%d</td><td align=\"right\">%u</td><td align=\"right\">0x%02x</td><td>%s</td><td>%s</td>", bus, sensor, entry->address, entry->name, entry->type);
 	else
@@ -5021,12 +5045,6 @@ bool i2c_sensor_read(string_t *dst, int bus, i2c_sensor_t sensor, bool verbose,
 
 	if((error = entry->read_fn(bus, entry, &value, &device_data[current])) == i2c_error_ok)
 	{
-		if(!config_get_int("i2s.%u.%u.factor", &int_factor, bus, sensor))
-			int_factor = 1000;
-
-		if(!config_get_int("i2s.%u.%u.offset", &int_offset, bus, sensor))
-			int_offset = 0;
-
 		extracooked = (value.cooked * int_factor / 1000.0) + (int_offset / 1000.0);
 
 		if(html)
@@ -5049,15 +5067,7 @@ bool i2c_sensor_read(string_t *dst, int bus, i2c_sensor_t sensor, bool verbose,
 	}
 
 	if(verbose)
-	{
-		if(!config_get_int("i2s.%u.%u.factor", &int_factor, bus, sensor))
-			int_factor = 1000;
-
-		if(!config_get_int("i2s.%u.%u.offset", &int_offset, bus, sensor))
-			int_offset = 0;
-
 		string_format(dst, ", calibration: factor = %4f, offset = %4f", int_factor / 1000.0, int_offset / 1000.0);
-	}
 
 	i2c_select_bus(0);
 	return(true);
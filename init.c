@@ -36,6 +36,7 @@ static const partition_item_t partition_items[] =
 	{	SYSTEM_PARTITION_CUSTOMER_BEGIN + 8,	PICTURE_FLASH_OFFSET_1,		PICTURE_FLASH_SIZE,		},
 	{	SYSTEM_PARTITION_CUSTOMER_BEGIN + 9,	FONT_FLASH_OFFSET_0,		FONT_FLASH_SIZE,		},
 	{	SYSTEM_PARTITION_CUSTOMER_BEGIN + 10,	FONT_FLASH_OFFSET_1,		FONT_FLASH_SIZE,		},
+	{	SYSTEM_PARTITION_CUSTOMER_BEGIN + 11,	USER_CONFIG_LOG_SECTOR * 0x1000,	USER_CONFIG_LOG_SECTORS * 0x1000,	},
 #endif
 };
 
@@ -173,7 +174,7 @@ bool wlan_init_from_config(void)
 	string_new(, password, 64);
 	unsigned int channel;
 
-	if(config_get_uint("wlan.mode", &mode_int, -1, -1))
+	if(config_get_uint(config_key_wlan_mode, &mode_int, -1, -1))
 		mode = (config_wlan_mode_t)mode_int;
 	else
 		mode = config_wlan_mode_client;
@@ -184,8 +185,8 @@ bool wlan_init_from_config(void)
 	{
 		case(config_wlan_mode_client):
 		{
-			if(!config_get_string("wlan.client.ssid", &ssid, -1, -1) ||
-					!config_get_string("wlan.client.passwd", &password, -1, -1))
+			if(!config_get_string(config_key_wlan_client_ssid, &ssid, -1, -1) ||
+					!config_get_string(config_key_wlan_client_passwd, &password, -1, -1))
 				return(false);
 
 			break;
@@ -193,9 +194,9 @@ bool wlan_init_from_config(void)
 
 		case(config_wlan_mode_ap):
 		{
-			if(!config_get_string("wlan.ap.ssid", &ssid, -1, -1) ||
-					!config_get_string("wlan.ap.passwd", &password, -1, -1) ||
-					!config_get_uint("wlan.ap.channel", &channel, -1, -1))
+			if(!config_get_string(config_key_wlan_ap_ssid, &ssid, -1, -1) ||
+					!config_get_string(config_key_wlan_ap_passwd, &password, -1, -1) ||
+					!config_get_uint(config_key_wlan_ap_channel, &channel, -1, -1))
 				return(false);
 
 			break;
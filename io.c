@@ -42,6 +42,28 @@ roflash static const io_flag_name_t io_flag_names[] =
 
 io_config_pin_entry_t io_config[io_id_size][max_pins_per_io];
 
+// pins that need work in the fast tick, grouped per mode, rebuilt whenever a pin mode changes
+
+typedef enum
+{
+	io_fast_list_timer,
+	io_fast_list_rotary_encoder,
+	io_fast_list_trigger,
+	io_fast_list_pwm,
+	io_fast_list_size,
+} io_fast_list_t;
+
+typedef struct
+{
+	uint8_t io;
+	uint8_t pin;
+} io_fast_pin_t;
+
+assert_size(io_fast_pin_t, 2);
+
+static io_fast_pin_t io_fast_pins[io_id_size * max_pins_per_io];
+static unsigned int io_fast_list_start[io_fast_list_size + 1];
+
 roflash static const io_info_t io_info =
 {
 	{
@@ -59,7 +81,8 @@ roflash static const io_info_t io_info =
 			caps_ledpixel |
 			caps_pullup |
 			caps_rotary_encoder |
-			caps_spi,
+			caps_spi |
+			caps_frequency,
 		"Internal GPIO",
 		io_gpio_init,
 		(void *)0, // postinit
@@ -71,6 +94,7 @@ roflash static const io_info_t io_info =
 		io_gpio_read_pin,
 		io_gpio_write_pin,
 		(void *)0, // set_mask
+		io_gpio_flush,
 	},
 	{
 		io_id_aux,/* = 1 */
@@ -92,6 +116,7 @@ roflash static const io_info_t io_info =
 		io_aux_read_pin,
 		io_aux_write_pin,
 		(void *)0, // set_mask
+		(void *)0, // flush
 	},
 	{
 		io_id_mcp_20, /* = 2 */
@@ -104,7 +129,7 @@ roflash static const io_info_t io_info =
 			caps_pullup,
 		"MCP23017 I2C I/O expander #1",
 		io_mcp_init,
-		(void *)0, // postinit
+		io_mcp_post_init,
 		io_mcp_pin_max_value,
 		io_mcp_periodic_slow,
 		(void *)0, // periodic fast
@@ -113,6 +138,7 @@ roflash static const io_info_t io_info =
 		io_mcp_read_pin,
 		io_mcp_write_pin,
 		io_mcp_set_mask,
+		io_mcp_flush,
 	},
 	{
 		io_id_mcp_21, /* = 3 */
@@ -125,7 +151,7 @@ roflash static const io_info_t io_info =
 			caps_pullup,
 		"MCP23017 I2C I/O expander #2",
 		io_mcp_init,
-		(void *)0, // postinit
+		io_mcp_post_init,
 		io_mcp_pin_max_value,
 		io_mcp_periodic_slow,
 		(void *)0, // periodic fast
@@ -134,6 +160,7 @@ roflash static const io_info_t io_info =
 		io_mcp_read_pin,
 		io_mcp_write_pin,
 		io_mcp_set_mask,
+		io_mcp_flush,
 	},
 	{
 		io_id_mcp_22, /* = 4 */
@@ -146,7 +173,7 @@ roflash static const io_info_t io_info =
 			caps_pullup,
 		"MCP23017 I2C I/O expander #3",
 		io_mcp_init,
-		(void *)0, // postinit
+		io_mcp_post_init,
 		io_mcp_pin_max_value,
 		io_mcp_periodic_slow,
 		(void *)0, // periodic fast
@@ -155,6 +182,7 @@ roflash static const io_info_t io_info =
 		io_mcp_read_pin,
 		io_mcp_write_pin,
 		io_mcp_set_mask,
+		io_mcp_flush,
 	},
 	{
 		io_id_pcf_3a, /* = 5 */
@@ -173,7 +201,8 @@ roflash static const io_info_t io_info =
 		(void *)0, // get pin info
 		io_pcf_read_pin,
 		io_pcf_write_pin,
-		io_mcp_set_mask,
+		io_pcf_set_mask,
+		io_pcf_flush,
 	},
 	{
 		io_id_ledpixel, /* = 6 */
@@ -185,13 +214,14 @@ roflash static const io_info_t io_info =
 		io_ledpixel_init,
 		io_ledpixel_post_init,
 		io_ledpixel_pin_max_value,
-		(void *)0, // periodic slow
+		io_ledpixel_periodic_slow,
 		(void *)0, // periodic fast
 		io_ledpixel_init_pin_mode,
 		(void *)0, // get pin info
 		io_ledpixel_read_pin,
 		io_ledpixel_write_pin,
 		(void *)0, // set_mask
+		io_ledpixel_flush,
 	}
 };
 
@@ -224,6 +254,7 @@ roflash static const io_mode_trait_t io_mode_traits[io_pin_size] =
 	{ io_pin_output_pwm2,		"pwm2",			"secondary pwm output"	},
 	{ io_pin_rotary_encoder,	"renc",			"rotary encoder input"	},
 	{ io_pin_spi,				"spi",			"spi"					},
+	{ io_pin_frequency,			"freq",			"frequency meter"		},
 };
 
 static io_pin_mode_t io_mode_from_string(const string_t *src)
@@ -302,6 +333,7 @@ roflash static const io_ll_mode_trait_t io_ll_mode_traits[io_pin_ll_size] =
 	{ io_pin_ll_uart,				"uart"				},
 	{ io_pin_ll_output_pwm2,		"pwm2 output"		},
 	{ io_pin_ll_spi,				"spi"				},
+	{ io_pin_ll_frequency,			"frequency"			},
 };
 
 void io_string_from_ll_mode(string_t *name, io_pin_ll_mode_t mode, int pad)
@@ -309,7 +341,7 @@ void io_string_from_ll_mode(string_t *name, io_pin_ll_mode_t mode, int pad)
 	unsigned int ix;
 	const io_ll_mode_trait_t *entry;
 
-	for(ix = 0; ix < io_pin_size; ix++)
+	for(ix = 0; ix < io_pin_ll_size; ix++)
 	{
 		entry = &io_ll_mode_traits[ix];
 
@@ -630,6 +662,7 @@ static io_error_t io_write_pin_x(string_t *errormsg, const io_info_entry_t *info
 		case(io_pin_ledpixel):
 		case(io_pin_cfa634):
 		case(io_pin_spi):
+		case(io_pin_frequency):
 		{
 			if(errormsg)
 				string_append(errormsg, "cannot write to this pin");
@@ -989,6 +1022,221 @@ unsigned int io_pin_max_value(unsigned int io, unsigned int pin)
 	return(io_pin_max_value_x(info, pin_data, pin_config, pin));
 }
 
+// fade engine: a pwm pin moves from its current value to a target value in a given time, the value is
+// interpolated every fade step, either linearly or on a gamma 2.2 curve (perceptually even for leds);
+// all pins are updated in one io batch per step, so all pwm1 pins together cause only one new phase set
+
+enum
+{
+	io_fade_size = 8,
+	ms_per_fade_step = 5,
+	io_fade_gamma_steps = 32,
+};
+
+typedef enum
+{
+	io_fade_curve_gamma,
+	io_fade_curve_linear,
+} io_fade_curve_t;
+
+typedef struct
+{
+	uint8_t		active;
+	uint8_t		io;
+	uint8_t		pin;
+	uint8_t		curve;
+	uint32_t	to;
+	uint32_t	level_from;		// start and end of the interpolation, output values for linear, perceptual levels for gamma
+	uint32_t	level_to;
+	uint32_t	max_value;
+	uint32_t	start_ms;
+	uint32_t	duration_ms;
+} io_fade_t;
+
+assert_size(io_fade_t, 28);
+
+// (x / 32) ^ 2.2 * 65535
+
+roflash static const uint16_t io_fade_gamma[io_fade_gamma_steps + 1] =
+{
+	0, 32, 147, 359, 676, 1104, 1648, 2314, 3104, 4022, 5072, 6255, 7574, 9033, 10632, 12375,
+	14263, 16298, 18482, 20816, 23303, 25943, 28739, 31692, 34802, 38072, 41503, 45097, 48853, 52774, 56860, 61114,
+	65535,
+};
+
+static io_fade_t io_fades[io_fade_size];
+static os_timer_t io_fade_timer;
+static bool io_fade_timer_running;
+
+// perceptual level (0-65535) to output fraction (0-65535)
+
+attr_pure static unsigned int io_fade_gamma_apply(unsigned int level)
+{
+	unsigned int index = level >> 11;
+	unsigned int fraction = level & 0x07ff;
+	unsigned int low, high;
+
+	if(index >= io_fade_gamma_steps)
+		return(io_fade_gamma[io_fade_gamma_steps]);
+
+	low = io_fade_gamma[index];
+	high = io_fade_gamma[index + 1];
+
+	return(low + (((high - low) * fraction) >> 11));
+}
+
+attr_pure static unsigned int io_fade_gamma_inverse(unsigned int output)
+{
+	unsigned int low = 0, high = 65535, mid;
+
+	while(low < high)
+	{
+		mid = (low + high) / 2;
+
+		if(io_fade_gamma_apply(mid) < output)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return(low);
+}
+
+static void io_fade_cancel(unsigned int io, unsigned int pin)
+{
+	unsigned int ix;
+
+	for(ix = 0; ix < io_fade_size; ix++)
+		if(io_fades[ix].active && (io_fades[ix].io == io) && (io_fades[ix].pin == pin))
+			io_fades[ix].active = 0;
+}
+
+static void io_fade_step(void *arg)
+{
+	const io_info_entry_t *info;
+	io_fade_t *fade;
+	unsigned int ix, value, active;
+	uint32_t now_ms, elapsed;
+
+	now_ms = (uint32_t)(time_get_us() / 1000);
+	active = 0;
+
+	io_batch_begin();
+
+	for(ix = 0; ix < io_fade_size; ix++)
+	{
+		fade = &io_fades[ix];
+
+		if(!fade->active)
+			continue;
+
+		info = &io_info[fade->io];
+		elapsed = now_ms - fade->start_ms;
+
+		if(elapsed >= fade->duration_ms)
+		{
+			value = fade->to;
+			fade->active = 0;
+		}
+		else
+		{
+			if(fade->level_to >= fade->level_from)
+				value = fade->level_from + (((uint64_t)(fade->level_to - fade->level_from) * elapsed) / fade->duration_ms);
+			else
+				value = fade->level_from - (((uint64_t)(fade->level_from - fade->level_to) * elapsed) / fade->duration_ms);
+
+			if(fade->curve == io_fade_curve_gamma)
+				value = ((uint64_t)io_fade_gamma_apply(value) * fade->max_value) / 65535;
+
+			active++;
+		}
+
+		info->write_pin_fn((string_t *)0, info, &io_data[fade->io].pin[fade->pin], &io_config[fade->io][fade->pin], fade->pin, value);
+	}
+
+	io_batch_end((string_t *)0);
+
+	if(active == 0)
+	{
+		os_timer_disarm(&io_fade_timer);
+		io_fade_timer_running = false;
+	}
+}
+
+static io_error_t io_fade_start(string_t *error, unsigned int io, unsigned int pin, unsigned int to, unsigned int duration_ms, io_fade_curve_t curve)
+{
+	const io_info_entry_t *info = &io_info[io];
+	io_config_pin_entry_t *pin_config = &io_config[io][pin];
+	io_data_pin_entry_t *pin_data = &io_data[io].pin[pin];
+	unsigned int ix, from, max_value;
+	io_fade_t *fade;
+
+	if((pin_config->mode != io_pin_output_pwm1) && (pin_config->mode != io_pin_output_pwm2))
+	{
+		string_append(error, "pin is not a pwm output\n");
+		return(io_error);
+	}
+
+	if(info->read_pin_fn(error, info, pin_data, pin_config, pin, &from) != io_ok)
+		return(io_error);
+
+	max_value = io_pin_max_value(io, pin);
+
+	if(to > max_value)
+		to = max_value;
+
+	io_fade_cancel(io, pin);
+
+	for(ix = 0; ix < io_fade_size; ix++)
+		if(!io_fades[ix].active)
+			break;
+
+	if(ix >= io_fade_size)
+	{
+		string_format(error, "too many fades active (%u)\n", (unsigned int)io_fade_size);
+		return(io_error);
+	}
+
+	// the fade takes over from a running ramp
+
+	pin_data->direction = io_dir_none;
+	pin_data->speed = 0;
+
+	fade = &io_fades[ix];
+	fade->io = io;
+	fade->pin = pin;
+	fade->curve = curve;
+	fade->to = to;
+	fade->max_value = max_value;
+
+	// the inverse gamma is a binary search, do it once here instead of on every step
+
+	if((curve == io_fade_curve_gamma) && (max_value > 0))
+	{
+		fade->level_from = io_fade_gamma_inverse(((uint64_t)from * 65535) / max_value);
+		fade->level_to = io_fade_gamma_inverse(((uint64_t)to * 65535) / max_value);
+	}
+	else
+	{
+		fade->curve = io_fade_curve_linear;
+		fade->level_from = from;
+		fade->level_to = to;
+	}
+	fade->start_ms = (uint32_t)(time_get_us() / 1000);
+	fade->duration_ms = duration_ms > 0 ? duration_ms : 1;
+	fade->active = 1;
+
+	if(!io_fade_timer_running)
+	{
+		os_timer_disarm(&io_fade_timer);
+		os_timer_setfn(&io_fade_timer, io_fade_step, (void *)0);
+		os_timer_arm(&io_fade_timer, ms_per_fade_step, 1);
+		io_fade_timer_running = true;
+	}
+
+	return(io_ok);
+}
+
 io_error_t io_read_pin(string_t *error_msg, unsigned int io, unsigned int pin, unsigned int *value)
 {
 	const io_info_entry_t *info;
@@ -1054,6 +1302,8 @@ io_error_t io_write_pin(string_t *error, unsigned int io, unsigned int pin, unsi
 	pin_config = &io_config[io][pin];
 	pin_data = &data->pin[pin];
 
+	io_fade_cancel(io, pin);
+
 	return(io_write_pin_x(error, info, pin_data, pin_config, pin, value));
 }
 
@@ -1079,6 +1329,7 @@ io_error_t io_trigger_pin(string_t *error, unsigned int io, unsigned int pin, io
 	io_data_entry_t *data;
 	io_config_pin_entry_t *pin_config;
 	io_data_pin_entry_t *pin_data;
+	io_error_t rv;
 
 	if(io >= io_id_size)
 	{
@@ -1100,7 +1351,81 @@ io_error_t io_trigger_pin(string_t *error, unsigned int io, unsigned int pin, io
 	pin_config = &io_config[io][pin];
 	pin_data = &data->pin[pin];
 
-	return(io_trigger_pin_x(error, info, pin_data, pin_config, pin, trigger_type));
+	io_fade_cancel(io, pin);
+
+	// a trigger pin can fire two other pins, make them go out together
+
+	io_batch_begin();
+
+	rv = io_trigger_pin_x(error, info, pin_data, pin_config, pin, trigger_type);
+
+	if(io_batch_end(error) != io_ok)
+		rv = io_error;
+
+	return(rv);
+}
+
+// called from a task posted by the gpio interrupt handler when the expanders' INT line is asserted
+
+void io_expander_interrupt(void)
+{
+	unsigned int io;
+
+	stat_io_expander_interrupts_serviced++;
+
+	for(io = io_id_mcp_20; io <= io_id_mcp_22; io++)
+		if(io_data[io].detected)
+			io_mcp_interrupt(io, &io_info[io], &io_data[io]);
+}
+
+// writes to i2c expanders issued between io_batch_begin and io_batch_end only update the
+// shadow registers, they're sent out with one bus transaction per bank when the outermost batch ends;
+// only the outermost io_batch_end can fail, the changes that weren't written stay pending for the next flush
+
+static unsigned int io_batch_depth;
+
+void io_batch_begin(void)
+{
+	io_batch_depth++;
+}
+
+io_error_t io_batch_end(string_t *error)
+{
+	if(io_batch_depth == 0)
+		return(io_ok);
+
+	if(--io_batch_depth > 0)
+		return(io_ok);
+
+	if(io_flush(error) != io_ok)
+	{
+		stat_io_expander_flushes_failed++;
+		return(io_error);
+	}
+
+	return(io_ok);
+}
+
+bool io_batch_active(void)
+{
+	return(io_batch_depth > 0);
+}
+
+io_error_t io_flush(string_t *error)
+{
+	const io_info_entry_t *info;
+	unsigned int io;
+	io_error_t rv = io_ok;
+
+	for(io = 0; io < io_id_size; io++)
+	{
+		info = &io_info[io];
+
+		if(io_data[io].detected && info->flush_fn && (info->flush_fn(error, info) != io_ok))
+			rv = io_error;
+	}
+
+	return(rv);
 }
 
 io_error_t io_traits(string_t *errormsg, unsigned int io, unsigned int pin, io_pin_mode_t *pinmode, unsigned int *lower_bound, unsigned int *upper_bound, int *step, unsigned int *value)
@@ -1178,6 +1503,41 @@ io_error_t io_traits(string_t *errormsg, unsigned int io, unsigned int pin, io_p
 	return(io_ok);
 }
 
+static void io_fast_lists_rebuild(void)
+{
+	io_fast_list_t list;
+	io_pin_mode_t mode;
+	unsigned int io, pin, entry;
+
+	for(list = 0, entry = 0; list < io_fast_list_size; list++)
+	{
+		io_fast_list_start[list] = entry;
+
+		for(io = 0; io < io_id_size; io++)
+		{
+			if(!io_data[io].detected)
+				continue;
+
+			for(pin = 0; pin < io_info[io].pins; pin++)
+			{
+				mode = io_config[io][pin].mode;
+
+				if(((list == io_fast_list_timer) && (mode == io_pin_timer)) ||
+						((list == io_fast_list_rotary_encoder) && (mode == io_pin_rotary_encoder)) ||
+						((list == io_fast_list_trigger) && (mode == io_pin_trigger)) ||
+						((list == io_fast_list_pwm) && ((mode == io_pin_output_pwm1) || (mode == io_pin_output_pwm2))))
+				{
+					io_fast_pins[entry].io = io;
+					io_fast_pins[entry].pin = pin;
+					entry++;
+				}
+			}
+		}
+	}
+
+	io_fast_list_start[io_fast_list_size] = entry;
+}
+
 void io_init(void)
 {
 	string_new(, error, 32);
@@ -1214,7 +1574,7 @@ void io_init(void)
 
 			pin_config = &io_config[io][pin];
 
-			if(!config_get_uint("io.%u.%u.mode", &mode, io, pin))
+			if(!config_get_uint(config_key_io_mode, &mode, io, pin))
 			{
 				if((io == 0) && (pin == 1))
 				{
@@ -1229,7 +1589,7 @@ void io_init(void)
 				}
 			}
 
-			if(!config_get_uint("io.%u.%u.llmode", &llmode, io, pin))
+			if(!config_get_uint(config_key_io_llmode, &llmode, io, pin))
 			{
 				if((io == 0) && (pin == 1))
 				{
@@ -1244,7 +1604,7 @@ void io_init(void)
 				}
 			}
 
-			if(!config_get_uint("io.%u.%u.flags", &flags.intvalue, io, pin))
+			if(!config_get_uint(config_key_io_flags, &flags.intvalue, io, pin))
 				flags.intvalue = 0;
 
 			pin_config->flags = flags.io_pin_flags;
@@ -1256,7 +1616,7 @@ void io_init(void)
 			{
 				case(io_pin_counter):
 				{
-					if(!config_get_uint("io.%u.%u.counter.debounce", &debounce, io, pin))
+					if(!config_get_uint(config_key_io_counter_debounce, &debounce, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1273,7 +1633,7 @@ void io_init(void)
 					unsigned int pin_type;
 					int remote_index;
 
-					if(!config_get_uint("io.%u.%u.renc.debounce", &debounce, io, pin) || !config_get_uint("io.%u.%u.renc.pintype", &pin_type, io, pin))
+					if(!config_get_uint(config_key_io_renc_debounce, &debounce, io, pin) || !config_get_uint(config_key_io_renc_pintype, &pin_type, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1297,13 +1657,13 @@ void io_init(void)
 						}
 					}
 
-					if(config_get_int("io.%u.%u.renc.trigger_pin.io", &trigger_io, io, pin) &&
-						config_get_int("io.%u.%u.renc.trigger_pin.pin", &trigger_pin, io, pin))
+					if(config_get_int(config_key_io_renc_trigger_pin_io, &trigger_io, io, pin) &&
+						config_get_int(config_key_io_renc_trigger_pin_pin, &trigger_pin, io, pin))
 					{
 						pin_config->shared.renc.trigger_pin.io = trigger_io;
 						pin_config->shared.renc.trigger_pin.pin = trigger_pin;
 
-						if(config_get_int("io.%u.%u.renc.remote", &remote_index, io, pin))
+						if(config_get_int(config_key_io_renc_remote, &remote_index, io, pin))
 							pin_config->shared.renc.trigger_pin.remote = remote_index;
 						else
 							pin_config->shared.renc.trigger_pin.remote = -1;
@@ -1330,7 +1690,7 @@ void io_init(void)
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.trigger.debounce", &debounce, io, pin))
+					if(!config_get_uint(config_key_io_trigger_debounce, &debounce, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1346,27 +1706,27 @@ void io_init(void)
 						pin_config->shared.trigger[trigger].action = io_trigger_none;
 					}
 
-					if(config_get_int("io.%u.%u.trigger.io", &trigger_io, io, pin) &&
-						config_get_int("io.%u.%u.trigger.pin", &trigger_pin, io, pin) &&
-						config_get_int("io.%u.%u.trigger.type", &trigger_type, io, pin))
+					if(config_get_int(config_key_io_trigger_io, &trigger_io, io, pin) &&
+						config_get_int(config_key_io_trigger_pin, &trigger_pin, io, pin) &&
+						config_get_int(config_key_io_trigger_type, &trigger_type, io, pin))
 					{
 						pin_config->shared.trigger[0].io.io = trigger_io;
 						pin_config->shared.trigger[0].io.pin = trigger_pin;
 						pin_config->shared.trigger[0].action = trigger_type;
 					}
 
-					if(config_get_int("io.%u.%u.trigger.0.io", &trigger_io, io, pin) &&
-						config_get_int("io.%u.%u.trigger.0.pin", &trigger_pin, io, pin) &&
-						config_get_int("io.%u.%u.trigger.0.type", &trigger_type, io, pin))
+					if(config_get_int(config_key_io_trigger_0_io, &trigger_io, io, pin) &&
+						config_get_int(config_key_io_trigger_0_pin, &trigger_pin, io, pin) &&
+						config_get_int(config_key_io_trigger_0_type, &trigger_type, io, pin))
 					{
 						pin_config->shared.trigger[0].io.io = trigger_io;
 						pin_config->shared.trigger[0].io.pin = trigger_pin;
 						pin_config->shared.trigger[0].action = trigger_type;
 					}
 
-					if(config_get_int("io.%u.%u.trigger.1.io", &trigger_io, io, pin) &&
-						config_get_int("io.%u.%u.trigger.1.pin", &trigger_pin, io, pin) &&
-						config_get_int("io.%u.%u.trigger.1.type", &trigger_type, io, pin))
+					if(config_get_int(config_key_io_trigger_1_io, &trigger_io, io, pin) &&
+						config_get_int(config_key_io_trigger_1_pin, &trigger_pin, io, pin) &&
+						config_get_int(config_key_io_trigger_1_type, &trigger_type, io, pin))
 					{
 						pin_config->shared.trigger[1].io.io = trigger_io;
 						pin_config->shared.trigger[1].io.pin = trigger_pin;
@@ -1387,14 +1747,14 @@ void io_init(void)
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.timer.delay", &speed, io, pin))
+					if(!config_get_uint(config_key_io_timer_delay, &speed, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.timer.direction", &direction, io, pin))
+					if(!config_get_uint(config_key_io_timer_direction, &direction, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1418,21 +1778,21 @@ void io_init(void)
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.outputa.speed", &speed, io, pin))
+					if(!config_get_uint(config_key_io_outputa_speed, &speed, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.outputa.lower", &lower_bound, io, pin))
+					if(!config_get_uint(config_key_io_outputa_lower, &lower_bound, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.outputa.upper", &upper_bound, io, pin))
+					if(!config_get_uint(config_key_io_outputa_upper, &upper_bound, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1459,21 +1819,21 @@ void io_init(void)
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.outputa.speed", &speed, io, pin))
+					if(!config_get_uint(config_key_io_outputa_speed, &speed, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.outputa.lower", &lower_bound, io, pin))
+					if(!config_get_uint(config_key_io_outputa_lower, &lower_bound, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.outputa.upper", &upper_bound, io, pin))
+					if(!config_get_uint(config_key_io_outputa_upper, &upper_bound, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1500,7 +1860,7 @@ void io_init(void)
 						continue;
 					}
 
-					if(!config_get_uint("io.%u.%u.i2c.pinmode", &pin_mode, io, pin))
+					if(!config_get_uint(config_key_io_i2c_pinmode, &pin_mode, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1516,7 +1876,7 @@ void io_init(void)
 				{
 					unsigned int pin_mode;
 
-					if(!config_get_uint("io.%u.%u.lcd.pin", &pin_mode, io, pin))
+					if(!config_get_uint(config_key_io_lcd_pin, &pin_mode, io, pin))
 					{
 						pin_config->mode = io_pin_disabled;
 						pin_config->llmode = io_pin_ll_disabled;
@@ -1566,6 +1926,22 @@ void io_init(void)
 					break;
 				}
 
+				case(io_pin_frequency):
+				{
+					unsigned int gate;
+
+					if(!(info->caps & caps_frequency) || !config_get_uint(config_key_io_frequency_gate, &gate, io, pin))
+					{
+						pin_config->mode = io_pin_disabled;
+						pin_config->llmode = io_pin_ll_disabled;
+						continue;
+					}
+
+					pin_config->speed = gate;
+
+					break;
+				}
+
 				default:
 				{
 					break;
@@ -1621,7 +1997,7 @@ void io_init(void)
 
 							if((i2c_sda >= 0) && (i2c_scl >= 0))
 							{
-								if(!config_get_uint("i2c.speed_delay", &i2c_speed_delay, -1, -1))
+								if(!config_get_uint(config_key_i2c_speed_delay, &i2c_speed_delay, -1, -1))
 									i2c_speed_delay = 1000;
 								i2c_init(i2c_sda, i2c_scl, i2c_speed_delay);
 							}
@@ -1659,6 +2035,8 @@ void io_init(void)
 		}
 	}
 
+	io_fast_lists_rebuild();
+
 	sequencer_init();
 	remote_trigger_init();
 
@@ -1671,125 +2049,138 @@ iram void io_periodic_fast(void)
 	io_data_entry_t *data;
 	io_config_pin_entry_t *pin_config;
 	io_data_pin_entry_t *pin_data;
-	unsigned int io, pin, trigger;
+	unsigned int io, pin, trigger, entry;
 	unsigned int value;
-	int remote_trigger;
+	int remote_trigger, timer_value;
 	io_trigger_t trigger_action;
+	uint32_t start = system_get_time();
+
+	io_batch_begin();
 
 	for(io = 0; io < io_id_size; io++)
 	{
 		info = &io_info[io];
 		data = &io_data[io];
 
-		if(!data->detected)
-			continue;
-
-		if(info->periodic_fast_fn)
+		if(data->detected && info->periodic_fast_fn)
 			info->periodic_fast_fn(io, info, data);
+	}
 
-		for(pin = 0; pin < info->pins; pin++)
-		{
-			pin_config = &io_config[io][pin];
-			pin_data = &data->pin[pin];
+	for(entry = io_fast_list_start[io_fast_list_timer]; entry < io_fast_list_start[io_fast_list_timer + 1]; entry++)
+	{
+		io = io_fast_pins[entry].io;
+		pin = io_fast_pins[entry].pin;
+		info = &io_info[io];
+		pin_config = &io_config[io][pin];
+		pin_data = &io_data[io].pin[pin];
 
-			if((pin_config->mode == io_pin_timer) && (pin_data->direction != io_dir_none))
-			{
-				if(pin_data->speed > ms_per_fast_tick)
-					pin_data->speed -= ms_per_fast_tick;
-				else
-				{
-					pin_data->speed = 0;
+		if((timer_value = io_pin_timer_step(pin_data, pin_config)) >= 0)
+			info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, (unsigned int)timer_value);
+	}
 
-					switch(pin_data->direction)
-					{
-						case(io_dir_up):
-						{
-							info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, 1);
-							pin_data->direction = io_dir_down;
-							break;
-						}
+	for(entry = io_fast_list_start[io_fast_list_rotary_encoder]; entry < io_fast_list_start[io_fast_list_rotary_encoder + 1]; entry++)
+	{
+		io = io_fast_pins[entry].io;
+		pin = io_fast_pins[entry].pin;
+		info = &io_info[io];
+		pin_config = &io_config[io][pin];
+		pin_data = &io_data[io].pin[pin];
 
-						case(io_dir_down):
-						{
-							info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, 0);
-							pin_data->direction = io_dir_up;
-							break;
-						}
+		if(((pin_config->shared.renc.pin_type != io_renc_1b) && (pin_config->shared.renc.pin_type != io_renc_2b)) ||
+				(info->read_pin_fn((string_t *)0, info, pin_data, pin_config, pin, &value) != io_ok) ||
+				(value == 0))
+			continue;
 
-						default:
-						{
-						}
-					}
+		if(value > 0x7fffffff)
+		{
+			value = 0xffffffff - value + 1;
+			trigger_action = io_trigger_down;
+		}
+		else
+			if(value > 0)
+				trigger_action = io_trigger_up;
+			else
+				trigger_action = io_trigger_none;
 
-					if(pin_config->flags & io_flag_repeat)
-						pin_data->speed = pin_config->speed;
-					else
-					{
-						pin_data->speed = 0;
-						pin_data->direction = io_dir_none;
-					}
-				}
-			}
+		info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, 0);
+		io_write_pin((string_t *)0, io, pin_config->shared.renc.partner, 0);
 
-			if((pin_config->mode == io_pin_rotary_encoder) &&
-					((pin_config->shared.renc.pin_type == io_renc_1b) || (pin_config->shared.renc.pin_type == io_renc_2b)) &&
-					(info->read_pin_fn((string_t *)0, info, pin_data, pin_config, pin, &value) == io_ok) &&
-					(value != 0))
-			{
-				if(value > 0x7fffffff)
-				{
-					value = 0xffffffff - value + 1;
-					trigger_action = io_trigger_down;
-				}
-				else
-					if(value > 0)
-						trigger_action = io_trigger_up;
-					else
-						trigger_action = io_trigger_none;
+		remote_trigger = pin_config->shared.renc.trigger_pin.remote;
 
-				info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, 0);
-				io_write_pin((string_t *)0, io, pin_config->shared.renc.partner, 0);
+		for(; value > 0; value--)
+			if(remote_trigger >= 0)
+				remote_trigger_add((unsigned int)remote_trigger,
+						pin_config->shared.renc.trigger_pin.io,
+						pin_config->shared.renc.trigger_pin.pin,
+						trigger_action);
+			else
+				io_trigger_pin((string_t *)0,
+						pin_config->shared.renc.trigger_pin.io,
+						pin_config->shared.renc.trigger_pin.pin,
+						trigger_action);
+	}
 
-				remote_trigger = pin_config->shared.renc.trigger_pin.remote;
+	for(entry = io_fast_list_start[io_fast_list_trigger]; entry < io_fast_list_start[io_fast_list_trigger + 1]; entry++)
+	{
+		io = io_fast_pins[entry].io;
+		pin = io_fast_pins[entry].pin;
+		info = &io_info[io];
+		pin_config = &io_config[io][pin];
+		pin_data = &io_data[io].pin[pin];
 
-				for(; value > 0; value--)
-					if(remote_trigger >= 0)
-						remote_trigger_add((unsigned int)remote_trigger,
-								pin_config->shared.renc.trigger_pin.io,
-								pin_config->shared.renc.trigger_pin.pin,
-								trigger_action);
-					else
-						io_trigger_pin((string_t *)0,
-								pin_config->shared.renc.trigger_pin.io,
-								pin_config->shared.renc.trigger_pin.pin,
-								trigger_action);
-			}
+		if((info->read_pin_fn((string_t *)0, info, pin_data, pin_config, pin, &value) != io_ok) || (value == 0))
+			continue;
 
-			if((pin_config->mode == io_pin_trigger) && (info->read_pin_fn((string_t *)0, info, pin_data, pin_config, pin, &value) == io_ok) && (value != 0))
-			{
-				info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, 0);
-
-				for(trigger = 0; trigger < max_triggers_per_pin; trigger++)
-					if(pin_config->shared.trigger[trigger].action != io_trigger_none)
-						io_trigger_pin((string_t *)0,
-								pin_config->shared.trigger[trigger].io.io,
-								pin_config->shared.trigger[trigger].io.pin,
-								pin_config->shared.trigger[trigger].action);
-			}
+		info->write_pin_fn((string_t *)0, info, pin_data, pin_config, pin, 0);
 
-			if(((pin_config->mode == io_pin_output_pwm1) || (pin_config->mode == io_pin_output_pwm2)) &&
-					(pin_config->shared.output_pwm.upper_bound > pin_config->shared.output_pwm.lower_bound) &&
-					(pin_config->speed > 0) &&
-					(pin_data->direction != io_dir_none))
-			{
-				trigger_action = (pin_data->direction == io_dir_up) ? io_trigger_up : io_trigger_down;
-				io_trigger_pin((string_t *)0, io, pin, trigger_action);
-			}
+		for(trigger = 0; trigger < max_triggers_per_pin; trigger++)
+			if(pin_config->shared.trigger[trigger].action != io_trigger_none)
+				io_trigger_pin((string_t *)0,
+						pin_config->shared.trigger[trigger].io.io,
+						pin_config->shared.trigger[trigger].io.pin,
+						pin_config->shared.trigger[trigger].action);
+	}
+
+	for(entry = io_fast_list_start[io_fast_list_pwm]; entry < io_fast_list_start[io_fast_list_pwm + 1]; entry++)
+	{
+		io = io_fast_pins[entry].io;
+		pin = io_fast_pins[entry].pin;
+		pin_config = &io_config[io][pin];
+		pin_data = &io_data[io].pin[pin];
+
+		if((pin_config->shared.output_pwm.upper_bound > pin_config->shared.output_pwm.lower_bound) &&
+				(pin_config->speed > 0) &&
+				(pin_data->direction != io_dir_none))
+		{
+			trigger_action = (pin_data->direction == io_dir_up) ? io_trigger_up : io_trigger_down;
+			io_trigger_pin((string_t *)0, io, pin, trigger_action);
 		}
 	}
 
 	if((sequencer_get_repeats() > 0) && ((time_get_us() / 1000) > sequencer_get_current_end_time()))
 		dispatch_post_task(1, task_run_sequencer, 0);
+
+	io_batch_end((string_t *)0);
+
+	stat_fast_timer_us_last = system_get_time() - start;
+	stat_fast_timer_us_total += stat_fast_timer_us_last;
+
+	if(stat_fast_timer_us_last > stat_fast_timer_us_max)
+		stat_fast_timer_us_max = stat_fast_timer_us_last;
+}
+
+void io_periodic_fast_stats(string_t *dst)
+{
+	string_format(dst, ">   fast tick: last: %u us, avg: %u us, max: %u us\n",
+			stat_fast_timer_us_last,
+			stat_fast_timer ? (unsigned int)(stat_fast_timer_us_total / stat_fast_timer) : 0,
+			stat_fast_timer_us_max);
+
+	string_format(dst, ">   fast tick active pins: timer: %u, rotary encoder: %u, trigger: %u, pwm: %u\n",
+			io_fast_list_start[io_fast_list_timer + 1] - io_fast_list_start[io_fast_list_timer],
+			io_fast_list_start[io_fast_list_rotary_encoder + 1] - io_fast_list_start[io_fast_list_rotary_encoder],
+			io_fast_list_start[io_fast_list_trigger + 1] - io_fast_list_start[io_fast_list_trigger],
+			io_fast_list_start[io_fast_list_pwm + 1] - io_fast_list_start[io_fast_list_pwm]);
 }
 
 void io_periodic_slow(void)
@@ -1886,6 +2277,10 @@ app_action_t application_function_io_mode(string_t *src, string_t *dst)
 
 	string_clear(dst);
 
+	// a fade would otherwise keep writing to the pin in its new mode
+
+	io_fade_cancel(io, pin);
+
 	llmode = io_pin_ll_error;
 
 	if(!config_open_write())
@@ -1907,9 +2302,9 @@ app_action_t application_function_io_mode(string_t *src, string_t *dst)
 
 			llmode = io_pin_ll_input_digital;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_input_digital, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_input_digital, io, pin);
 
 			break;
 		}
@@ -1933,10 +2328,10 @@ app_action_t application_function_io_mode(string_t *src, string_t *dst)
 			pin_config->speed = debounce;
 			llmode = io_pin_ll_counter;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_counter, io, pin);
-			config_set_int("io.%u.%u.counter.debounce", debounce, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_counter, io, pin);
+			config_set_int(config_key_io_counter_debounce, debounce, io, pin);
 
 			break;
 		}
@@ -2004,19 +2399,19 @@ app_action_t application_function_io_mode(string_t *src, string_t *dst)
 			pin_config->speed = debounce;
 			llmode = io_pin_ll_counter;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_counter, io, pin);
-			config_set_int("io.%u.%u.renc.debounce", debounce, io, pin);
-			config_set_int("io.%u.%u.renc.pintype", pin_type, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_counter, io, pin);
+			config_set_int(config_key_io_renc_debounce, debounce, io, pin);
+			config_set_int(config_key_io_renc_pintype, pin_type, io, pin);
 
 			if(trigger_remote_index >= 0)
-				config_set_int("io.%u.%u.renc.remote", trigger_remote_index, io, pin);
+				config_set_int(config_key_io_renc_remote, trigger_remote_index, io, pin);
 
 			if((trigger_io >= 0) && (trigger_pin >= 0))
 			{
-				config_set_int("io.%u.%u.renc.trigger_pin.io", trigger_io, io, pin);
-				config_set_int("io.%u.%u.renc.trigger_pin.pin", trigger_pin, io, pin);
+				config_set_int(config_key_io_renc_trigger_pin_io, trigger_io, io, pin);
+				config_set_int(config_key_io_renc_trigger_pin_pin, trigger_pin, io, pin);
 			}
 
 			break;
@@ -2111,22 +2506,22 @@ renc_error1:
 skip:
 			llmode = io_pin_ll_counter;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_counter, io, pin);
-			config_set_int("io.%u.%u.trigger.debounce", debounce, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_counter, io, pin);
+			config_set_int(config_key_io_trigger_debounce, debounce, io, pin);
 
-			config_set_int("io.%u.%u.trigger.0.io", pin_config->shared.trigger[0].io.io, io, pin);
-			config_set_int("io.%u.%u.trigger.0.pin", pin_config->shared.trigger[0].io.pin, io, pin);
-			config_set_int("io.%u.%u.trigger.0.type", pin_config->shared.trigger[0].action, io, pin);
+			config_set_int(config_key_io_trigger_0_io, pin_config->shared.trigger[0].io.io, io, pin);
+			config_set_int(config_key_io_trigger_0_pin, pin_config->shared.trigger[0].io.pin, io, pin);
+			config_set_int(config_key_io_trigger_0_type, pin_config->shared.trigger[0].action, io, pin);
 
 			if((pin_config->shared.trigger[1].io.io >= 0) &&
 				(pin_config->shared.trigger[1].io.pin >= 0) &&
 				(pin_config->shared.trigger[1].action != io_trigger_none))
 			{
-				config_set_int("io.%u.%u.trigger.1.io", pin_config->shared.trigger[1].io.io, io, pin);
-				config_set_int("io.%u.%u.trigger.1.pin", pin_config->shared.trigger[1].io.pin, io, pin);
-				config_set_int("io.%u.%u.trigger.1.type", pin_config->shared.trigger[1].action, io, pin);
+				config_set_int(config_key_io_trigger_1_io, pin_config->shared.trigger[1].io.io, io, pin);
+				config_set_int(config_key_io_trigger_1_pin, pin_config->shared.trigger[1].io.pin, io, pin);
+				config_set_int(config_key_io_trigger_1_type, pin_config->shared.trigger[1].action, io, pin);
 			}
 
 			break;
@@ -2143,9 +2538,9 @@ skip:
 
 			llmode = io_pin_ll_output_digital;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_output_digital, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_output_digital, io, pin);
 
 			break;
 		}
@@ -2203,11 +2598,11 @@ skip:
 
 			llmode = io_pin_ll_output_digital;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_output_digital, io, pin);
-			config_set_int("io.%u.%u.timer.direction", direction, io, pin);
-			config_set_int("io.%u.%u.timer.delay", speed, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_output_digital, io, pin);
+			config_set_int(config_key_io_timer_direction, direction, io, pin);
+			config_set_int(config_key_io_timer_delay, speed, io, pin);
 
 			break;
 		}
@@ -2223,9 +2618,9 @@ skip:
 
 			llmode = io_pin_ll_input_analog;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_input_analog, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_input_analog, io, pin);
 
 			break;
 		}
@@ -2263,12 +2658,12 @@ skip:
 
 			llmode = io_pin_ll_output_pwm1;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_output_pwm1, io, pin);
-			config_set_int("io.%u.%u.outputa.lower", lower_bound, io, pin);
-			config_set_int("io.%u.%u.outputa.upper", upper_bound, io, pin);
-			config_set_int("io.%u.%u.outputa.speed", speed, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_output_pwm1, io, pin);
+			config_set_int(config_key_io_outputa_lower, lower_bound, io, pin);
+			config_set_int(config_key_io_outputa_upper, upper_bound, io, pin);
+			config_set_int(config_key_io_outputa_speed, speed, io, pin);
 
 			break;
 		}
@@ -2306,12 +2701,12 @@ skip:
 
 			llmode = io_pin_ll_output_pwm2;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_output_pwm2, io, pin);
-			config_set_int("io.%u.%u.outputa.lower", lower_bound, io, pin);
-			config_set_int("io.%u.%u.outputa.upper", upper_bound, io, pin);
-			config_set_int("io.%u.%u.outputa.speed", speed, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_output_pwm2, io, pin);
+			config_set_int(config_key_io_outputa_lower, lower_bound, io, pin);
+			config_set_int(config_key_io_outputa_upper, upper_bound, io, pin);
+			config_set_int(config_key_io_outputa_speed, speed, io, pin);
 
 			break;
 		}
@@ -2349,10 +2744,10 @@ skip:
 
 			llmode = io_pin_ll_i2c;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_i2c, io, pin);
-			config_set_int("io.%u.%u.i2c.pinmode", pin_mode, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_i2c, io, pin);
+			config_set_int(config_key_io_i2c_pinmode, pin_mode, io, pin);
 
 			break;
 		}
@@ -2368,9 +2763,9 @@ skip:
 
 			llmode = io_pin_ll_uart;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_uart, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_uart, io, pin);
 
 			break;
 		}
@@ -2428,10 +2823,10 @@ skip:
 
 			pin_config->shared.lcd.pin_use = pin_mode;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", llmode, io, pin);
-			config_set_int("io.%u.%u.lcd.pin", pin_mode, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, llmode, io, pin);
+			config_set_int(config_key_io_lcd_pin, pin_mode, io, pin);
 
 			break;
 		}
@@ -2447,9 +2842,9 @@ skip:
 
 			llmode = io_pin_ll_uart;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_uart, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_uart, io, pin);
 
 			break;
 		}
@@ -2465,9 +2860,9 @@ skip:
 
 			llmode = io_pin_ll_uart;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_uart, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_uart, io, pin);
 
 			break;
 		}
@@ -2483,9 +2878,38 @@ skip:
 
 			llmode = io_pin_ll_spi;
 
-			config_delete("io.%u.%u.", true, io, pin);
-			config_set_int("io.%u.%u.mode", mode, io, pin);
-			config_set_int("io.%u.%u.llmode", io_pin_ll_spi, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_spi, io, pin);
+
+			break;
+		}
+
+		case(io_pin_frequency):
+		{
+			unsigned int gate;
+
+			if(!(info->caps & caps_frequency))
+			{
+				config_abort_write();
+				string_append(dst, "frequency mode invalid for this io\n");
+				return(app_action_error);
+			}
+
+			if((parse_uint(4, src, &gate, 0, ' ') != parse_ok) || (gate < ms_per_fast_tick) || (gate > 10000))
+			{
+				config_abort_write();
+				string_append(dst, "freq: <gate window ms, 10-10000>\n");
+				return(app_action_error);
+			}
+
+			pin_config->speed = gate;
+			llmode = io_pin_ll_frequency;
+
+			config_delete_wildcard("io.%u.%u.", io, pin);
+			config_set_int(config_key_io_mode, mode, io, pin);
+			config_set_int(config_key_io_llmode, io_pin_ll_frequency, io, pin);
+			config_set_int(config_key_io_frequency_gate, gate, io, pin);
 
 			break;
 		}
@@ -2494,7 +2918,7 @@ skip:
 		{
 			llmode = io_pin_ll_disabled;
 
-			config_delete("io.%u.%u.", true, io, pin);
+			config_delete_wildcard("io.%u.%u.", io, pin);
 
 			break;
 		}
@@ -2524,9 +2948,12 @@ skip:
 	{
 		pin_config->mode = io_pin_disabled;
 		pin_config->llmode = io_pin_ll_disabled;
+		io_fast_lists_rebuild();
 		return(app_action_error);
 	}
 
+	io_fast_lists_rebuild();
+
 	io_config_dump(dst, io, pin, false);
 
 	return(app_action_normal);
@@ -2591,7 +3018,15 @@ app_action_t application_function_io_read(string_t *src, string_t *dst)
 	if(io_read_pin(dst, io, pin, &value) != io_ok)
 		return(app_action_error);
 
-	string_format(dst, "[%u]\n", value);
+	string_format(dst, "[%u]", value);
+
+	if((pin_config->mode == io_pin_frequency) && info->get_pin_info_fn)
+	{
+		string_append(dst, " ");
+		info->get_pin_info_fn(dst, info, &io_data[io].pin[pin], pin_config, pin);
+	}
+
+	string_append(dst, "\n");
 
 	return(app_action_normal);
 }
@@ -2660,6 +3095,204 @@ app_action_t application_function_io_write(string_t *src, string_t *dst)
 	return(app_action_normal);
 }
 
+// one line per io with the current value of every readable pin, reading doesn't reset counters (reset-on-read flag)
+
+app_action_t application_function_io_read_all(string_t *src, string_t *dst)
+{
+	const io_info_entry_t *info;
+	io_data_entry_t *data;
+	io_config_pin_entry_t *pin_config;
+	unsigned int io, pin, value;
+	bool header;
+
+	for(io = 0; io < io_id_size; io++)
+	{
+		info = &io_info[io];
+		data = &io_data[io];
+
+		if(!data->detected)
+			continue;
+
+		header = false;
+
+		for(pin = 0; pin < info->pins; pin++)
+		{
+			pin_config = &io_config[io][pin];
+
+			if(io_read_pin_x((string_t *)0, info, &data->pin[pin], pin_config, pin, &value) != io_ok)
+				continue;
+
+			if(!header)
+			{
+				string_format(dst, "%u:", io);
+				header = true;
+			}
+
+			string_format(dst, " %u=%u", pin, value);
+		}
+
+		if(header)
+			string_append(dst, "\n");
+	}
+
+	return(app_action_normal);
+}
+
+// all tuples are checked before anything is written, then the pins are written grouped per io,
+// in one batch, so all pins on an i2c expander are set in one bus transaction
+
+app_action_t application_function_io_write_multi(string_t *src, string_t *dst)
+{
+	const io_info_entry_t *info;
+	io_config_pin_entry_t *pin_config;
+	unsigned int io, pin, value, current_io, tuple, tuples;
+	io_error_t error;
+
+	for(tuples = 0; parse_uint((tuples * 3) + 1, src, &io, 0, ' ') == parse_ok; tuples++)
+	{
+		if((parse_uint((tuples * 3) + 2, src, &pin, 0, ' ') != parse_ok) ||
+				(parse_uint((tuples * 3) + 3, src, &value, 0, ' ') != parse_ok))
+		{
+			string_append(dst, "io-write-multi <io> <pin> <value> [<io> <pin> <value> ...]\n");
+			return(app_action_error);
+		}
+
+		if((io >= io_id_size) || !io_data[io].detected)
+		{
+			string_format(dst, "invalid io %u\n", io);
+			return(app_action_error);
+		}
+
+		info = &io_info[io];
+
+		if(pin >= info->pins)
+		{
+			string_format(dst, "invalid pin %u/%u\n", io, pin);
+			return(app_action_error);
+		}
+
+		pin_config = &io_config[io][pin];
+
+		switch(pin_config->mode)
+		{
+			case(io_pin_disabled):
+			case(io_pin_error):
+			case(io_pin_ledpixel):
+			case(io_pin_cfa634):
+			case(io_pin_spi):
+			case(io_pin_frequency):
+			{
+				string_format(dst, "cannot write to pin %u/%u\n", io, pin);
+				return(app_action_error);
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+	}
+
+	if(tuples == 0)
+	{
+		string_append(dst, "io-write-multi <io> <pin> <value> [<io> <pin> <value> ...]\n");
+		return(app_action_error);
+	}
+
+	error = io_ok;
+
+	io_batch_begin();
+
+	for(current_io = 0; current_io < io_id_size; current_io++)
+	{
+		for(tuple = 0; tuple < tuples; tuple++)
+		{
+			parse_uint((tuple * 3) + 1, src, &io, 0, ' ');
+
+			if(io != current_io)
+				continue;
+
+			parse_uint((tuple * 3) + 2, src, &pin, 0, ' ');
+			parse_uint((tuple * 3) + 3, src, &value, 0, ' ');
+
+			if(io_write_pin(dst, io, pin, value) != io_ok)
+			{
+				string_format(dst, " (pin %u/%u)\n", io, pin);
+				error = io_error;
+			}
+		}
+	}
+
+	if(io_batch_end(dst) != io_ok)
+	{
+		string_append(dst, " (flush)\n");
+		error = io_error;
+	}
+
+	// there is no rollback, the pins written before (and after) a failing pin keep their new value
+
+	if(error != io_ok)
+		return(app_action_error);
+
+	string_format(dst, "io-write-multi: %u pins written\n", tuples);
+
+	return(app_action_normal);
+}
+
+app_action_t application_function_io_fade(string_t *src, string_t *dst)
+{
+	unsigned int io, pin, target, duration;
+	io_fade_curve_t curve;
+	string_new(, curve_name, 8);
+
+	if((parse_uint(1, src, &io, 0, ' ') != parse_ok) ||
+			(parse_uint(2, src, &pin, 0, ' ') != parse_ok) ||
+			(parse_uint(3, src, &target, 0, ' ') != parse_ok) ||
+			(parse_uint(4, src, &duration, 0, ' ') != parse_ok))
+	{
+		string_append(dst, "io-fade <io> <pin> <target value> <duration ms> [linear|gamma]\n");
+		return(app_action_error);
+	}
+
+	if((io >= io_id_size) || !io_data[io].detected)
+	{
+		string_format(dst, "invalid io %u\n", io);
+		return(app_action_error);
+	}
+
+	if(pin >= io_info[io].pins)
+	{
+		string_append(dst, "invalid pin\n");
+		return(app_action_error);
+	}
+
+	// the curve defaults to the pin's linear flag
+
+	curve = (io_config[io][pin].flags & io_flag_linear) ? io_fade_curve_linear : io_fade_curve_gamma;
+
+	if(parse_string(5, src, &curve_name, ' ') == parse_ok)
+	{
+		if(string_match_cstr(&curve_name, "linear"))
+			curve = io_fade_curve_linear;
+		else
+			if(string_match_cstr(&curve_name, "gamma"))
+				curve = io_fade_curve_gamma;
+			else
+			{
+				string_append(dst, "io-fade: curve must be linear or gamma\n");
+				return(app_action_error);
+			}
+	}
+
+	if(io_fade_start(dst, io, pin, target, duration, curve) != io_ok)
+		return(app_action_error);
+
+	string_format(dst, "io-fade %u/%u: to %u in %u ms, %s\n", io, pin, target, duration,
+			curve == io_fade_curve_linear ? "linear" : "gamma");
+
+	return(app_action_normal);
+}
+
 app_action_t application_function_io_set_mask(string_t *src, string_t *dst)
 {
 	unsigned int io, mask, pins;
@@ -2831,7 +3464,7 @@ static app_action_t application_function_io_clear_set_flag(const string_t *src,
 
 	io_pin_flag_to_int.io_pin_flags = pin_config->flags;
 	config_open_write();
-	config_set_int("io.%u.%u.flags", io_pin_flag_to_int.intvalue, io, pin);
+	config_set_int(config_key_io_flags, io_pin_flag_to_int.intvalue, io, pin);
 	config_close_write();
 
 	string_clear(dst);
@@ -2884,6 +3517,7 @@ typedef enum
 	ds_id_cfa634,
 	ds_id_lcd,
 	ds_id_spi,
+	ds_id_frequency,
 	ds_id_unknown,
 	ds_id_max_value,
 	ds_id_info_1,
@@ -2936,6 +3570,7 @@ static const roflash dump_string_t roflash_dump_strings =
 		/* ds_id_cfa634 */			"cfa634",
 		/* ds_id_lcd */				"lcd",
 		/* ds_id_spi */				"spi",
+		/* ds_id_frequency */		"frequency: %u.%03u Hz, gate: %u ms",
 		/* ds_id_unknown */			"unknown",
 		/* ds_id_max_value */		", max value: %u",
 		/* ds_id_info_1 */			", info: ",
@@ -2976,6 +3611,7 @@ static const roflash dump_string_t roflash_dump_strings =
 		/* ds_id_cfa634 */			"<td>cfa634</td>",
 		/* ds_id_lcd */				"<td>lcd</td>",
 		/* ds_id_spi */				"<td>spi</td>",
+		/* ds_id_frequency */		"<td>frequency: %u.%03u Hz</td><td>gate: %u ms</td>",
 		/* ds_id_unknown */			"<td>unknown</td>",
 		/* ds_id_max_value */		"<td>%u</td>",
 		/* ds_id_info_1 */			"<td>",
@@ -3055,6 +3691,7 @@ void io_config_dump(string_t *dst, int io_id, int pin_id, bool html)
 				case(io_pin_output_pwm2):
 				case(io_pin_i2c):
 				case(io_pin_trigger):
+				case(io_pin_frequency):
 				{
 					if((error = io_read_pin_x(dst, info, pin_data, pin_config, pin, &value)) != io_ok)
 						string_append(dst, "\n");
@@ -3241,6 +3878,16 @@ void io_config_dump(string_t *dst, int io_id, int pin_id, bool html)
 					break;
 				}
 
+				case(io_pin_frequency):
+				{
+					if(error == io_ok)
+						string_format_flash_ptr(dst, (*roflash_strings)[ds_id_frequency], value / 1000, value % 1000, pin_config->speed);
+					else
+						string_append_cstr_flash(dst, (*roflash_strings)[ds_id_error]);
+
+					break;
+				}
+
 				default:
 				{
 					string_append_cstr_flash(dst, (*roflash_strings)[ds_id_unknown]);
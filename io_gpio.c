@@ -4,6 +4,7 @@
 #include "util.h"
 #include "dispatch.h"
 #include "sys_string.h"
+#include "sys_time.h"
 #include "eagle.h"
 
 #include <stdlib.h>
@@ -13,7 +14,6 @@
 enum
 {
 	io_gpio_pin_size = 16,
-	io_gpio_pwm_max_channels = 4,
 	io_gpio_rotary_encoder_timeout = 10,
 };
 
@@ -84,6 +84,68 @@ assert_size(gpio_data_pin_t, 8);
 
 static gpio_data_pin_t gpio_data[io_gpio_pin_size];
 
+#define pwm_pin(pin) (gpio_data[pin].pwm)
+#include "io_gpio_pwm.h"
+static int expander_int_pin = -1;
+
+// edges on counter pins are recorded by the interrupt handler into a small ring (cycle counter timestamp),
+// a task moves them into the event journal (timestamp in us since boot, sequence number) that io-events reads
+
+enum
+{
+	edge_ring_size = 16,
+	event_journal_size = 32,
+};
+
+typedef struct
+{
+	uint32_t	ccount;
+	uint8_t		pin;
+	uint8_t		rising;
+} edge_ring_entry_t;
+
+assert_size(edge_ring_entry_t, 8);
+
+typedef struct
+{
+	uint64_t	time_us;
+	uint32_t	seq;
+	uint8_t		pin;
+	uint8_t		rising;
+} event_journal_entry_t;
+
+assert_size(event_journal_entry_t, 16);
+
+static edge_ring_entry_t edge_ring[edge_ring_size];
+static volatile unsigned int edge_ring_head; // written by isr only
+static volatile unsigned int edge_ring_tail; // written by task only
+static unsigned int edge_ring_dropped;
+
+static event_journal_entry_t event_journal[event_journal_size];
+static unsigned int event_journal_next;
+
+// frequency meter: the interrupt handler timestamps rising and falling edges (cycle counter),
+// at the end of each gate window the fast tick derives frequency, period and duty cycle
+// from the whole periods (rising edge to rising edge) seen in the window
+
+typedef struct
+{
+	uint32_t	first_rise;
+	uint32_t	last_rise;
+	uint32_t	high_cycles;
+	uint32_t	high_cycles_at_last_rise;
+	uint32_t	rises;
+	uint32_t	frequency_mhz;
+	uint32_t	period_us;
+	uint16_t	duty_permille;
+	uint16_t	gate_elapsed:15;
+	uint16_t	high:1;
+} gpio_frequency_t;
+
+assert_size(gpio_frequency_t, 32);
+
+static gpio_frequency_t gpio_frequency[io_gpio_pin_size];
+
 roflash static gpio_info_t gpio_info_table[io_gpio_pin_size] =
 {
 	{ gi_valid, 	PERIPHS_IO_MUX_GPIO0_U,		FUNC_GPIO0,		io_uart_pin_none,	0,				~0,	io_spi_pin_none,	~0				},
@@ -361,28 +423,6 @@ static void pdm_enable(bool onoff)
 
 // PWM
 
-typedef struct
-{
-	uint32_t	phase_duty;
-	uint32_t	phase_delay;
-	uint16_t	phase_active_pins_clear_mask;
-} pwm_phase_t;
-
-assert_size(pwm_phase_t, 12);
-
-typedef struct
-{
-	uint32_t		amount_phases;
-	uint32_t		static_pins_on_mask;
-	uint32_t		static_pins_off_mask;
-	uint32_t		active_pins_all_set_mask;
-	uint32_t		active_pins_noduty1_set_mask;	// special case for duty is 1 period, only set intermittently
-	uint32_t		active_pins_duty1_clear_mask;	// special case for duty is 1 period, clear immediately after set
-	pwm_phase_t		phase[io_gpio_pwm_max_channels + 1];
-} pwm_phases_t;
-
-assert_size(pwm_phases_t, 84);
-
 typedef struct
 {
 	unsigned int	pwm_reset_phase_set:1;
@@ -394,7 +434,6 @@ static unsigned int		pwm_current_phase_set;
 static pwm_phases_t		pwm_phase[2];
 static io_gpio_flags_t	io_gpio_flags;
 
-static int pwm_head;
 static unsigned int pwm1_width;
 
 static void pwm_isr(void);
@@ -450,7 +489,7 @@ bool io_gpio_pwm1_width_set(unsigned int width, bool load, bool save)
 		{	0,		0	}
 	};
 
-	if(load && !config_get_uint("pwm.period", &width, -1, -1) && !config_get_uint("pwm.width", &width, -1, -1))
+	if(load && !config_get_uint(config_key_pwm_period, &width, -1, -1) && !config_get_uint(config_key_pwm_width, &width, -1, -1))
 		width = 16;
 
 	for(current = 0; pwm_widths[current][0] != 0; current++)
@@ -469,12 +508,12 @@ bool io_gpio_pwm1_width_set(unsigned int width, bool load, bool save)
 	{
 		config_open_write();
 
-		config_delete("pwm.period", false, -1, -1);
+		config_delete(config_key_pwm_period, -1, -1);
 
 		if((pwm1_width == 16) || (pwm1_width == 65536))
-			config_delete("pwm.width", false, -1, -1);
+			config_delete(config_key_pwm_width, -1, -1);
 		else
-			config_set_int("pwm.width", pwm1_width, -1, -1);
+			config_set_int(config_key_pwm_width, pwm1_width, -1, -1);
 
 		config_close_write();
 	}
@@ -586,14 +625,17 @@ iram static void pwm_isr(void)
 	}
 }
 
-iram static void pwm_go(void)
+// a duty change on one pin only moves that pin in the sorted list (io_gpio_pwm.h), the full rebuild is used when the pin modes or the width change
+
+static pwm_pins_t pwm_pins;
+static uint32_t pwm_pins_pending_mask;
+
+// switch to the phase set that's not in use by the isr and create the phase table from the sorted list in it
+
+iram static void pwm_commit(void)
 {
-	io_config_pin_entry_t *pin1_config;
-	gpio_info_t *pin1_info;
-	gpio_data_pin_t *pin1_data, *pin2_data, *pin3_data;
-	int pin1, pin2, pin3;
 	pwm_phases_t *phase_data;
-	unsigned int duty, delta, new_phase_set;
+	unsigned int new_phase_set;
 	uint32_t timer_value;
 	bool isr_enabled;
 
@@ -618,155 +660,83 @@ iram static void pwm_go(void)
 		pwm_isr_enable(true);
 	}
 
-	pwm_head = -1;
-
-	// reset linked list
+	phase_data = &pwm_phase[new_phase_set];
+	pwm_pins_build(&pwm_pins, phase_data, pwm1_period(), config_flags_match(flag_pwm1_extend));
 
-	for(pin1 = 0; pin1 < io_gpio_pin_size; pin1++)
+	if(new_phase_set == pwm_current_phase_set)
 	{
-		pin1_config	= &io_config[io_id_gpio][pin1];
-		pin1_info	= &gpio_info_table[pin1];
-		pin1_data	= &gpio_data[pin1];
-
-		if((pin1_info->flags & gi_valid) &&
-				(pin1_config->llmode == io_pin_ll_output_pwm1))
-		{
-			pin1_data->pwm.pwm_next = -1;
-
-			if(pin1_data->pwm.pwm_duty >= pwm1_period())
-				pin1_data->pwm.pwm_duty = pwm1_period() - 1;
-		}
+		io_gpio_flags.pwm_reset_phase_set = 1;
+		io_gpio_flags.pwm_next_phase_set = 0;
+		pwm_timer_set(timer_value);
+		pwm_isr_enable(true);
+	}
+	else
+	{
+		io_gpio_flags.pwm_reset_phase_set = 0;
+		io_gpio_flags.pwm_next_phase_set = 1;
 	}
+}
 
-	// create linked list
+iram static void pwm_go(void)
+{
+	int pin;
 
-	phase_data = &pwm_phase[new_phase_set];
-	phase_data->static_pins_off_mask = 0;
-	phase_data->static_pins_on_mask = 0;
+	stat_pwm_updates_full++;
 
-	for(pin1 = 0; pin1 < io_gpio_pin_size; pin1++)
-	{
-		pin1_info	= &gpio_info_table[pin1];
-		pin1_config	= &io_config[io_id_gpio][pin1];
-		pin1_data	= &gpio_data[pin1];
+	pwm_pins_pending_mask = 0;
+	pwm_pins_reset(&pwm_pins);
 
-		if(!(pin1_info->flags & gi_valid) || (pin1_config->llmode != io_pin_ll_output_pwm1))
-			continue;
+	for(pin = 0; pin < io_gpio_pin_size; pin++)
+		if((gpio_info_table[pin].flags & gi_valid) && (io_config[io_id_gpio][pin].llmode == io_pin_ll_output_pwm1))
+			pwm_pins_place(&pwm_pins, pin, pwm1_period());
 
-		if(pin1_data->pwm.pwm_duty == 0)
-			phase_data->static_pins_off_mask |= 1 << pin1;
-		else
-			if((pin1_data->pwm.pwm_duty + 1) >= pwm1_period())
-				phase_data->static_pins_on_mask |= 1 << pin1;
-			else
-				if(pwm_head < 0)
-				{
-					pwm_head = pin1;
-					pin1_data->pwm.pwm_next = -1;
-				}
-				else
-				{
-					pin2 = pwm_head;
-					pin2_data = &gpio_data[pin2];
+	pwm_commit();
+}
 
-					if(pin2_data->pwm.pwm_duty > pin1_data->pwm.pwm_duty)
-					{
-						pwm_head = pin1;
-						pin1_data->pwm.pwm_next = pin2;
-					}
-					else
-					{
-						for(pin2 = pwm_head; pin2 >= 0; pin2 = pin3)
-						{
-							pin2_data	= &gpio_data[pin2];
-							pin3		= pin2_data->pwm.pwm_next;
-
-							if(pin3 < 0)
-							{
-								pin1_data->pwm.pwm_next = -1;
-								pin2_data->pwm.pwm_next = pin1;
-
-								break;
-							}
-							else
-							{
-								pin3_data = &gpio_data[pin3];
-
-								if(pin3_data->pwm.pwm_duty > pin1_data->pwm.pwm_duty)
-								{
-									pin1_data->pwm.pwm_next = pin3;
-									pin2_data->pwm.pwm_next = pin1;
-
-									break;
-								}
-							}
-						}
-					}
-				}
-	}
+// returns false if the pin isn't known yet, a full rebuild is required then
 
-	phase_data->phase[0].phase_duty = 0;
-	phase_data->phase[0].phase_delay = 0;
-	phase_data->phase[0].phase_active_pins_clear_mask = 0x0000;
-	phase_data->amount_phases = 1;
-	phase_data->active_pins_all_set_mask = 0x0000;
-	phase_data->active_pins_noduty1_set_mask = 0x0000;
-	phase_data->active_pins_duty1_clear_mask = 0x0000;
+iram static bool pwm_reposition(int pin)
+{
+	if(!pwm_pins_known(&pwm_pins, pin))
+		return(false);
 
-	for(pin1 = pwm_head, duty = 0; (phase_data->amount_phases < (io_gpio_pwm_max_channels + 1)) && (pin1 >= 0); pin1 = pin1_data->pwm.pwm_next)
-	{
-		pin1_data = &gpio_data[pin1];
+	stat_pwm_updates_incremental++;
 
-		delta = pin1_data->pwm.pwm_duty - duty;
-		duty = pin1_data->pwm.pwm_duty;
+	pwm_pins_reposition(&pwm_pins, pin, pwm1_period());
 
-		/*
-		 * treat pins with duty == 1 specially:
-		 * 	- add it to the duty1_clear_mask, so it gets cleared immediately
-		 * 	  after settings to ensure the smallest "on time"
-		 *  - if pwm1_extended is set, don't add it to the noduty1_set_mask,
-		 *    so it only gets set intermittently, to realise an even smaller
-		 *    duty cycle, using an effectively lower refresh cycle
-		 */
+	return(true);
+}
 
-		phase_data->active_pins_all_set_mask |= 1 << pin1;
-		phase_data->active_pins_noduty1_set_mask |= 1 << pin1;
+iram static void pwm_go_pin(int pin)
+{
+	if(pwm_reposition(pin))
+		pwm_commit();
+	else
+		pwm_go();
+}
 
-		if(duty == 1)
-		{
-			phase_data->active_pins_duty1_clear_mask |= 1 << pin1;
+// duty changes made during an io batch are collected and committed as one new phase set when the batch ends
 
-			if(config_flags_match(flag_pwm1_extend))
-				phase_data->active_pins_noduty1_set_mask &= ~(1 << pin1);
-		}
+io_error_t io_gpio_flush(string_t *error_message, const struct io_info_entry_T *info)
+{
+	int pin;
+	bool full = false;
 
-		if(delta != 0)
-		{
-			phase_data->phase[phase_data->amount_phases - 1].phase_delay = delta;
-			phase_data->phase[phase_data->amount_phases].phase_duty = pin1_data->pwm.pwm_duty;
-			phase_data->phase[phase_data->amount_phases].phase_delay = pwm1_period() - 1 - pin1_data->pwm.pwm_duty;
-			phase_data->phase[phase_data->amount_phases].phase_active_pins_clear_mask = 1 << pin1;
-			phase_data->amount_phases++;
-		}
-		else
-			phase_data->phase[phase_data->amount_phases - 1].phase_active_pins_clear_mask |= 1 << pin1;
-	}
+	if(pwm_pins_pending_mask == 0)
+		return(io_ok);
 
-	if(phase_data->amount_phases < 2)
-		phase_data->amount_phases = 0;
+	for(pin = 0; pin < io_gpio_pin_size; pin++)
+		if((pwm_pins_pending_mask & (1 << pin)) && !pwm_reposition(pin))
+			full = true;
 
-	if(new_phase_set == pwm_current_phase_set)
-	{
-		io_gpio_flags.pwm_reset_phase_set = 1;
-		io_gpio_flags.pwm_next_phase_set = 0;
-		pwm_timer_set(timer_value);
-		pwm_isr_enable(true);
-	}
+	pwm_pins_pending_mask = 0;
+
+	if(full)
+		pwm_go();
 	else
-	{
-		io_gpio_flags.pwm_reset_phase_set = 0;
-		io_gpio_flags.pwm_next_phase_set = 1;
-	}
+		pwm_commit();
+
+	return(io_ok);
 }
 
 // other
@@ -779,16 +749,67 @@ attr_inline void pin_arm_counter(int pin, bool inverted, bool enable)
 		gpio_pin_intr_state_set(pin, enable ? GPIO_PIN_INTR_NEGEDGE : GPIO_PIN_INTR_DISABLE);
 }
 
+iram static void edge_record(unsigned int pin, bool rising)
+{
+	unsigned int head = edge_ring_head;
+	edge_ring_entry_t *entry;
+
+	if((head - edge_ring_tail) >= edge_ring_size)
+	{
+		edge_ring_dropped++;
+		return;
+	}
+
+	entry = &edge_ring[head % edge_ring_size];
+	entry->ccount = ccount();
+	entry->pin = pin;
+	entry->rising = rising;
+
+	edge_ring_head = head + 1;
+
+	if(head == edge_ring_tail)
+		dispatch_post_task(1, task_io_edge_events, 0);
+}
+
+iram static void frequency_edge(unsigned int pin, uint32_t now, bool level)
+{
+	gpio_frequency_t *frequency = &gpio_frequency[pin];
+
+	if(level)
+	{
+		if(frequency->rises == 0)
+		{
+			frequency->first_rise = now;
+			frequency->high_cycles = 0;
+		}
+
+		frequency->last_rise = now;
+		frequency->high_cycles_at_last_rise = frequency->high_cycles;
+		frequency->rises++;
+		frequency->high = 1;
+	}
+	else
+	{
+		if(frequency->high && (frequency->rises > 0))
+			frequency->high_cycles += now - frequency->last_rise;
+
+		frequency->high = 0;
+	}
+}
+
 iram static void pc_int_isr(void *arg)
 {
 	io_config_pin_entry_t *pin_config;
 	gpio_data_pin_t *gpio_pin_data;
 	int pin;
-	uint32_t pin_status;
+	uint32_t pin_status, pin_levels, now;
+
+	now = ccount();
 
 	ets_isr_mask(1 << ETS_GPIO_INUM);
 	pin_status = gpio_reg_read(GPIO_STATUS_ADDRESS);
 	gpio_reg_write(GPIO_STATUS_W1TC_ADDRESS, pin_status);
+	pin_levels = gpio_get_all();
 
 	stat_pc_counts++;
 
@@ -797,11 +818,26 @@ iram static void pc_int_isr(void *arg)
 		if(!(pin_status & (1 << pin)))
 			continue;
 
+		if(pin == expander_int_pin)
+		{
+			stat_io_expander_interrupts++;
+			dispatch_post_task(1, task_io_expander_interrupt, 0);
+			continue;
+		}
+
 		pin_config = &io_config[0][pin];
 
+		if(pin_config->llmode == io_pin_ll_frequency)
+		{
+			frequency_edge(pin, now, !(pin_levels & (1 << pin)) == !!(pin_config->flags & io_flag_invert));
+			continue;
+		}
+
 		if(pin_config->llmode != io_pin_ll_counter)
 			continue;
 
+		edge_record(pin, !!(pin_config->flags & io_flag_invert));
+
 		gpio_pin_data = &gpio_data[pin];
 
 		if(pin_config->speed != 0)
@@ -848,6 +884,27 @@ iram static void pc_int_isr(void *arg)
 	return;
 }
 
+// the (open drain, mirrored) INT output of the i2c expanders is connected to a gpio configured as digital input
+
+bool io_gpio_expander_int_arm(int pin)
+{
+	if((pin < 0) || (pin >= io_gpio_pin_size) || (io_config[0][pin].llmode != io_pin_ll_input_digital))
+	{
+		expander_int_pin = -1;
+		return(false);
+	}
+
+	expander_int_pin = pin;
+	gpio_pin_intr_state_set(pin, GPIO_PIN_INTR_NEGEDGE);
+
+	return(true);
+}
+
+bool io_gpio_expander_int_pending(void)
+{
+	return((expander_int_pin >= 0) && !gpio_get(expander_int_pin));
+}
+
 io_error_t io_gpio_init(const struct io_info_entry_T *info)
 {
 	unsigned int entry;
@@ -899,6 +956,7 @@ attr_pure unsigned int io_gpio_pin_max_value(const struct io_info_entry_T *info,
 		}
 
 		case(io_pin_ll_counter):
+		case(io_pin_ll_frequency):
 		{
 			value = ~0;
 			break;
@@ -922,14 +980,108 @@ attr_pure unsigned int io_gpio_pin_max_value(const struct io_info_entry_T *info,
 	return(value);
 }
 
+// the cycle counter wraps after 26 seconds at 160 MHz, the ring is drained long before that
+
+void io_gpio_edge_events_drain(void)
+{
+	uint32_t now_ccount;
+	uint64_t now_us;
+	unsigned int head, tail, cycles_per_us;
+	const edge_ring_entry_t *edge;
+	event_journal_entry_t *event;
+
+	// take the head before the time, an edge recorded after that is left for the next drain,
+	// otherwise its ccount would be later than now_ccount and the difference would wrap
+
+	head = edge_ring_head;
+
+	if(edge_ring_tail == head)
+		return;
+
+	now_ccount = ccount();
+	now_us = time_get_us();
+	cycles_per_us = system_get_cpu_freq();
+
+	for(tail = edge_ring_tail; tail != head; tail++)
+	{
+		edge = &edge_ring[tail % edge_ring_size];
+		event = &event_journal[event_journal_next % event_journal_size];
+
+		event->time_us = now_us - ((now_ccount - edge->ccount) / cycles_per_us);
+		event->seq = event_journal_next;
+		event->pin = edge->pin;
+		event->rising = edge->rising;
+
+		event_journal_next++;
+	}
+
+	edge_ring_tail = tail;
+}
+
+// a window that saw at least two rising edges continues from the last one, so no period is lost between windows,
+// the cycle counter wraps after 26 seconds at 160 MHz, hence the gate window is limited to 10 seconds
+
+iram static void frequency_gate(unsigned int pin, const io_config_pin_entry_t *pin_config)
+{
+	gpio_frequency_t *frequency = &gpio_frequency[pin];
+	uint32_t rises, cycles, high_cycles, cycles_per_us;
+
+	frequency->gate_elapsed += ms_per_fast_tick;
+
+	if(frequency->gate_elapsed < pin_config->speed)
+		return;
+
+	frequency->gate_elapsed = 0;
+
+	ets_isr_mask(1 << ETS_GPIO_INUM);
+
+	rises = frequency->rises;
+	cycles = frequency->last_rise - frequency->first_rise;
+	high_cycles = frequency->high_cycles_at_last_rise;
+
+	if(rises > 1)
+	{
+		frequency->first_rise = frequency->last_rise;
+		frequency->high_cycles -= frequency->high_cycles_at_last_rise;
+		frequency->high_cycles_at_last_rise = 0;
+		frequency->rises = 1;
+	}
+	else
+		frequency->rises = 0;
+
+	ets_isr_unmask(1 << ETS_GPIO_INUM);
+
+	if((rises < 2) || (cycles == 0))
+	{
+		frequency->frequency_mhz = 0;
+		frequency->period_us = 0;
+		frequency->duty_permille = (!gpio_get(pin) == !(pin_config->flags & io_flag_invert)) ? 0 : 1000;
+		return;
+	}
+
+	cycles_per_us = system_get_cpu_freq();
+
+	frequency->frequency_mhz = (uint32_t)(((uint64_t)(rises - 1) * cycles_per_us * 1000000000ULL) / cycles);
+	frequency->period_us = cycles / (rises - 1) / cycles_per_us;
+	frequency->duty_permille = (uint16_t)(((uint64_t)high_cycles * 1000) / cycles);
+}
+
 iram void io_gpio_periodic_fast(int io, const struct io_info_entry_T *info, io_data_entry_t *data)
 {
 	int pin;
 
+	io_gpio_edge_events_drain(); // in case the task couldn't be posted
+
 	for(pin = 0; pin < io_gpio_pin_size; pin++)
 	{
 		io_config_pin_entry_t *pin_config = &io_config[io][pin];
 
+		if(pin_config->llmode == io_pin_ll_frequency)
+		{
+			frequency_gate(pin, pin_config);
+			continue;
+		}
+
 		if(pin_config->llmode != io_pin_ll_counter)
 			continue;
 
@@ -972,6 +1124,12 @@ io_error_t io_gpio_init_pin_mode(string_t *error_message, const struct io_info_e
 		return(io_error);
 	}
 
+	// a pin leaving pwm1 mode must be dropped from the phase sets before its data is reused
+
+	if((pin_config->llmode != io_pin_ll_output_pwm1) &&
+			pwm_pins_known(&pwm_pins, pin))
+		pwm_go();
+
 	if(pin_config->llmode == io_pin_ll_disabled)
 	{
 		if(error_message)
@@ -1001,6 +1159,22 @@ io_error_t io_gpio_init_pin_mode(string_t *error_message, const struct io_info_e
 				pin_arm_counter(pin, pin_config->flags & io_flag_invert, true);
 			}
 
+			if((pin_config->llmode == io_pin_ll_input_digital) && (pin == expander_int_pin))
+				gpio_pin_intr_state_set(pin, GPIO_PIN_INTR_NEGEDGE);
+
+			break;
+		}
+
+		case(io_pin_ll_frequency):
+		{
+			gpio_direction(pin, false);
+			gpio_enable_open_drain(pin, false);
+			gpio_enable_pdm(pin, false);
+			gpio_enable_pullup(pin, (pin_config->flags & io_flag_pullup));
+
+			memset(&gpio_frequency[pin], 0, sizeof(gpio_frequency[pin]));
+			gpio_pin_intr_state_set(pin, GPIO_PIN_INTR_ANYEDGE);
+
 			break;
 		}
 
@@ -1127,6 +1301,18 @@ io_error_t io_gpio_get_pin_info(string_t *dst, const struct io_info_entry_T *inf
 				break;
 			}
 
+			case(io_pin_ll_frequency):
+			{
+				const gpio_frequency_t *frequency = &gpio_frequency[pin];
+
+				string_format(dst, "frequency: %lu.%03lu Hz, period: %lu us, duty: %u.%u %%",
+						frequency->frequency_mhz / 1000, frequency->frequency_mhz % 1000,
+						frequency->period_us,
+						frequency->duty_permille / 10, frequency->duty_permille % 10);
+
+				break;
+			}
+
 			case(io_pin_ll_i2c):
 			{
 				string_format(dst, "current state: %s",
@@ -1292,6 +1478,13 @@ io_error_t io_gpio_read_pin(string_t *error_message, const struct io_info_entry_
 			break;
 		}
 
+		case(io_pin_ll_frequency):
+		{
+			*value = gpio_frequency[pin].frequency_mhz;
+
+			break;
+		}
+
 		case(io_pin_ll_output_pwm1):
 		{
 			*value = gpio_pin_data->pwm.pwm_duty;
@@ -1396,7 +1589,11 @@ io_error_t io_gpio_write_pin(string_t *error_message, const struct io_info_entry
 			if(gpio_pin_data->pwm.pwm_duty != value)
 			{
 				gpio_pin_data->pwm.pwm_duty = value;
-				pwm_go();
+
+				if(io_batch_active())
+					pwm_pins_pending_mask |= 1 << pin;
+				else
+					pwm_go_pin(pin);
 			}
 
 			break;
@@ -1489,3 +1686,51 @@ attr_const int io_gpio_get_uart_from_pin(unsigned int pin)
 
 	return(gpio_info_table[pin].uart_instance);
 }
+
+app_action_t application_function_io_events(string_t *src, string_t *dst)
+{
+	unsigned int from, to, first, seq;
+	const event_journal_entry_t *event;
+	string_new(, since, 8);
+
+	io_gpio_edge_events_drain();
+
+	first = (event_journal_next > event_journal_size) ? event_journal_next - event_journal_size : 0;
+	from = first;
+
+	if(parse_string(1, src, &since, ' ') == parse_ok)
+	{
+		if(!string_match_cstr(&since, "since") || (parse_uint(2, src, &from, 0, ' ') != parse_ok))
+		{
+			string_append(dst, "> usage: io-events [since <sequence number>]\n");
+			return(app_action_error);
+		}
+
+		// a sequence number that hasn't been used yet has no events, the oldest entries have been overwritten already
+
+		if((int)(from - event_journal_next) > 0)
+			from = event_journal_next;
+		else
+			if((event_journal_next - from) > (event_journal_next - first))
+				from = first;
+	}
+
+	to = event_journal_next;
+
+	string_format(dst, "> events first: %u, from: %u, next: %u, dropped: %u\n", first, from, to, edge_ring_dropped);
+
+	for(seq = from; seq != to; seq++)
+	{
+		event = &event_journal[seq % event_journal_size];
+
+		if((string_length(dst) + 48) > string_size(dst))
+			break;
+
+		string_format(dst, "%lu %lu.%06lu %u %s\n",
+				event->seq,
+				(uint32_t)(event->time_us / 1000000), (uint32_t)(event->time_us % 1000000),
+				event->pin, event->rising ? "rise" : "fall");
+	}
+
+	return(app_action_normal);
+}
@@ -15,9 +15,14 @@ io_error_t		io_gpio_init_pin_mode(string_t *, const struct io_info_entry_T *, io
 io_error_t		io_gpio_get_pin_info(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int);
 io_error_t		io_gpio_read_pin(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int, unsigned int *);
 io_error_t		io_gpio_write_pin(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int, unsigned int);
+io_error_t		io_gpio_flush(string_t *, const struct io_info_entry_T *);
 int				io_gpio_get_uart_from_pin(unsigned int pin);
 bool			io_gpio_pwm1_width_set(unsigned int period, bool load, bool save);
 unsigned int	io_gpio_pwm1_width_get(void);
+bool			io_gpio_expander_int_arm(int pin);
+bool			io_gpio_expander_int_pending(void);
+void			io_gpio_edge_events_drain(void);
+app_action_t	application_function_io_events(string_t *src, string_t *dst);
 
 // generic
 
@@ -0,0 +1,180 @@
+#ifndef io_gpio_pwm_h
+#define io_gpio_pwm_h
+
+// pwm1 phase tables and the duty sorted pin list they're built from, only depends on attribute.h so host tools (bench-pwm) can use them;
+// the includer defines pwm_pin(pin) as the per pin entry with the int pwm_next and unsigned int pwm_duty members before including this
+
+#include "attribute.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum
+{
+	io_gpio_pwm_max_channels = 4,
+};
+
+typedef struct
+{
+	uint32_t	phase_duty;
+	uint32_t	phase_delay;
+	uint16_t	phase_active_pins_clear_mask;
+} pwm_phase_t;
+
+assert_size(pwm_phase_t, 12);
+
+typedef struct
+{
+	uint32_t		amount_phases;
+	uint32_t		static_pins_on_mask;
+	uint32_t		static_pins_off_mask;
+	uint32_t		active_pins_all_set_mask;
+	uint32_t		active_pins_noduty1_set_mask;	// special case for duty is 1 period, only set intermittently
+	uint32_t		active_pins_duty1_clear_mask;	// special case for duty is 1 period, clear immediately after set
+	pwm_phase_t		phase[io_gpio_pwm_max_channels + 1];
+} pwm_phases_t;
+
+assert_size(pwm_phases_t, 84);
+
+// the active pwm1 channels are kept in a linked list sorted on duty, pins with duty 0 or full duty are in the static masks
+
+typedef struct
+{
+	int			head;
+	uint32_t	list_mask;
+	uint32_t	static_on_mask;
+	uint32_t	static_off_mask;
+} pwm_pins_t;
+
+assert_size(pwm_pins_t, 16);
+
+attr_inline void pwm_pins_reset(pwm_pins_t *pins)
+{
+	pins->head = -1;
+	pins->list_mask = 0;
+	pins->static_on_mask = 0;
+	pins->static_off_mask = 0;
+}
+
+attr_inline bool pwm_pins_known(const pwm_pins_t *pins, int pin)
+{
+	return(((pins->list_mask | pins->static_on_mask | pins->static_off_mask) & (1 << pin)) != 0);
+}
+
+attr_inline void pwm_pins_list_remove(pwm_pins_t *pins, int pin)
+{
+	int *link;
+
+	for(link = &pins->head; *link >= 0; link = &pwm_pin(*link).pwm_next)
+	{
+		if(*link == pin)
+		{
+			*link = pwm_pin(pin).pwm_next;
+			break;
+		}
+	}
+
+	pwm_pin(pin).pwm_next = -1;
+	pins->list_mask &= ~(1 << pin);
+}
+
+attr_inline void pwm_pins_list_insert(pwm_pins_t *pins, int pin)
+{
+	int *link;
+	unsigned int duty = pwm_pin(pin).pwm_duty;
+
+	for(link = &pins->head; (*link >= 0) && (pwm_pin(*link).pwm_duty <= duty); link = &pwm_pin(*link).pwm_next)
+		(void)0;
+
+	pwm_pin(pin).pwm_next = *link;
+	*link = pin;
+	pins->list_mask |= 1 << pin;
+}
+
+attr_inline void pwm_pins_place(pwm_pins_t *pins, int pin, unsigned int period)
+{
+	if(pwm_pin(pin).pwm_duty >= period)
+		pwm_pin(pin).pwm_duty = period - 1;
+
+	if(pwm_pin(pin).pwm_duty == 0)
+		pins->static_off_mask |= 1 << pin;
+	else
+		if((pwm_pin(pin).pwm_duty + 1) >= period)
+			pins->static_on_mask |= 1 << pin;
+		else
+			pwm_pins_list_insert(pins, pin);
+}
+
+// take a pin out of the list or the static masks and put it back according to its (new) duty
+
+attr_inline void pwm_pins_reposition(pwm_pins_t *pins, int pin, unsigned int period)
+{
+	if(pins->list_mask & (1 << pin))
+		pwm_pins_list_remove(pins, pin);
+
+	pins->static_on_mask &= ~(1 << pin);
+	pins->static_off_mask &= ~(1 << pin);
+
+	pwm_pins_place(pins, pin, period);
+}
+
+// create the phase table from the sorted list
+
+attr_inline void pwm_pins_build(const pwm_pins_t *pins, pwm_phases_t *phase_data, unsigned int period, bool extend)
+{
+	int pin;
+	unsigned int duty, delta;
+
+	phase_data->static_pins_off_mask = pins->static_off_mask;
+	phase_data->static_pins_on_mask = pins->static_on_mask;
+
+	phase_data->phase[0].phase_duty = 0;
+	phase_data->phase[0].phase_delay = 0;
+	phase_data->phase[0].phase_active_pins_clear_mask = 0x0000;
+	phase_data->amount_phases = 1;
+	phase_data->active_pins_all_set_mask = 0x0000;
+	phase_data->active_pins_noduty1_set_mask = 0x0000;
+	phase_data->active_pins_duty1_clear_mask = 0x0000;
+
+	for(pin = pins->head, duty = 0; (phase_data->amount_phases < (io_gpio_pwm_max_channels + 1)) && (pin >= 0); pin = pwm_pin(pin).pwm_next)
+	{
+		delta = pwm_pin(pin).pwm_duty - duty;
+		duty = pwm_pin(pin).pwm_duty;
+
+		/*
+		 * treat pins with duty == 1 specially:
+		 * 	- add it to the duty1_clear_mask, so it gets cleared immediately
+		 * 	  after settings to ensure the smallest "on time"
+		 *  - if pwm1_extended is set, don't add it to the noduty1_set_mask,
+		 *    so it only gets set intermittently, to realise an even smaller
+		 *    duty cycle, using an effectively lower refresh cycle
+		 */
+
+		phase_data->active_pins_all_set_mask |= 1 << pin;
+		phase_data->active_pins_noduty1_set_mask |= 1 << pin;
+
+		if(duty == 1)
+		{
+			phase_data->active_pins_duty1_clear_mask |= 1 << pin;
+
+			if(extend)
+				phase_data->active_pins_noduty1_set_mask &= ~(1 << pin);
+		}
+
+		if(delta != 0)
+		{
+			phase_data->phase[phase_data->amount_phases - 1].phase_delay = delta;
+			phase_data->phase[phase_data->amount_phases].phase_duty = duty;
+			phase_data->phase[phase_data->amount_phases].phase_delay = period - 1 - duty;
+			phase_data->phase[phase_data->amount_phases].phase_active_pins_clear_mask = 1 << pin;
+			phase_data->amount_phases++;
+		}
+		else
+			phase_data->phase[phase_data->amount_phases - 1].phase_active_pins_clear_mask |= 1 << pin;
+	}
+
+	if(phase_data->amount_phases < 2)
+		phase_data->amount_phases = 0;
+}
+
+#endif
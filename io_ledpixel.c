@@ -4,6 +4,9 @@
 #include "sys_string.h"
 #include "uart.h"
 #include "io_gpio.h"
+#include "config.h"
+#include "dispatch.h"
+#include "sdk.h"
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -12,6 +15,15 @@
 static bool			detected = false;
 static unsigned int	uart;
 
+enum
+{
+	ledpixel_frame_pixels = 384,
+	ledpixel_chunk_words = 16,
+	ledpixel_baudrate = 3200000,
+	ledpixel_bits_per_uart_byte = 8,	// 6 data bits, start bit, stop bit
+	ledpixel_reset_us = 280,
+};
+
 typedef struct
 {
 	unsigned int	enabled:1;
@@ -21,8 +33,29 @@ typedef struct
 	uint32_t		value;
 } ledpixel_data_pin_t;
 
+typedef struct
+{
+	unsigned int	words;
+	unsigned int	bytes;
+	bool			failed;
+	uint32_t		data[ledpixel_chunk_words];
+} ledpixel_chunk_t;
+
 static ledpixel_data_pin_t ledpixel_data_pin[max_pins_per_io];
 
+// the whole strip, the first pixels follow the ledpixel pins (one or eight per pin), the remaining
+// pixels up to the configured strip length are set using the io-ledpixel command
+
+static uint32_t		ledpixel_frame[ledpixel_frame_pixels];
+static unsigned int	ledpixel_length;
+static unsigned int	ledpixel_frames;
+static unsigned int	ledpixel_frames_failed;
+static unsigned int	ledpixel_frame_pixels_sent;
+static unsigned int	ledpixel_frame_bytes_sent;
+static uint32_t		ledpixel_frame_push_us;
+static bool			ledpixel_frame_pending;
+static bool			ledpixel_task_posted;
+
 #if 0
 static unsigned int simulate_uart(unsigned int in)
 {
@@ -42,61 +75,162 @@ static unsigned int simulate_uart(unsigned int in)
 }
 #endif
 
-static void send_byte(unsigned int byte)
+// from an idea by nodemcu coders: https://github.com/nodemcu/nodemcu-firmware/blob/master/app/modules/ws2812.c
+//
+// every two bits of a colour byte are sent as one 6 bit uart character:
+//
+//		mirror		add start/stop	negate
+//	00	111-011		[0]111-011[1]	1000-1000
+//	01	111-000		[0]111-000[1]	1000-1110
+//	10	001-011		[0]001-011[1]	1110-1000
+//	11	001-000		[0]001-000[1]	1110-1110
+//
+// this table holds the four resulting uart characters for every colour byte, the first to be sent
+// in the least significant byte, so an entry can be stored as is into a little endian uart buffer
+
+roflash static const uint32_t ledpixel_lut[256] =
+{
+	0x37373737, 0x07373737, 0x34373737, 0x04373737, 0x37073737, 0x07073737, 0x34073737, 0x04073737,
+	0x37343737, 0x07343737, 0x34343737, 0x04343737, 0x37043737, 0x07043737, 0x34043737, 0x04043737,
+	0x37370737, 0x07370737, 0x34370737, 0x04370737, 0x37070737, 0x07070737, 0x34070737, 0x04070737,
+	0x37340737, 0x07340737, 0x34340737, 0x04340737, 0x37040737, 0x07040737, 0x34040737, 0x04040737,
+	0x37373437, 0x07373437, 0x34373437, 0x04373437, 0x37073437, 0x07073437, 0x34073437, 0x04073437,
+	0x37343437, 0x07343437, 0x34343437, 0x04343437, 0x37043437, 0x07043437, 0x34043437, 0x04043437,
+	0x37370437, 0x07370437, 0x34370437, 0x04370437, 0x37070437, 0x07070437, 0x34070437, 0x04070437,
+	0x37340437, 0x07340437, 0x34340437, 0x04340437, 0x37040437, 0x07040437, 0x34040437, 0x04040437,
+	0x37373707, 0x07373707, 0x34373707, 0x04373707, 0x37073707, 0x07073707, 0x34073707, 0x04073707,
+	0x37343707, 0x07343707, 0x34343707, 0x04343707, 0x37043707, 0x07043707, 0x34043707, 0x04043707,
+	0x37370707, 0x07370707, 0x34370707, 0x04370707, 0x37070707, 0x07070707, 0x34070707, 0x04070707,
+	0x37340707, 0x07340707, 0x34340707, 0x04340707, 0x37040707, 0x07040707, 0x34040707, 0x04040707,
+	0x37373407, 0x07373407, 0x34373407, 0x04373407, 0x37073407, 0x07073407, 0x34073407, 0x04073407,
+	0x37343407, 0x07343407, 0x34343407, 0x04343407, 0x37043407, 0x07043407, 0x34043407, 0x04043407,
+	0x37370407, 0x07370407, 0x34370407, 0x04370407, 0x37070407, 0x07070407, 0x34070407, 0x04070407,
+	0x37340407, 0x07340407, 0x34340407, 0x04340407, 0x37040407, 0x07040407, 0x34040407, 0x04040407,
+	0x37373734, 0x07373734, 0x34373734, 0x04373734, 0x37073734, 0x07073734, 0x34073734, 0x04073734,
+	0x37343734, 0x07343734, 0x34343734, 0x04343734, 0x37043734, 0x07043734, 0x34043734, 0x04043734,
+	0x37370734, 0x07370734, 0x34370734, 0x04370734, 0x37070734, 0x07070734, 0x34070734, 0x04070734,
+	0x37340734, 0x07340734, 0x34340734, 0x04340734, 0x37040734, 0x07040734, 0x34040734, 0x04040734,
+	0x37373434, 0x07373434, 0x34373434, 0x04373434, 0x37073434, 0x07073434, 0x34073434, 0x04073434,
+	0x37343434, 0x07343434, 0x34343434, 0x04343434, 0x37043434, 0x07043434, 0x34043434, 0x04043434,
+	0x37370434, 0x07370434, 0x34370434, 0x04370434, 0x37070434, 0x07070434, 0x34070434, 0x04070434,
+	0x37340434, 0x07340434, 0x34340434, 0x04340434, 0x37040434, 0x07040434, 0x34040434, 0x04040434,
+	0x37373704, 0x07373704, 0x34373704, 0x04373704, 0x37073704, 0x07073704, 0x34073704, 0x04073704,
+	0x37343704, 0x07343704, 0x34343704, 0x04343704, 0x37043704, 0x07043704, 0x34043704, 0x04043704,
+	0x37370704, 0x07370704, 0x34370704, 0x04370704, 0x37070704, 0x07070704, 0x34070704, 0x04070704,
+	0x37340704, 0x07340704, 0x34340704, 0x04340704, 0x37040704, 0x07040704, 0x34040704, 0x04040704,
+	0x37373404, 0x07373404, 0x34373404, 0x04373404, 0x37073404, 0x07073404, 0x34073404, 0x04073404,
+	0x37343404, 0x07343404, 0x34343404, 0x04343404, 0x37043404, 0x07043404, 0x34043404, 0x04043404,
+	0x37370404, 0x07370404, 0x34370404, 0x04370404, 0x37070404, 0x07070404, 0x34070404, 0x04070404,
+	0x37340404, 0x07340404, 0x34340404, 0x04340404, 0x37040404, 0x07040404, 0x34040404, 0x04040404,
+};
+
+static void chunk_flush(ledpixel_chunk_t *chunk)
 {
-	// from an idea by nodemcu coders: https://github.com/nodemcu/nodemcu-firmware/blob/master/app/modules/ws2812.c
+	// once the uart stalled the frame is lost, don't wait for it again for every chunk
+
+	if((chunk->words > 0) && !chunk->failed)
+	{
+		if(uart_send_fifo(uart, chunk->words * sizeof(uint32_t), (const uint8_t *)chunk->data))
+			chunk->bytes += chunk->words * sizeof(uint32_t);
+		else
+			chunk->failed = true;
+	}
 
-	static const unsigned int bit_pattern[4] =
-	{				//		mirror		add start/stop	negate
-		0b110111,	//	00	111-011		[0]111-011[1]	1000-1000
-		0b000111,	//	01	111-000		[0]111-000[1]	1000-1110
-		0b110100,	//	10	001-011		[0]001-011[1]	1110-1000
-		0b000100,	//	11	001-000		[0]001-000[1]	1110-1110
-	};
+	chunk->words = 0;
+}
 
-	unsigned int byte_bit_index;
-	unsigned int by_six = 0;
+attr_inline void encode_byte(ledpixel_chunk_t *chunk, unsigned int byte)
+{
+	chunk->data[chunk->words++] = ledpixel_lut[byte & 0xff];
+
+	if(chunk->words >= ledpixel_chunk_words)
+		chunk_flush(chunk);
+}
 
-	for(byte_bit_index = 0; byte_bit_index < 4; byte_bit_index++)
+static void encode_pixel(ledpixel_chunk_t *chunk, uint32_t value, bool grb, bool extended)
+{
+	if(grb)
+	{
+		encode_byte(chunk, (value & 0x0000ff00) >>   8);
+		encode_byte(chunk, (value & 0x00ff0000) >>  16);
+	}
+	else
 	{
-		by_six = bit_pattern[(byte & 0b11000000) >> 6];
-		byte <<= 2;
-		uart_send(uart, by_six);
+		encode_byte(chunk, (value & 0x00ff0000) >>  16);
+		encode_byte(chunk, (value & 0x0000ff00) >>   8);
 	}
+
+	encode_byte(chunk, (value & 0x000000ff) >>  0);
+
+	// some ws2812's have four leds (including a white one) and need an extra byte to be sent for it
+
+	if(extended)
+		encode_byte(chunk, (value & 0xff000000) >>  24);
 }
 
+// the frame is encoded in small chunks that are pushed directly into the uart fifo, the fifo holds
+// enough data to cover for encoding the next chunk, so there is no gap that would latch the leds halfway
+
 static void send_all(bool force)
 {
-	unsigned int pin, fill;
+	ledpixel_chunk_t chunk;
+	unsigned int pin, fill, pixel;
+	uint32_t start;
+
+	start = system_get_time();
+
+	chunk.words = 0;
+	chunk.bytes = 0;
+	chunk.failed = false;
+	pixel = 0;
 
 	for(pin = 0; pin < max_pins_per_io; pin++)
 	{
 		if(!force && !ledpixel_data_pin[pin].enabled)
 			break;
 
-		for(fill = ledpixel_data_pin[pin].fill8 ? 8 : 1; fill > 0; fill--)
+		for(fill = ledpixel_data_pin[pin].fill8 ? 8 : 1; fill > 0; fill--, pixel++)
 		{
-			if(ledpixel_data_pin[pin].grb)
-			{
-				send_byte((ledpixel_data_pin[pin].value & 0x0000ff00) >>   8);
-				send_byte((ledpixel_data_pin[pin].value & 0x00ff0000) >>  16);
-			}
-			else
-			{
-				send_byte((ledpixel_data_pin[pin].value & 0x00ff0000) >>  16);
-				send_byte((ledpixel_data_pin[pin].value & 0x0000ff00) >>   8);
-			}
+			ledpixel_frame[pixel] = ledpixel_data_pin[pin].value;
+			encode_pixel(&chunk, ledpixel_data_pin[pin].value, ledpixel_data_pin[pin].grb, ledpixel_data_pin[pin].extended);
+		}
+	}
 
-			send_byte((ledpixel_data_pin[pin].value & 0x000000ff) >>  0);
+	// the remainder of the strip has the same colour order as the first pin
 
-			// some ws2812's have four leds (including a white one) and need an extra byte to be sent for it
+	for(; pixel < ledpixel_length; pixel++)
+		encode_pixel(&chunk, ledpixel_frame[pixel], ledpixel_data_pin[0].grb, ledpixel_data_pin[0].extended);
 
-			if(ledpixel_data_pin[pin].extended)
-				send_byte((ledpixel_data_pin[pin].value & 0xff000000) >>  24);
-		}
+	chunk_flush(&chunk);
 
-		uart_flush(uart);
-	}
+	if(chunk.failed)
+		ledpixel_frames_failed++;
+
+	ledpixel_frames++;
+	ledpixel_frame_pixels_sent = pixel;
+	ledpixel_frame_bytes_sent = chunk.bytes;
+	ledpixel_frame_push_us = system_get_time() - start;
+}
+
+// pushing a frame busy waits for the uart fifo for as long as the frame takes on the wire (~10 ms for 300 leds),
+// so pin writes only mark the frame changed and a task sends it, all writes made before it runs go out
+// as one frame; within an io batch, the task is only posted when the batch ends (flush)
+
+static void post_frame(void)
+{
+	if(ledpixel_frame_pending && !ledpixel_task_posted)
+		ledpixel_task_posted = dispatch_post_task(1, task_ledpixel_send, 0);
+}
+
+void io_ledpixel_send(void)
+{
+	ledpixel_task_posted = false;
+
+	if(!ledpixel_frame_pending)
+		return;
+
+	ledpixel_frame_pending = false;
+	send_all(false);
 }
 
 bool io_ledpixel_setup(unsigned int io, unsigned int pin)
@@ -124,7 +258,13 @@ io_error_t io_ledpixel_init(const struct io_info_entry_T *info)
 	if(!detected)
 		return(io_error);
 
-	uart_baudrate(uart, 3200000);
+	if(!config_get_uint(config_key_io_ledpixel_length, &ledpixel_length, -1, -1))
+		ledpixel_length = 0;
+
+	if(ledpixel_length > ledpixel_frame_pixels)
+		ledpixel_length = ledpixel_frame_pixels;
+
+	uart_baudrate(uart, ledpixel_baudrate);
 	uart_data_bits(uart, 6);
 	uart_stop_bits(uart, 1);
 	uart_parity(uart, parity_none);
@@ -132,6 +272,13 @@ io_error_t io_ledpixel_init(const struct io_info_entry_T *info)
 	return(io_ok);
 }
 
+// when the task queue was full, try again
+
+void io_ledpixel_periodic_slow(int io, const struct io_info_entry_T *info, io_data_entry_t *data)
+{
+	post_frame();
+}
+
 attr_pure unsigned int io_ledpixel_pin_max_value(const struct io_info_entry_T *info, io_data_pin_entry_t *data, const io_config_pin_entry_t *pin_config, unsigned int pin)
 {
 	unsigned int value = 0;
@@ -163,8 +310,75 @@ io_error_t io_ledpixel_read_pin(string_t *error_message, const struct io_info_en
 io_error_t io_ledpixel_write_pin(string_t *error_message, const struct io_info_entry_T *info, io_data_pin_entry_t *pin_data, const io_config_pin_entry_t *pin_config, int pin, unsigned int value)
 {
 	ledpixel_data_pin[pin].value = value;
+	ledpixel_frame_pending = true;
 
-	send_all(false);
+	if(!io_batch_active())
+		post_frame();
+
+	return(io_ok);
+}
+
+io_error_t io_ledpixel_flush(string_t *error_message, const struct io_info_entry_T *info)
+{
+	post_frame();
 
 	return(io_ok);
 }
+
+app_action_t application_function_io_ledpixel(string_t *src, string_t *dst)
+{
+	unsigned int pixel, count, value, argument;
+	unsigned int wire_us;
+	string_new(, command, 8);
+
+	if(!detected)
+	{
+		string_append(dst, "> no ledpixel pins configured\n");
+		return(app_action_error);
+	}
+
+	if(parse_string(1, src, &command, ' ') == parse_ok)
+	{
+		if(string_match_cstr(&command, "set"))
+		{
+			if((parse_uint(2, src, &pixel, 0, ' ') != parse_ok) || (parse_uint(3, src, &value, 0, ' ') != parse_ok))
+				goto usage;
+
+			for(argument = 3; (pixel < ledpixel_frame_pixels) && (parse_uint(argument, src, &value, 0, ' ') == parse_ok); argument++, pixel++)
+				ledpixel_frame[pixel] = value;
+		}
+		else
+			if(string_match_cstr(&command, "fill"))
+			{
+				if((parse_uint(2, src, &pixel, 0, ' ') != parse_ok) ||
+						(parse_uint(3, src, &count, 0, ' ') != parse_ok) ||
+						(parse_uint(4, src, &value, 0, ' ') != parse_ok))
+					goto usage;
+
+				for(; (pixel < ledpixel_frame_pixels) && (count > 0); pixel++, count--)
+					ledpixel_frame[pixel] = value;
+			}
+			else
+				goto usage;
+
+		// the command runs from a task already, send right away so the statistics below are for this frame
+
+		ledpixel_frame_pending = false;
+		send_all(false);
+	}
+
+	// time on the wire is the same for every frame of this length, the push time also includes encoding
+
+	wire_us = (uint32_t)(((uint64_t)ledpixel_frame_bytes_sent * ledpixel_bits_per_uart_byte * 1000000ULL) / ledpixel_baudrate) + ledpixel_reset_us;
+
+	string_format(dst, "> ledpixel strip length: %u (max %u), frames sent: %u, failed (uart stalled): %u\n",
+			ledpixel_length, (unsigned int)ledpixel_frame_pixels, ledpixel_frames, ledpixel_frames_failed);
+	string_format(dst, ">  last frame: %u pixels, %u uart bytes, pushed in %lu us, on the wire in %u us, max update rate %u Hz\n",
+			ledpixel_frame_pixels_sent, ledpixel_frame_bytes_sent, ledpixel_frame_push_us, wire_us, 1000000 / wire_us);
+
+	return(app_action_normal);
+
+usage:
+	string_append(dst, "> usage: io-ledpixel [set <pixel> <value> [<value> ...] | fill <pixel> <count> <value>]\n");
+	return(app_action_error);
+}
@@ -1,8 +1,12 @@
 #include "io_mcp.h"
+#include "io_gpio.h"
 #include "i2c.h"
 #include "dispatch.h"
+#include "config.h"
+#include "stats.h"
 #include "util.h"
 #include "sys_string.h"
+#include "sys_time.h"
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -27,8 +31,19 @@ enum
 	BANK
 };
 
+enum
+{
+	input_cache_max_age_us = (ms_per_fast_tick * 1000) / 2,
+};
+
 static uint8_t pin_output_cache[io_mcp_instance_size][2];
+static uint8_t pin_output_dirty[io_mcp_instance_size];
+static uint8_t pin_input_cache[io_mcp_instance_size][2];
+static bool pin_input_valid[io_mcp_instance_size];
+static uint32_t pin_input_sampled[io_mcp_instance_size];
 static mcp_data_pin_t mcp_data_pin_table[io_mcp_instance_size][16];
+static uint32_t mcp_last_edge_ms[io_mcp_instance_size][16];
+static int mcp_int_pin = -1;
 
 attr_inline int IODIR(int s)		{ return(0x00 + s);	}
 attr_inline int IPOL(int s)			{ return(0x02 + s);	}
@@ -115,6 +130,14 @@ io_error_t io_mcp_init(const struct io_info_entry_T *info)
 	uint8_t i2c_buffer[1];
 	mcp_data_pin_t *mcp_pin_data;
 
+	// when the INT line is used, INTA and INTB are mirrored and open drain, so all expanders can share one gpio
+
+	if(!config_get_int(config_key_io_mcp_intpin, &mcp_int_pin, -1, -1))
+		mcp_int_pin = -1;
+
+	if(mcp_int_pin >= 0)
+		iocon_value |= (1 << MIRROR) | (1 << ODR);
+
 	// switch to linear mode, assuming config is in banked mode
 	// if config was in linear mode already, GPINTENB will be written instead of IOCON, but that's ok (value == 0)
 
@@ -137,14 +160,107 @@ io_error_t io_mcp_init(const struct io_info_entry_T *info)
 		mcp_pin_data = &mcp_data_pin_table[info->instance - io_mcp_instance_first][pin];
 		mcp_pin_data->counter = 0;
 		mcp_pin_data->debounce = 0;
+		mcp_last_edge_ms[instance_index(info)][pin] = 0;
 	}
 
 	pin_output_cache[instance_index(info)][0] = 0;
 	pin_output_cache[instance_index(info)][1] = 0;
+	pin_output_dirty[instance_index(info)] = 0;
+	pin_input_valid[instance_index(info)] = false;
 
 	return(io_ok);
 }
 
+// write out the banks that have changed since the last flush, both banks go in one transaction
+
+static io_error_t flush_output(string_t *error_message, const struct io_info_entry_T *info)
+{
+	unsigned int index = instance_index(info);
+	i2c_error_t error;
+
+	switch(pin_output_dirty[index])
+	{
+		case(0):
+		{
+			return(io_ok);
+		}
+
+		case(1 << 0):
+		case(1 << 1):
+		{
+			unsigned int bank = pin_output_dirty[index] >> 1;
+
+			if(write_register(error_message, info->address, GPIO(bank), pin_output_cache[index][bank]) != io_ok)
+				return(io_error);
+
+			break;
+		}
+
+		default:
+		{
+			if((error = i2c_send3(info->address, GPIO(0), pin_output_cache[index][0], pin_output_cache[index][1])) != i2c_error_ok)
+			{
+				if(error_message)
+					i2c_error_format_string(error_message, error);
+
+				return(io_error);
+			}
+
+			break;
+		}
+	}
+
+	pin_output_dirty[index] = 0;
+	pin_input_valid[index] = false;
+	stat_io_expander_flushes++;
+
+	return(io_ok);
+}
+
+// sample both banks at once, a sample taken less than half a fast tick ago is reused
+
+static io_error_t sample_input(string_t *error_message, const struct io_info_entry_T *info)
+{
+	unsigned int index = instance_index(info);
+	uint32_t now;
+	uint8_t i2c_buffer[2];
+	i2c_error_t error;
+
+	if(flush_output(error_message, info) != io_ok)
+		return(io_error);
+
+	now = system_get_time();
+
+	if(pin_input_valid[index] && ((now - pin_input_sampled[index]) < input_cache_max_age_us))
+	{
+		stat_io_expander_reads_cached++;
+		return(io_ok);
+	}
+
+	if((error = i2c_send1_receive(info->address, GPIO(0), sizeof(i2c_buffer), i2c_buffer)) != i2c_error_ok)
+	{
+		if(error_message)
+			i2c_error_format_string(error_message, error);
+
+		pin_input_valid[index] = false;
+
+		return(io_error);
+	}
+
+	pin_input_cache[index][0] = i2c_buffer[0];
+	pin_input_cache[index][1] = i2c_buffer[1];
+	pin_input_valid[index] = true;
+	pin_input_sampled[index] = now;
+	stat_io_expander_reads++;
+
+	return(io_ok);
+}
+
+io_error_t io_mcp_flush(string_t *error_message, const struct io_info_entry_T *info)
+{
+	return(flush_output(error_message, info));
+}
+
 attr_pure unsigned int io_mcp_pin_max_value(const struct io_info_entry_T *info, io_data_pin_entry_t *data, const io_config_pin_entry_t *pin_config, unsigned int pin)
 {
 	unsigned int value = 0;
@@ -171,12 +287,16 @@ attr_pure unsigned int io_mcp_pin_max_value(const struct io_info_entry_T *info,
 	return(value);
 }
 
-void io_mcp_periodic_slow(int io, const struct io_info_entry_T *info, io_data_entry_t *data)
+// INTF and INTCAP are read in one transaction, reading INTCAP clears the interrupt condition;
+// when serviced from the INT line, debounce is timestamp based (ms), otherwise it counts down per slow tick
+
+static void service_interrupt_flags(int io, const struct io_info_entry_T *info, bool from_int_line)
 {
 	uint8_t i2c_buffer[4];
 	unsigned int intf[2];
 	unsigned int intcap[2];
 	unsigned int pin, bank, bankpin;
+	uint32_t now_ms;
 	mcp_data_pin_t *mcp_pin_data;
 	io_config_pin_entry_t *pin_config;
 
@@ -188,6 +308,8 @@ void io_mcp_periodic_slow(int io, const struct io_info_entry_T *info, io_data_en
 	intcap[0] = i2c_buffer[2];
 	intcap[1] = i2c_buffer[3];
 
+	now_ms = (uint32_t)(time_get_us() / 1000);
+
 	for(pin = 0; pin < 16; pin++)
 	{
 		bank = (pin & 0x08) >> 3;
@@ -196,28 +318,71 @@ void io_mcp_periodic_slow(int io, const struct io_info_entry_T *info, io_data_en
 		mcp_pin_data = &mcp_data_pin_table[info->instance][pin];
 		pin_config = &io_config[io][pin];
 
-		if(pin_config->llmode == io_pin_ll_counter)
+		if(pin_config->llmode != io_pin_ll_counter)
+			continue;
+
+		if(from_int_line)
 		{
-			if(mcp_pin_data->debounce != 0)
+			if((intf[bank] & (1 << bankpin)) && !(intcap[bank] & (1 << bankpin)) &&
+					((now_ms - mcp_last_edge_ms[instance_index(info)][pin]) >= pin_config->speed))
 			{
-				if(mcp_pin_data->debounce > ms_per_slow_tick)
-					mcp_pin_data->debounce -= ms_per_slow_tick;
-				else
-					mcp_pin_data->debounce = 0;
+				mcp_pin_data->counter++;
+				mcp_last_edge_ms[instance_index(info)][pin] = now_ms;
+				dispatch_post_task(1, task_alert_pin_changed, 0);
 			}
+
+			continue;
+		}
+
+		if(mcp_pin_data->debounce != 0)
+		{
+			if(mcp_pin_data->debounce > ms_per_slow_tick)
+				mcp_pin_data->debounce -= ms_per_slow_tick;
 			else
+				mcp_pin_data->debounce = 0;
+		}
+		else
+		{
+			if((intf[bank] & (1 << bankpin)) && !(intcap[bank] & (1 << bankpin))) // only count downward edge, counter is mostly pull-up
 			{
-				if((intf[bank] & (1 << bankpin)) && !(intcap[bank] & (1 << bankpin))) // only count downward edge, counter is mostly pull-up
-				{
-					mcp_pin_data->counter++;
-					mcp_pin_data->debounce = pin_config->speed;
-					dispatch_post_task(1, task_alert_pin_changed, 0);
-				}
+				mcp_pin_data->counter++;
+				mcp_pin_data->debounce = pin_config->speed;
+				dispatch_post_task(1, task_alert_pin_changed, 0);
 			}
 		}
 	}
 }
 
+void io_mcp_post_init(const struct io_info_entry_T *info)
+{
+	if((mcp_int_pin >= 0) && !io_gpio_expander_int_arm(mcp_int_pin))
+	{
+		logf("mcp: INT gpio %d is not a digital input, using polling\n", mcp_int_pin);
+		mcp_int_pin = -1;
+	}
+}
+
+// with the INT line in use, the slow tick only touches the bus if the line is (still) asserted, i.e. an edge was missed
+
+void io_mcp_periodic_slow(int io, const struct io_info_entry_T *info, io_data_entry_t *data)
+{
+	if(mcp_int_pin >= 0)
+	{
+		if(io_gpio_expander_int_pending())
+			service_interrupt_flags(io, info, true);
+
+		return;
+	}
+
+	service_interrupt_flags(io, info, false);
+}
+
+void io_mcp_interrupt(int io, const struct io_info_entry_T *info, io_data_entry_t *data)
+{
+	if(mcp_int_pin >= 0)
+		service_interrupt_flags(io, info, true);
+}
+
 io_error_t io_mcp_init_pin_mode(string_t *error_message, const struct io_info_entry_T *info, io_data_pin_entry_t *pin_data, const io_config_pin_entry_t *pin_config, int pin)
 {
 	int bank, bankpin;
@@ -225,6 +390,11 @@ io_error_t io_mcp_init_pin_mode(string_t *error_message, const struct io_info_en
 	bank = (pin & 0x08) >> 3;
 	bankpin = pin & 0x07;
 
+	if(flush_output(error_message, info) != io_ok)
+		return(io_error);
+
+	pin_input_valid[instance_index(info)] = false;
+
 	if((pin_config->llmode == io_pin_ll_input_digital) && (pin_config->flags & io_flag_invert))
 	{
 		if(clear_set_register(error_message, info->address, IPOL(bank), 0, 1 << bankpin) != io_ok) // input polarity inversion = 1
@@ -359,7 +529,7 @@ io_error_t io_mcp_get_pin_info(string_t *dst, const struct io_info_entry_T *info
 
 io_error_t io_mcp_read_pin(string_t *error_message, const struct io_info_entry_T *info, io_data_pin_entry_t *pin_data, const io_config_pin_entry_t *pin_config, int pin, unsigned int *value)
 {
-	int bank, bankpin, tv;
+	int bank, bankpin;
 	mcp_data_pin_t *mcp_pin_data;
 
 	bank = (pin & 0x08) >> 3;
@@ -367,17 +537,15 @@ io_error_t io_mcp_read_pin(string_t *error_message, const struct io_info_entry_T
 
 	mcp_pin_data = &mcp_data_pin_table[info->instance][pin];
 
-	tv = 0;
-
 	switch(pin_config->llmode)
 	{
 		case(io_pin_ll_input_digital):
 		case(io_pin_ll_output_digital):
 		{
-			if(read_register(error_message, info->address, GPIO(bank), &tv) != io_ok)
+			if(sample_input(error_message, info) != io_ok)
 				return(io_error);
 
-			*value = !!(tv & (1 << bankpin));
+			*value = !!(pin_input_cache[instance_index(info)][bank] & (1 << bankpin));
 
 			if((pin_config->llmode == io_pin_ll_output_digital) && (pin_config->flags & io_flag_invert))
 				*value = !*value;
@@ -426,8 +594,15 @@ io_error_t io_mcp_write_pin(string_t *error_message, const struct io_info_entry_
 	{
 		case(io_pin_ll_output_digital):
 		{
-			if(write_register(error_message, info->address, GPIO(bank),
-						pin_output_cache[instance_index(info)][bank]) != io_ok)
+			pin_output_dirty[instance_index(info)] |= 1 << bank;
+
+			if(io_batch_active())
+			{
+				stat_io_expander_writes_deferred++;
+				break;
+			}
+
+			if(flush_output(error_message, info) != io_ok)
 				return(io_error);
 
 			break;
@@ -461,8 +636,9 @@ io_error_t io_mcp_set_mask(string_t *error_message, const struct io_info_entry_T
 	pin_output_cache[index][0] |= (pins & 0x00ff) >> 0;
 	pin_output_cache[index][1] |= (pins & 0xff00) >> 8;
 
-	if(i2c_send3(info->address, GPIO(0), pin_output_cache[index][0], pin_output_cache[index][1]) != i2c_error_ok)
-		return(false);
+	// a mask write is used for strobes (lcd), it always goes out immediately, including any pending pin writes
 
-	return(io_ok);
+	pin_output_dirty[index] = (1 << 0) | (1 << 1);
+
+	return(flush_output(error_message, info));
 }
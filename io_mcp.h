@@ -17,6 +17,8 @@ typedef enum
 } io_mcp_instance_t;
 
 void			io_mcp_periodic_slow(int io, const struct io_info_entry_T *, io_data_entry_t *);
+void			io_mcp_post_init(const struct io_info_entry_T *);
+void			io_mcp_interrupt(int io, const struct io_info_entry_T *, io_data_entry_t *);
 unsigned int	io_mcp_pin_max_value(const struct io_info_entry_T *info, io_data_pin_entry_t *data, const io_config_pin_entry_t *pin_config, unsigned int pin);
 io_error_t		io_mcp_init(const struct io_info_entry_T *);
 io_error_t		io_mcp_init_pin_mode(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int);
@@ -24,5 +26,6 @@ io_error_t		io_mcp_get_pin_info(string_t *, const struct io_info_entry_T *, io_d
 io_error_t		io_mcp_read_pin(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int, unsigned int *);
 io_error_t		io_mcp_write_pin(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int, unsigned int);
 io_error_t		io_mcp_set_mask(string_t *, const struct io_info_entry_T *, unsigned int, unsigned int);
+io_error_t		io_mcp_flush(string_t *, const struct io_info_entry_T *);
 
 #endif
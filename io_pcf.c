@@ -1,17 +1,86 @@
 #include "io_pcf.h"
 #include "i2c.h"
+#include "stats.h"
 #include "util.h"
 #include "sys_string.h"
 
 #include <stdlib.h>
 
+enum
+{
+	input_cache_max_age_us = (ms_per_fast_tick * 1000) / 2,
+};
+
 static uint8_t pcf_data_pin_table[io_pcf_instance_size];
+static bool pcf_data_dirty[io_pcf_instance_size];
+static uint8_t pcf_input_cache[io_pcf_instance_size];
+static bool pcf_input_valid[io_pcf_instance_size];
+static uint32_t pcf_input_sampled[io_pcf_instance_size];
+
+static io_error_t flush_output(string_t *error_message, const struct io_info_entry_T *info)
+{
+	i2c_error_t error;
+
+	if(!pcf_data_dirty[info->instance])
+		return(io_ok);
+
+	if((error = i2c_send1(info->address, pcf_data_pin_table[info->instance])) != i2c_error_ok)
+	{
+		if(error_message)
+			i2c_error_format_string(error_message, error);
+
+		return(io_error);
+	}
+
+	pcf_data_dirty[info->instance] = false;
+	pcf_input_valid[info->instance] = false;
+	stat_io_expander_flushes++;
+
+	return(io_ok);
+}
+
+static io_error_t sample_input(string_t *error_message, const struct io_info_entry_T *info)
+{
+	uint32_t now;
+	uint8_t i2c_data[1];
+	i2c_error_t error;
+
+	if(flush_output(error_message, info) != io_ok)
+		return(io_error);
+
+	now = system_get_time();
+
+	if(pcf_input_valid[info->instance] && ((now - pcf_input_sampled[info->instance]) < input_cache_max_age_us))
+	{
+		stat_io_expander_reads_cached++;
+		return(io_ok);
+	}
+
+	if((error = i2c_receive(info->address, 1, i2c_data)) != i2c_error_ok)
+	{
+		if(error_message)
+			i2c_error_format_string(error_message, error);
+
+		pcf_input_valid[info->instance] = false;
+
+		return(io_error);
+	}
+
+	pcf_input_cache[info->instance] = i2c_data[0];
+	pcf_input_valid[info->instance] = true;
+	pcf_input_sampled[info->instance] = now;
+	stat_io_expander_reads++;
+
+	return(io_ok);
+}
 
 io_error_t io_pcf_init(const struct io_info_entry_T *info)
 {
 	uint8_t i2cbuffer[1];
 
 	pcf_data_pin_table[info->instance] = 0x00;
+	pcf_data_dirty[info->instance] = false;
+	pcf_input_valid[info->instance] = false;
 
 	if(i2c_receive(info->address, 1, i2cbuffer) != i2c_error_ok)
 		return(io_error);
@@ -43,6 +112,11 @@ io_error_t io_pcf_init_pin_mode(string_t *error_message, const struct io_info_en
 {
 	i2c_error_t error;
 
+	if(flush_output(error_message, info) != io_ok)
+		return(io_error);
+
+	pcf_input_valid[info->instance] = false;
+
 	switch(pin_config->llmode)
 	{
 		case(io_pin_ll_disabled):
@@ -86,19 +160,13 @@ io_error_t io_pcf_init_pin_mode(string_t *error_message, const struct io_info_en
 
 io_error_t io_pcf_read_pin(string_t *error_message, const struct io_info_entry_T *info, io_data_pin_entry_t *pin_data, const io_config_pin_entry_t *pin_config, int pin, unsigned int *value)
 {
-	uint8_t i2c_data[1];
-	i2c_error_t error;
-
 	switch(pin_config->llmode)
 	{
 		case(io_pin_ll_input_digital):
 		case(io_pin_ll_output_digital):
 		{
-			if((error = i2c_receive(info->address, 1, i2c_data)) != i2c_error_ok)
-			{
-				i2c_error_format_string(error_message, error);
+			if(sample_input(error_message, info) != io_ok)
 				return(io_error);
-			}
 
 			break;
 		}
@@ -112,7 +180,7 @@ io_error_t io_pcf_read_pin(string_t *error_message, const struct io_info_entry_T
 		}
 	}
 
-	*value = !!(i2c_data[0] & (1 << pin));
+	*value = !!(pcf_input_cache[info->instance] & (1 << pin));
 
 	if(pin_config->flags & io_flag_invert)
 		*value = !*value;
@@ -122,8 +190,6 @@ io_error_t io_pcf_read_pin(string_t *error_message, const struct io_info_entry_T
 
 io_error_t io_pcf_write_pin(string_t *error_message, const struct io_info_entry_T *info, io_data_pin_entry_t *pin_data, const io_config_pin_entry_t *pin_config, int pin, unsigned int value)
 {
-	i2c_error_t error;
-
 	if(pin_config->flags & io_flag_invert)
 		value = !value;
 
@@ -135,13 +201,18 @@ io_error_t io_pcf_write_pin(string_t *error_message, const struct io_info_entry_
 				pcf_data_pin_table[info->instance] |= (1 << pin);
 			else
 				pcf_data_pin_table[info->instance] &= ~(1 << pin);
-			
-			if((error = i2c_send1(info->address, pcf_data_pin_table[info->instance])) != i2c_error_ok)
+
+			pcf_data_dirty[info->instance] = true;
+
+			if(io_batch_active())
 			{
-				i2c_error_format_string(error_message, error);
-				return(io_error);
+				stat_io_expander_writes_deferred++;
+				break;
 			}
 
+			if(flush_output(error_message, info) != io_ok)
+				return(io_error);
+
 			break;
 		}
 
@@ -156,3 +227,17 @@ io_error_t io_pcf_write_pin(string_t *error_message, const struct io_info_entry_
 
 	return(io_ok);
 }
+
+io_error_t io_pcf_set_mask(string_t *error_message, const struct io_info_entry_T *info, unsigned int mask, unsigned int pins)
+{
+	pcf_data_pin_table[info->instance] &= ~(mask & 0xff);
+	pcf_data_pin_table[info->instance] |= pins & mask & 0xff;
+	pcf_data_dirty[info->instance] = true;
+
+	return(flush_output(error_message, info));
+}
+
+io_error_t io_pcf_flush(string_t *error_message, const struct io_info_entry_T *info)
+{
+	return(flush_output(error_message, info));
+}
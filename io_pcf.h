@@ -17,5 +17,7 @@ unsigned int	io_pcf_pin_max_value(const struct io_info_entry_T *info, io_data_pi
 io_error_t		io_pcf_init_pin_mode(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int);
 io_error_t		io_pcf_read_pin(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int, unsigned int *);
 io_error_t		io_pcf_write_pin(string_t *, const struct io_info_entry_T *, io_data_pin_entry_t *, const io_config_pin_entry_t *, int, unsigned int);
+io_error_t		io_pcf_set_mask(string_t *, const struct io_info_entry_T *, unsigned int, unsigned int);
+io_error_t		io_pcf_flush(string_t *, const struct io_info_entry_T *);
 
 #endif
@@ -0,0 +1,98 @@
+#!/usr/bin/perl -w
+
+# decode the output of the "log-binary" command
+# usage: logdecode.pl <elf image> < log-binary output
+
+no warnings 'portable';
+
+my($input) = $ARGV[0];
+my($fd, $elf);
+my(@sections);
+
+die("usage: logdecode.pl <elf image>") if(!defined($input));
+die("cannot open elf image $input") if(!open($fd, "<", $input));
+
+binmode($fd);
+local $/;
+$elf = <$fd>;
+close($fd);
+
+die("not a 32 bit little endian elf image") if(substr($elf, 0, 6) ne "\x7fELF\x01\x01");
+
+my($shoff) = unpack("V", substr($elf, 0x20, 4));
+my($shentsize, $shnum) = unpack("vv", substr($elf, 0x2e, 4));
+my($ix, $type, $address, $offset, $size);
+
+for($ix = 0; $ix < $shnum; $ix++)
+{
+	(undef, $type, undef, $address, $offset, $size) = unpack("VVVVVV", substr($elf, $shoff + ($ix * $shentsize), 24));
+
+	next if($type != 1); # PROGBITS
+	next if($address == 0);
+
+	push(@sections, { "address" => $address, "offset" => $offset, "size" => $size });
+}
+
+sub string_at
+{
+	my($address) = @_;
+	my($section, $start, $end);
+
+	for $section (@sections)
+	{
+		next if(($address < $$section{address}) || ($address >= ($$section{address} + $$section{size})));
+
+		$start = $$section{offset} + ($address - $$section{address});
+		$end = index($elf, "\0", $start);
+
+		return(substr($elf, $start, $end - $start));
+	}
+
+	return(undef);
+}
+
+sub render
+{
+	my($fmt, @args) = @_;
+	my($spec, $conversion, @converted);
+
+	# all arguments are 32 bit values, make signed conversions signed
+
+	while($fmt =~ m/%([-+ #0]*[0-9]*(?:\.[0-9]+)?(?:l|ll|h|hh)?)([a-zA-Z%])/go)
+	{
+		($spec, $conversion) = ($1, $2);
+
+		next if($conversion eq "%");
+
+		my($value) = shift(@args);
+
+		$value = 0 if(!defined($value));
+		$value -= 4294967296 if((($conversion eq "d") || ($conversion eq "i")) && ($value >= 2147483648));
+
+		push(@converted, $value);
+	}
+
+	$fmt =~ s/%([-+ #0]*[0-9]*(?:\.[0-9]+)?)(?:l|ll|h|hh)([a-zA-Z])/%$1$2/go;
+
+	return(sprintf($fmt, @converted));
+}
+
+my($seq, $timestamp, $fmt_address, @args, $fmt);
+
+while(<STDIN>)
+{
+	chomp();
+
+	next if(!(($seq, $timestamp, $fmt_address, @args) = m/^\s*([0-9]+)\s+([0-9a-f]+)\s+([0-9a-f]+)\s+([0-9a-f]+)\s+([0-9a-f]+)\s+([0-9a-f]+)\s+([0-9a-f]+)\s*$/io));
+
+	$timestamp = hex($timestamp);
+	$fmt = string_at(hex($fmt_address));
+
+	if(!defined($fmt))
+	{
+		printf("%u [%u.%06u] <format string at 0x%s not found>\n", $seq, $timestamp / 1000000, $timestamp % 1000000, $fmt_address);
+		next;
+	}
+
+	printf("%u [%u.%06u] %s", $seq, $timestamp / 1000000, $timestamp % 1000000, render($fmt, map { hex($_) } @args));
+}
@@ -77,9 +77,22 @@ bool attr_nonnull attr_pure lwip_if_received_udp(lwip_if_socket_t *socket)
 	return(socket->peer.port != 0);
 }
 
+static void tcp_feed(lwip_if_socket_t *socket);
+
 attr_nonnull void lwip_if_receive_buffer_unlock(lwip_if_socket_t *socket)
 {
 	socket->receive_buffer_locked = 0;
+
+	tcp_feed(socket);
+}
+
+attr_nonnull bool lwip_if_accepted(lwip_if_socket_t *socket)
+{
+	bool accepted = socket->accepted;
+
+	socket->accepted = 0;
+
+	return(accepted);
 }
 
 attr_nonnull attr_pure bool lwip_if_send_buffer_locked(lwip_if_socket_t *socket)
@@ -127,7 +140,7 @@ static void received_callback(bool tcp, lwip_if_socket_t *socket, struct pbuf *p
 		string_append_bytes(socket->receive_buffer, pbuf->payload, pbuf->len);
 	}
 
-    pbuf_free(pbuf_received);
+	pbuf_free(pbuf_received);
 
 	socket->receive_buffer_locked = 1;
 
@@ -141,10 +154,65 @@ static void udp_received_callback(void *callback_arg, struct udp_pcb *pcb, struc
 	received_callback(false, socket, pbuf_received, address, port);
 }
 
+// throttled sockets (the uart bridge) don't lose tcp data while the receive buffer is busy:
+// received tcp data is kept in a pbuf chain until it fits in the receive buffer and the buffer is unlocked;
+// the window is only opened (tcp_recved) for the data that has been moved into the buffer, which throttles
+// the peer, and the held data is fed as soon as the buffer is unlocked, without waiting for lwip to offer it again
+
+static void tcp_feed(lwip_if_socket_t *socket)
+{
+	struct pbuf *pbuf = (struct pbuf *)socket->tcp.pbuf_pending;
+	unsigned int length, current;
+
+	if(!pbuf || socket->receive_buffer_locked)
+		return;
+
+	current = string_length(socket->receive_buffer);
+	length = pbuf->tot_len - socket->tcp.pending_offset;
+
+	if(length > (unsigned int)(string_size(socket->receive_buffer) - current))
+		length = string_size(socket->receive_buffer) - current;
+
+	if(length == 0)
+		return;
+
+	pbuf_copy_partial(pbuf, string_buffer_nonconst(socket->receive_buffer) + current, length, socket->tcp.pending_offset);
+	string_setlength(socket->receive_buffer, current + length);
+
+	socket->tcp.pending_offset += length;
+
+	if(socket->tcp.pending_offset >= pbuf->tot_len)
+	{
+		pbuf_free(pbuf);
+		socket->tcp.pbuf_pending = (struct pbuf *)0;
+		socket->tcp.pending_offset = 0;
+	}
+
+	if(socket->tcp.pcb)
+		tcp_recved((struct tcp_pcb *)socket->tcp.pcb, length);
+
+	socket->peer.address = *IP_ADDR_ANY;
+	socket->peer.port = 0;
+	socket->receive_buffer_locked = 1;
+
+	socket->callback_data_received(socket, length);
+}
+
+static void tcp_pending_free(lwip_if_socket_t *socket)
+{
+	if(socket->tcp.pbuf_pending)
+		pbuf_free((struct pbuf *)socket->tcp.pbuf_pending);
+
+	socket->tcp.pbuf_pending = (struct pbuf *)0;
+	socket->tcp.pending_offset = 0;
+}
+
 static err_t tcp_received_callback(void *callback_arg, struct tcp_pcb *pcb, struct pbuf *pbuf, err_t error)
 {
 	lwip_if_socket_t *socket = (lwip_if_socket_t *)callback_arg;
 	struct tcp_pcb **pcb_tcp = (struct tcp_pcb **)&socket->tcp.pcb;
+	struct pbuf *pbuf_segment;
+	unsigned int length;
 
 	/* connection closed */
 	if((pcb == (struct tcp_pcb *)0) || (pbuf == (struct pbuf *)0))
@@ -193,9 +261,32 @@ static err_t tcp_received_callback(void *callback_arg, struct tcp_pcb *pcb, stru
 	if(pcb != *pcb_tcp)
 		log("tcp received callback: pcb != *pcb_tcp\n");
 
-	received_callback(true, socket, pbuf, 0, 0);
+	if(!socket->receive_throttle)
+	{
+		length = pbuf->tot_len;
+
+		received_callback(true, socket, pbuf, 0, 0);
+
+		tcp_recved(pcb, length);
 
-	tcp_recved(pcb, pbuf->tot_len);
+		return(ERR_OK);
+	}
+
+	for(pbuf_segment = pbuf; pbuf_segment; pbuf_segment = pbuf_segment->next)
+	{
+		stat_lwip_tcp_received_packets++;
+		stat_lwip_tcp_received_bytes += pbuf_segment->len;
+	}
+
+	if(socket->tcp.pbuf_pending)
+		pbuf_cat((struct pbuf *)socket->tcp.pbuf_pending, pbuf);
+	else
+		socket->tcp.pbuf_pending = pbuf;
+
+	if(socket->receive_buffer_locked)
+		stat_cmd_receive_buffer_held++;
+
+	tcp_feed(socket);
 
 	return(ERR_OK);
 }
@@ -257,7 +348,7 @@ static err_t tcp_sent_callback(void *callback_arg, struct tcp_pcb *pcb, u16_t le
 
 	if(len > socket->sent_remaining)
 	{
-		logf("tcp sent callback: acked (%u) > sent_remaining (%d)\n", len, socket->sent_remaining);
+		logd("tcp sent callback: acked (%u) > sent_remaining (%d)\n", len, socket->sent_remaining);
 		socket->sent_remaining = 0;
 	}
 	else
@@ -306,7 +397,12 @@ static err_t tcp_accepted_callback(void *callback_arg, struct tcp_pcb *pcb, err_
 		tcp_abort(*pcb_tcp);
 	}
 
+	// data still held from the previous connection isn't for the new peer
+
+	tcp_pending_free(socket);
+
 	*pcb_tcp = pcb;
+	socket->accepted = 1;
 
 	tcp_nagle_disable(*pcb_tcp);
 
@@ -318,6 +414,18 @@ static err_t tcp_accepted_callback(void *callback_arg, struct tcp_pcb *pcb, err_
 	return(ERR_OK);
 }
 
+static err_t tcp_connected_callback(void *callback_arg, struct tcp_pcb *pcb, err_t error)
+{
+	lwip_if_socket_t *socket = (lwip_if_socket_t *)callback_arg;
+
+	// data written while connecting has been queued, send it now
+
+	if(socket->sending_remaining > 0)
+		tcp_try_send_buffer(socket);
+
+	return(ERR_OK);
+}
+
 attr_nonnull bool lwip_if_close(lwip_if_socket_t *socket)
 {
 	err_t error;
@@ -325,7 +433,7 @@ attr_nonnull bool lwip_if_close(lwip_if_socket_t *socket)
 	if(lwip_if_received_udp(socket))
 		return(false);
 
-	if(!socket->tcp.listen_pcb)
+	if(!socket->tcp.listen_pcb && !socket->tcp.pcb)
 	{
 		log("lwip if close: tcp pcb is null\n");
 		return(false);
@@ -351,6 +459,40 @@ attr_nonnull bool lwip_if_close(lwip_if_socket_t *socket)
 	return(true);
 }
 
+// orderly close (FIN) instead of a reset, the pcb is detached from the socket and lwip completes the close
+// on its own, when lwip can't close it now (out of memory), it's aborted after all
+
+attr_nonnull bool lwip_if_shutdown(lwip_if_socket_t *socket)
+{
+	struct tcp_pcb *pcb = (struct tcp_pcb *)socket->tcp.pcb;
+	err_t error;
+
+	if(!pcb)
+	{
+		log("lwip if shutdown: not tcp connected\n");
+		return(false);
+	}
+
+	tcp_arg(pcb, (void *)0);
+	tcp_err(pcb, (tcp_err_fn)0);
+	tcp_recv(pcb, (tcp_recv_fn)0);
+	tcp_sent(pcb, (tcp_sent_fn)0);
+
+	if((error = tcp_close(pcb)) != ERR_OK)
+	{
+		log("lwip if shutdown: tcp_close failed, error: ");
+		log_error(error);
+		tcp_abort(pcb);
+	}
+
+	socket->tcp.pcb = (struct tcp_pcb *)0;
+	socket->sending_remaining = 0;
+	socket->sent_remaining = 0;
+	tcp_pending_free(socket);
+
+	return(true);
+}
+
 attr_nonnull bool lwip_if_sendto(lwip_if_socket_t *socket, const ip_addr_t *address, unsigned int port)
 {
 	err_t error;
@@ -408,13 +550,13 @@ attr_nonnull bool lwip_if_send(lwip_if_socket_t *socket)
 
 	if(socket->sending_remaining > 0)
 	{
-		logf("lwip if send: still sending %d bytes\n", socket->sending_remaining);
+		logd("lwip if send: still sending %d bytes\n", socket->sending_remaining);
 		return(false);
 	}
 
 	if(socket->sent_remaining > 0)
 	{
-		logf("lwip if send: still waiting for %d bytes to be sent\n", socket->sent_remaining);
+		logd("lwip if send: still waiting for %d bytes to be sent\n", socket->sent_remaining);
 		return(false);
 	}
 
@@ -505,7 +647,7 @@ attr_nonnull bool lwip_if_reboot(lwip_if_socket_t *socket)
 }
 
 attr_nonnull bool lwip_if_socket_create(lwip_if_socket_t *socket, string_t *receive_buffer, string_t *send_buffer,
-		unsigned int port, bool tcp, bool udp_term_empty, callback_data_received_fn_t callback_data_received)
+		unsigned int port, bool tcp, bool udp_term_empty, bool receive_throttle, callback_data_received_fn_t callback_data_received)
 {
 	err_t error;
 
@@ -518,9 +660,12 @@ attr_nonnull bool lwip_if_socket_create(lwip_if_socket_t *socket, string_t *rece
 	socket->send_buffer = send_buffer;
 	socket->sending_remaining = 0;
 	socket->sent_remaining = 0;
+	socket->tcp.pbuf_pending = (struct pbuf *)0;
+	socket->tcp.pending_offset = 0;
 	socket->receive_buffer_locked = 0;
 	socket->reboot_pending = 0;
 	socket->udp_term_empty = udp_term_empty ? 1 : 0;
+	socket->receive_throttle = receive_throttle ? 1 : 0;
 	socket->callback_data_received = callback_data_received;
 
 	if(!(socket->udp.pbuf_send = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_ROM)))
@@ -574,6 +719,63 @@ attr_nonnull bool lwip_if_socket_create(lwip_if_socket_t *socket, string_t *rece
 	return(true);
 }
 
+// outgoing tcp connection, data can be sent (queued) immediately, received data is handled like on a listening socket
+
+attr_nonnull bool lwip_if_connect(lwip_if_socket_t *socket, string_t *receive_buffer, string_t *send_buffer,
+		const ip_addr_t *address, unsigned int port, callback_data_received_fn_t callback_data_received)
+{
+	struct tcp_pcb *pcb;
+	err_t error;
+
+	socket->udp.pcb = (struct udp_pcb *)0;
+	socket->udp.pbuf_send = (struct pbuf *)0;
+	socket->tcp.listen_pcb = (struct tcp_pcb *)0;
+	socket->tcp.pcb = (struct tcp_pcb *)0;
+	socket->peer.address = ip_addr_any;
+	socket->peer.port = 0;
+	socket->receive_buffer = receive_buffer;
+	socket->send_buffer = send_buffer;
+	socket->sending_remaining = 0;
+	socket->sent_remaining = 0;
+	socket->tcp.pbuf_pending = (struct pbuf *)0;
+	socket->tcp.pending_offset = 0;
+	socket->receive_buffer_locked = 0;
+	socket->reboot_pending = 0;
+	socket->udp_term_empty = 0;
+	socket->receive_throttle = 0;
+	socket->callback_data_received = callback_data_received;
+
+	if(!(pcb = tcp_new()))
+	{
+		log("lwip if connect: tcp_new failed\n");
+		return(false);
+	}
+
+	tcp_arg(pcb, socket);
+	tcp_err(pcb, tcp_error_callback);
+	tcp_recv(pcb, tcp_received_callback);
+	tcp_sent(pcb, tcp_sent_callback);
+	tcp_nagle_disable(pcb);
+
+	socket->tcp.pcb = pcb;
+
+	if((error = tcp_connect(pcb, (ip_addr_t *)address, port, tcp_connected_callback)) != ERR_OK)
+	{
+		log("lwip if connect: tcp_connect failed: ");
+		log_error(error);
+		tcp_abort(pcb);
+		socket->tcp.pcb = (struct tcp_pcb *)0;
+		return(false);
+	}
+
+	return(true);
+}
+
+attr_nonnull bool lwip_if_connected(const lwip_if_socket_t *socket)
+{
+	return(socket->tcp.pcb != (void *)0);
+}
+
 bool attr_nonnull lwip_if_join_mc(int o1, int o2, int o3, int o4)
 {
 	struct ip_info info;
@@ -27,8 +27,10 @@ typedef struct _lwip_if_socket_t
 
 	struct
 	{
-		void *listen_pcb;
-		void *pcb;
+		void			*listen_pcb;
+		void			*pcb;
+		void			*pbuf_pending;
+		unsigned int	pending_offset;
 	} tcp;
 
 	struct
@@ -36,6 +38,8 @@ typedef struct _lwip_if_socket_t
 		unsigned int receive_buffer_locked:1;
 		unsigned int reboot_pending:1;
 		unsigned int udp_term_empty:1;
+		unsigned int accepted:1;
+		unsigned int receive_throttle:1;
 	};
 
 	struct
@@ -53,17 +57,22 @@ typedef struct _lwip_if_socket_t
 
 } lwip_if_socket_t;
 
-assert_size(lwip_if_socket_t, 48);
+assert_size(lwip_if_socket_t, 56);
 
 bool	attr_nonnull lwip_if_received_tcp(lwip_if_socket_t *);
 bool	attr_nonnull lwip_if_received_udp(lwip_if_socket_t *);
 void	attr_nonnull lwip_if_receive_buffer_unlock(lwip_if_socket_t *);
+bool	attr_nonnull lwip_if_accepted(lwip_if_socket_t *);
 bool	attr_nonnull lwip_if_send_buffer_locked(lwip_if_socket_t *);
 bool	attr_nonnull lwip_if_send(lwip_if_socket_t *socket);
 bool	attr_nonnull lwip_if_sendto(lwip_if_socket_t *socket, const ip_addr_t *address, unsigned int port);
 bool	attr_nonnull lwip_if_close(lwip_if_socket_t *socket);
+bool	attr_nonnull lwip_if_shutdown(lwip_if_socket_t *socket);
 bool	attr_nonnull lwip_if_reboot(lwip_if_socket_t *socket);
 bool	attr_nonnull lwip_if_socket_create(lwip_if_socket_t *socket, string_t *receive_buffer, string_t *send_buffer,
-			unsigned int port, bool tcp, bool flag_udp_term_empty, callback_data_received_fn_t callback_data_received);
+			unsigned int port, bool tcp, bool flag_udp_term_empty, bool receive_throttle, callback_data_received_fn_t callback_data_received);
+bool	attr_nonnull lwip_if_connect(lwip_if_socket_t *socket, string_t *receive_buffer, string_t *send_buffer,
+			const ip_addr_t *address, unsigned int port, callback_data_received_fn_t callback_data_received);
+bool	attr_nonnull lwip_if_connected(const lwip_if_socket_t *socket);
 bool	attr_nonnull lwip_if_join_mc(int o1, int o2, int o3, int o4);
 #endif
@@ -3,13 +3,306 @@
 #include "sys_string.h"
 #include "config.h"
 #include "dispatch.h"
+#include "flash_job.h"
 #include "rboot-interface.h"
+#include "lwip-interface.h"
 #include "sdk.h"
 
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+enum
+{
+	ota_stream_slots = 2,
+	ota_checksum_chunk = 256,
+};
+
+typedef enum
+{
+	ota_checksum_sha1,
+	ota_checksum_crc32,
+} ota_checksum_algorithm_t;
+
+typedef struct
+{
+	ota_checksum_algorithm_t	algorithm;
+	SHA_CTX						sha_context;
+	uint32_t					crc;
+} ota_checksum_t;
+
+// a checksum is either started by the user (flash-checksum-start) or by flash-fetch to verify the image,
+// only one can run at a time, the result is only passed on to flash-fetch if it started the checksum
+
+typedef enum
+{
+	ota_checksum_owner_user,
+	ota_checksum_owner_fetch,
+} ota_checksum_owner_t;
+
+typedef struct
+{
+	unsigned int	running:1;
+	unsigned int	done:1;
+	unsigned int	failed:1;
+	unsigned int	queue_full:1;
+	unsigned int	owner:1;
+	unsigned int	address;
+	unsigned int	length;
+	unsigned int	checksummed;
+	uint32_t		time_start;
+	uint32_t		time_finish;
+	ota_checksum_t	checksum;
+	char			result[SHA_DIGEST_LENGTH * 2 + 1];
+} ota_checksum_job_t;
+
+typedef struct
+{
+	string_t		*buffer;
+	int				sector;
+	unsigned int	received;
+} ota_stream_slot_t;
+
+static string_t *ota_buffer = (string_t *)0;
+static int ota_prefetch_sector = -1;
+static bool ota_flash_job_failed = false;
+static unsigned int ota_flash_job_failed_address;
+static ota_stream_slot_t ota_stream[ota_stream_slots];
+static ota_checksum_job_t ota_checksum_job;
+
+static void ota_fetch_checksum_done(bool success);
+static bool ota_fetch_busy(void);
+
+// crc32 (zlib compatible), processed per nibble to keep the table small
+
+static const uint32_t ota_crc32_table[16] =
+{
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+};
+
+static bool ota_checksum_parse_algorithm(unsigned int index, const string_t *src, ota_checksum_algorithm_t *algorithm)
+{
+	string_new(, name, 8);
+
+	*algorithm = ota_checksum_sha1;
+
+	if(parse_string(index, src, &name, ' ') != parse_ok)
+		return(true);
+
+	if(string_match_cstr(&name, "sha1"))
+		return(true);
+
+	if(string_match_cstr(&name, "crc32"))
+	{
+		*algorithm = ota_checksum_crc32;
+		return(true);
+	}
+
+	return(false);
+}
+
+static const char *ota_checksum_algorithm_name(ota_checksum_algorithm_t algorithm)
+{
+	return((algorithm == ota_checksum_crc32) ? "crc32" : "sha1");
+}
+
+static void ota_checksum_init(ota_checksum_t *checksum, ota_checksum_algorithm_t algorithm)
+{
+	checksum->algorithm = algorithm;
+
+	if(algorithm == ota_checksum_crc32)
+		checksum->crc = 0xffffffff;
+	else
+		SHA1Init(&checksum->sha_context);
+}
+
+static void ota_checksum_update(ota_checksum_t *checksum, const void *data, unsigned int length)
+{
+	const uint8_t *byte;
+	uint32_t crc;
+
+	if(checksum->algorithm != ota_checksum_crc32)
+	{
+		SHA1Update(&checksum->sha_context, data, length);
+		return;
+	}
+
+	for(byte = (const uint8_t *)data, crc = checksum->crc; length > 0; length--, byte++)
+	{
+		crc ^= *byte;
+		crc = (crc >> 4) ^ ota_crc32_table[crc & 0x0f];
+		crc = (crc >> 4) ^ ota_crc32_table[crc & 0x0f];
+	}
+
+	checksum->crc = crc;
+}
+
+static void ota_checksum_final(ota_checksum_t *checksum, string_t *dst)
+{
+	unsigned char sha_result[SHA_DIGEST_LENGTH];
+
+	if(checksum->algorithm == ota_checksum_crc32)
+		string_format(dst, "%08lx", checksum->crc ^ 0xffffffff);
+	else
+	{
+		SHA1Final(sha_result, &checksum->sha_context);
+		string_bin_to_hex(dst, sha_result, SHA_DIGEST_LENGTH);
+	}
+}
+
+static bool ota_buffer_lease(string_t *dst, const char *caller)
+{
+	if(!ota_buffer && !(ota_buffer = flash_buffer_lease(fsb_ota)))
+	{
+		string_format(dst, "ERROR flash-%s: no sector buffer available\n", caller);
+		return(false);
+	}
+
+	return(true);
+}
+
+static void ota_buffer_release(void)
+{
+	if(ota_buffer)
+	{
+		flash_buffer_release(ota_buffer);
+		ota_buffer = (string_t *)0;
+	}
+}
+
+static void ota_stream_reset(void)
+{
+	unsigned int slot;
+
+	for(slot = 0; slot < ota_stream_slots; slot++)
+	{
+		if(ota_stream[slot].buffer)
+			flash_buffer_release(ota_stream[slot].buffer);
+
+		ota_stream[slot].buffer = (string_t *)0;
+		ota_stream[slot].sector = -1;
+		ota_stream[slot].received = 0;
+	}
+}
+
+static void ota_flash_job_done(bool success, unsigned int address, void *context)
+{
+	if(context)
+		flash_buffer_release((string_t *)context);
+
+	if(!success && !ota_flash_job_failed)
+	{
+		logf("ota: background erase/write failed at %x\n", address);
+		ota_flash_job_failed = true;
+		ota_flash_job_failed_address = address;
+	}
+}
+
+static bool ota_flash_jobs_ok(string_t *dst, const char *caller)
+{
+	if(ota_flash_job_failed)
+	{
+		ota_flash_job_failed = false;
+		ota_prefetch_sector = -1;
+		string_format(dst, "ERROR flash-%s: previous erase/write failed at address: %u\n", caller, ota_flash_job_failed_address);
+		return(false);
+	}
+
+	return(true);
+}
+
+// compare a received sector with the flash contents and queue the erase and/or write when it differs,
+// the buffer is handed over to the flash job queue (or released when nothing needs to be written)
+
+static bool ota_sector_write(string_t *dst, const char *caller, string_t **buffer, unsigned int sector,
+		int *same, int *erase, string_t *sha_string)
+{
+	int byte;
+	const char *ptr;
+	SHA_CTX sha_context;
+	unsigned char sha_result[SHA_DIGEST_LENGTH];
+	SpiFlashOpResult flash_result;
+	flash_job_type_t job_type;
+
+	// a sector that's still queued for erase or write must be complete before it can be compared
+
+	if(flash_job_pending_sector(sector))
+		flash_job_flush();
+
+	*same = 0;
+	*erase = 0;
+
+	if((int)sector == ota_prefetch_sector)
+	{
+		// the erase has been queued before, the sector is empty when this write is executed
+
+		ota_prefetch_sector = -1;
+		*erase = 1;
+		job_type = flash_job_write;
+	}
+	else
+	{
+		flash_result = spi_flash_read(sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(dst), SPI_FLASH_SEC_SIZE);
+
+		if(flash_result == SPI_FLASH_RESULT_ERR)
+		{
+			string_format(dst, "ERROR: flash-%s: read error\n", caller);
+			return(false);
+		}
+
+		if(flash_result == SPI_FLASH_RESULT_TIMEOUT)
+		{
+			string_format(dst, "ERROR: flash-%s: read timeout\n", caller);
+			return(false);
+		}
+
+		if(!memcmp(string_buffer(*buffer), string_buffer(dst), SPI_FLASH_SEC_SIZE))
+			*same = 1;
+
+		for(byte = 0, ptr = string_buffer(dst); !*same && (byte < SPI_FLASH_SEC_SIZE); byte++, ptr++)
+		{
+			if(*(const uint8_t *)ptr != 0xff)
+			{
+				*erase = 1;
+				break;
+			}
+		}
+
+		job_type = *erase ? flash_job_erase_write : flash_job_write;
+	}
+
+	SHA1Init(&sha_context);
+	SHA1Update(&sha_context, string_buffer(*buffer), SPI_FLASH_SEC_SIZE);
+	SHA1Final(sha_result, &sha_context);
+	string_bin_to_hex(sha_string, sha_result, SHA_DIGEST_LENGTH);
+
+	if(*same)
+	{
+		flash_buffer_release(*buffer);
+		*buffer = (string_t *)0;
+		return(true);
+	}
+
+	// the erase, write and read back are done in the background, the buffer is released when the job is complete,
+	// a failure is reported by the next flash command
+
+	if(!flash_job_submit(job_type, sector * SPI_FLASH_SEC_SIZE, string_buffer(*buffer), SPI_FLASH_SEC_SIZE, ota_flash_job_done, *buffer))
+	{
+		flash_job_flush();
+
+		if(!flash_job_submit(job_type, sector * SPI_FLASH_SEC_SIZE, string_buffer(*buffer), SPI_FLASH_SEC_SIZE, ota_flash_job_done, *buffer))
+		{
+			string_format(dst, "ERROR: flash-%s: cannot queue write\n", caller);
+			return(false);
+		}
+	}
+
+	*buffer = (string_t *)0;
+
+	return(true);
+}
+
 app_action_t application_function_flash_info(string_t *src, string_t *dst)
 {
 	int ota_available = 0;
@@ -42,8 +335,20 @@ app_action_t application_function_flash_info(string_t *src, string_t *dst)
 		ota_slot = rtc.last_slot;
 #endif
 
-	if(flash_sector_buffer_use == fsb_ota)
-		flash_sector_buffer_use = fsb_free;
+	// flash-fetch uses the flash jobs and the checksum job in the background, don't pull them away from under it
+
+	if(ota_fetch_busy())
+	{
+		string_append(dst, "ERROR flash-info: flash-fetch running\n");
+		return(app_action_error);
+	}
+
+	flash_job_flush();
+	ota_buffer_release();
+	ota_stream_reset();
+	ota_checksum_job.running = 0;
+	ota_prefetch_sector = -1;
+	ota_flash_job_failed = false;
 
 	string_format(dst, "OK flash function available, "
 				"sector size: %d bytes, "
@@ -92,6 +397,9 @@ app_action_t application_function_flash_erase(string_t *src, string_t *dst)
 	if((length % SPI_FLASH_SEC_SIZE) != 0)
 		sector_count++;
 
+	flash_job_flush();
+	ota_prefetch_sector = -1;
+
 	time_start = system_get_time();
 
 	for(erased = 0; erased < sector_count; erased++)
@@ -167,24 +475,144 @@ app_action_t application_function_flash_send(string_t *src, string_t *dst)
 		return(app_action_error);
 	}
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
+	if(!ota_buffer_lease(dst, "send"))
+		return(app_action_error);
+
+	string_splice(ota_buffer, offset, src, chunk_offset, chunk_length);
+
+	string_format(dst, "OK flash-send: received bytes: %u, at offset: %u\n", length, offset);
+
+	return(app_action_normal);
+}
+
+// flash-stream <sector> <chunk offset> <chunk length> <data>
+// receive a sector in chunks, tagged with the sector it's destined for; the sectors alternate between two buffers,
+// as soon as the last chunk of a sector is in, its erase/write/verify is queued in the background,
+// while the host already streams the next sector into the other buffer, without a flash-write round trip
+
+app_action_t application_function_flash_stream(string_t *src, string_t *dst)
+{
+	unsigned int sector, offset, length, chunk_length;
+	int chunk_offset, same, erase;
+	ota_stream_slot_t *slot;
+	string_new(, sha_string, SHA_DIGEST_LENGTH * 2 + 2);
+
+	if(string_size(dst) < SPI_FLASH_SEC_SIZE)
 	{
-		string_format(dst, "ERROR flash-send: flash sector buffer too small: %d\n", string_size(&flash_sector_buffer));
+		string_format(dst, "ERROR flash-stream: dst buffer too small: %d\n", string_size(dst));
 		return(app_action_error);
 	}
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache) &&
-			(flash_sector_buffer_use != fsb_ota) && (flash_sector_buffer_use != fsb_display_picture))
+	if(parse_uint(1, src, &sector, 0, ' ') != parse_ok)
 	{
-		string_format(dst, "ERROR flash_send: sector buffer in use: %u\n", flash_sector_buffer_use);
+		string_append(dst, "ERROR flash-stream: sector required\n");
 		return(app_action_error);
 	}
 
-	flash_sector_buffer_use = fsb_ota;
+	if(parse_uint(2, src, &offset, 0, ' ') != parse_ok)
+	{
+		string_append(dst, "ERROR flash-stream: offset required\n");
+		return(app_action_error);
+	}
 
-	string_splice(&flash_sector_buffer, offset, src, chunk_offset, chunk_length);
+	if(parse_uint(3, src, &length, 0, ' ') != parse_ok)
+	{
+		string_append(dst, "ERROR flash-stream: length required\n");
+		return(app_action_error);
+	}
 
-	string_format(dst, "OK flash-send: received bytes: %u, at offset: %u\n", length, offset);
+	if((length == 0) || ((offset % length) != 0) || ((SPI_FLASH_SEC_SIZE % length) != 0))
+	{
+		string_append(dst, "ERROR flash-stream: chunk length should be divisible by flash sector size and chunk offset by chunk size\n");
+		return(app_action_error);
+	}
+
+	if((offset + length) > SPI_FLASH_SEC_SIZE)
+	{
+		string_format(dst, "ERROR flash-stream: length(%u) + offset(%u) > sector size(%d)\n", offset, length, SPI_FLASH_SEC_SIZE);
+		return(app_action_error);
+	}
+
+	if((chunk_offset = string_sep(src, 0, 4, ' ')) < 0)
+	{
+		string_append(dst, "ERROR flash-stream: missing data\n");
+		return(app_action_error);
+	}
+
+	if((chunk_length = string_length(src) - chunk_offset) != length)
+	{
+		string_format(dst, "ERROR flash-stream: data length mismatch: %u != %u\n", length, chunk_length);
+		return(app_action_error);
+	}
+
+	if(!ota_flash_jobs_ok(dst, "stream"))
+		return(app_action_error);
+
+	slot = &ota_stream[sector % ota_stream_slots];
+
+	// a partially received different sector in this slot has been abandoned by the host
+
+	if(slot->buffer && (slot->sector != (int)sector))
+	{
+		flash_buffer_release(slot->buffer);
+		slot->buffer = (string_t *)0;
+	}
+
+	if(!slot->buffer)
+	{
+		if(offset != 0)
+		{
+			string_format(dst, "ERROR flash-stream: sector %u should start at offset 0\n", sector);
+			return(app_action_error);
+		}
+
+		if(!(slot->buffer = flash_buffer_lease(fsb_ota)))
+		{
+			string_append(dst, "ERROR flash-stream: no sector buffer available\n");
+			return(app_action_error);
+		}
+
+		slot->sector = sector;
+		slot->received = 0;
+	}
+
+	// chunks must arrive in order, a retransmitted chunk is accepted
+
+	if(offset > slot->received)
+	{
+		string_format(dst, "ERROR flash-stream: chunk out of order, offset: %u, expected: %u\n", offset, slot->received);
+		return(app_action_error);
+	}
+
+	string_splice(slot->buffer, offset, src, chunk_offset, chunk_length);
+
+	if((offset + length) > slot->received)
+		slot->received = offset + length;
+
+	if(slot->received < SPI_FLASH_SEC_SIZE)
+	{
+		string_format(dst, "OK flash-stream: received bytes: %u, at offset: %u, sector: %u, complete: 0\n", length, offset, sector);
+		return(app_action_normal);
+	}
+
+	slot->sector = -1;
+	slot->received = 0;
+
+	if(!ota_sector_write(dst, "stream", &slot->buffer, sector, &same, &erase, &sha_string))
+	{
+		if(slot->buffer)
+		{
+			flash_buffer_release(slot->buffer);
+			slot->buffer = (string_t *)0;
+		}
+
+		return(app_action_error);
+	}
+
+	string_format(dst, "OK flash-stream: received bytes: %u, at offset: %u, sector: %u, complete: 1, same: %d, erased: %d, checksum: ",
+			length, offset, sector, same, erase);
+	string_append_string(dst, &sha_string);
+	string_append(dst, "\n");
 
 	return(app_action_normal);
 }
@@ -193,12 +621,6 @@ app_action_t application_function_flash_receive(string_t *src, string_t *dst)
 {
 	unsigned int chunk_offset, chunk_length;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		string_format(dst, "ERROR flash-receive: flash sector buffer too small: %d\n", string_size(&flash_sector_buffer));
-		return(app_action_error);
-	}
-
 	if(parse_uint(1, src, &chunk_offset, 0, ' ') != parse_ok)
 	{
 		string_append(dst, "ERROR flash-receive: chunk offset required\n");
@@ -229,21 +651,18 @@ app_action_t application_function_flash_receive(string_t *src, string_t *dst)
 		return(app_action_error);
 	}
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache) &&
-			(flash_sector_buffer_use != fsb_ota) && (flash_sector_buffer_use != fsb_display_picture))
+	if(!ota_buffer)
 	{
-		string_format(dst, "ERROR: flash_send: sector buffer in use: %u\n", flash_sector_buffer_use);
+		string_append(dst, "ERROR flash-receive: no sector read\n");
 		return(app_action_error);
 	}
 
-	flash_sector_buffer_use = fsb_ota;
-
 	string_format(dst, "OK flash-receive: sending bytes: %u, from offset: %u, data: @", chunk_length, chunk_offset);
-	string_splice(dst, -1, &flash_sector_buffer, chunk_offset, chunk_length);
+	string_splice(dst, -1, ota_buffer, chunk_offset, chunk_length);
 	string_append(dst, "\n");
 
 	if((chunk_offset + chunk_length) >= SPI_FLASH_SEC_SIZE)
-		flash_sector_buffer_use = fsb_free;
+		ota_buffer_release();
 
 	return(app_action_normal);
 }
@@ -256,12 +675,6 @@ app_action_t application_function_flash_read(string_t *src, string_t *dst)
 	string_new(, sha_string, SHA_DIGEST_LENGTH * 2 + 2);
 	SpiFlashOpResult flash_result;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		string_format(dst, "ERROR flash-read: flash sector buffer too small: %d\n", string_size(&flash_sector_buffer));
-		return(app_action_error);
-	}
-
 	if(parse_uint(1, src, &address, 0, ' ') != parse_ok)
 	{
 		string_append(dst, "ERROR flash-read: address required\n");
@@ -274,18 +687,17 @@ app_action_t application_function_flash_read(string_t *src, string_t *dst)
 		return(app_action_error);
 	}
 
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache) &&
-			(flash_sector_buffer_use != fsb_display_picture))
-	{
-		string_format(dst, "ERROR: flash-read: sector buffer in use: %u\n", flash_sector_buffer_use);
+	flash_job_flush();
+
+	if(!ota_flash_jobs_ok(dst, "read"))
 		return(app_action_error);
-	}
 
-	flash_sector_buffer_use = fsb_ota;
+	if(!ota_buffer_lease(dst, "read"))
+		return(app_action_error);
 
 	sector = address / SPI_FLASH_SEC_SIZE;
-	flash_result = spi_flash_read(sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(&flash_sector_buffer), SPI_FLASH_SEC_SIZE);
-	string_setlength(&flash_sector_buffer, SPI_FLASH_SEC_SIZE);
+	flash_result = spi_flash_read(sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(ota_buffer), SPI_FLASH_SEC_SIZE);
+	string_setlength(ota_buffer, SPI_FLASH_SEC_SIZE);
 
 	if(flash_result == SPI_FLASH_RESULT_ERR)
 	{
@@ -300,7 +712,7 @@ app_action_t application_function_flash_read(string_t *src, string_t *dst)
 	}
 
 	SHA1Init(&sha_context);
-	SHA1Update(&sha_context, string_buffer(&flash_sector_buffer), SPI_FLASH_SEC_SIZE);
+	SHA1Update(&sha_context, string_buffer(ota_buffer), SPI_FLASH_SEC_SIZE);
 	SHA1Final(sha_result, &sha_context);
 	string_bin_to_hex(&sha_string, sha_result, SHA_DIGEST_LENGTH);
 
@@ -313,23 +725,14 @@ app_action_t application_function_flash_read(string_t *src, string_t *dst)
 
 static app_action_t flash_write_verify_(string_t *src, string_t *dst, bool verify)
 {
-	unsigned int address, sector;
-	int byte;
-	int same = 0;
-	int erase = 1;
-	const char *ptr;
+	unsigned int address, sector, next_address;
+	int same, erase;
 	const char *caller = verify ? "verify" : "write";
 	SHA_CTX sha_context;
 	unsigned char sha_result[SHA_DIGEST_LENGTH];
 	string_new(, sha_string, SHA_DIGEST_LENGTH * 2 + 2);
 	SpiFlashOpResult flash_result;
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-	{
-		string_format(dst, "ERROR flash-%s: flash sector buffer too small: %d\n", caller, string_size(&flash_sector_buffer));
-		return(app_action_error);
-	}
-
 	if(string_size(dst) < SPI_FLASH_SEC_SIZE)
 	{
 		string_format(dst, "ERROR flash-%s: dst buffer too small: %d\n", caller, string_size(dst));
@@ -348,98 +751,61 @@ static app_action_t flash_write_verify_(string_t *src, string_t *dst, bool verif
 		return(app_action_error);
 	}
 
-	if(flash_sector_buffer_use != fsb_ota)
-	{
-		string_format(dst, "ERROR: flash-%s: sector buffer in use: %u\n", caller, flash_sector_buffer_use);
-		return(app_action_error);
-	}
-
-	sector = address / SPI_FLASH_SEC_SIZE;
-	flash_result = spi_flash_read(sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(dst), SPI_FLASH_SEC_SIZE);
-
-	if(flash_result == SPI_FLASH_RESULT_ERR)
+	if(!ota_buffer)
 	{
-		string_format(dst, "ERROR: flash-%s: read error\n", caller);
+		string_format(dst, "ERROR: flash-%s: no data sent\n", caller);
 		return(app_action_error);
 	}
 
-	if(flash_result == SPI_FLASH_RESULT_TIMEOUT)
-	{
-		string_format(dst, "ERROR: flash-%s: read timeout\n", caller);
+	if(!ota_flash_jobs_ok(dst, caller))
 		return(app_action_error);
-	}
 
-	erase = 0;
-	same = 0;
-	SHA1Init(&sha_context);
+	sector = address / SPI_FLASH_SEC_SIZE;
 
 	if(verify)
 	{
-		if(!memcmp(string_buffer(&flash_sector_buffer), string_buffer(dst), SPI_FLASH_SEC_SIZE))
-			same = 1;
+		flash_job_flush();
 
-		SHA1Update(&sha_context, string_buffer(dst), SPI_FLASH_SEC_SIZE);
-	}
-	else
-	{
-		if(memcmp(string_buffer(&flash_sector_buffer), string_buffer(dst), SPI_FLASH_SEC_SIZE))
-		{
-			for(byte = 0, ptr = string_buffer(dst); byte < SPI_FLASH_SEC_SIZE; byte++, ptr++)
-			{
-				if(*(const uint8_t *)ptr != 0xff)
-				{
-					erase = 1;
-					break;
-				}
-			}
+		flash_result = spi_flash_read(sector * SPI_FLASH_SEC_SIZE, string_buffer_nonconst(dst), SPI_FLASH_SEC_SIZE);
 
-			if(erase)
-			{
-				flash_result = spi_flash_erase_sector(sector);
-
-				if(flash_result == SPI_FLASH_RESULT_ERR)
-				{
-					string_format(dst, "ERROR: flash-%s: erase error\n", caller);
-					return(app_action_error);
-				}
-
-				if(flash_result == SPI_FLASH_RESULT_TIMEOUT)
-				{
-					string_format(dst, "ERROR: flash-%s: erase timeout\n", caller);
-					return(app_action_error);
-				}
-			}
+		if(flash_result == SPI_FLASH_RESULT_ERR)
+		{
+			string_format(dst, "ERROR: flash-%s: read error\n", caller);
+			return(app_action_error);
+		}
 
-			flash_result = spi_flash_write(sector * SPI_FLASH_SEC_SIZE, string_buffer(&flash_sector_buffer), SPI_FLASH_SEC_SIZE);
+		if(flash_result == SPI_FLASH_RESULT_TIMEOUT)
+		{
+			string_format(dst, "ERROR: flash-%s: read timeout\n", caller);
+			return(app_action_error);
+		}
 
-			if(flash_result == SPI_FLASH_RESULT_ERR)
-			{
-				string_format(dst, "ERROR: flash-%s: read error\n", caller);
-				return(app_action_error);
-			}
+		same = !memcmp(string_buffer(ota_buffer), string_buffer(dst), SPI_FLASH_SEC_SIZE);
 
-			if(flash_result == SPI_FLASH_RESULT_TIMEOUT)
-			{
-				string_format(dst, "ERROR: flash-%s: read timeout\n", caller);
-				return(app_action_error);
-			}
-		}
-		else
-			same = 1;
+		SHA1Init(&sha_context);
+		SHA1Update(&sha_context, string_buffer(dst), SPI_FLASH_SEC_SIZE);
+		SHA1Final(sha_result, &sha_context);
+		string_bin_to_hex(&sha_string, sha_result, SHA_DIGEST_LENGTH);
+		ota_buffer_release();
+
+		string_format(dst, "OK flash-verify: verified bytes: %d, at address: %u (%u), same: %d, checksum: ", SPI_FLASH_SEC_SIZE, address, sector, same);
+		string_append_string(dst, &sha_string);
+		string_append(dst, "\n");
 
-		SHA1Update(&sha_context, string_buffer(&flash_sector_buffer), SPI_FLASH_SEC_SIZE);
+		return(app_action_normal);
 	}
 
-	SHA1Final(sha_result, &sha_context);
-	string_bin_to_hex(&sha_string, sha_result, SHA_DIGEST_LENGTH);
+	if(!ota_sector_write(dst, caller, &ota_buffer, sector, &same, &erase, &sha_string))
+		return(app_action_error);
 
-	flash_sector_buffer_use = fsb_free;
+	// optionally erase the sector that's going to be written next, while it's being received
 
-	if(verify)
-		string_format(dst, "OK flash-verify: verified bytes: %d, at address: %u (%u), same: %d, checksum: ", SPI_FLASH_SEC_SIZE, address, sector, same);
-	else
-		string_format(dst, "OK flash-write: written bytes: %d, to address: %u (%u), same: %d, erased: %d, checksum: ", SPI_FLASH_SEC_SIZE, address, sector, same, erase);
+	if((parse_uint(2, src, &next_address, 0, ' ') == parse_ok) && ((next_address % SPI_FLASH_SEC_SIZE) == 0) &&
+			((next_address / SPI_FLASH_SEC_SIZE) != sector) &&
+			flash_job_submit(flash_job_erase, next_address, (const void *)0, 0, ota_flash_job_done, (void *)0))
+		ota_prefetch_sector = next_address / SPI_FLASH_SEC_SIZE;
 
+	string_format(dst, "OK flash-write: written bytes: %d, to address: %u (%u), same: %d, erased: %d, checksum: ", SPI_FLASH_SEC_SIZE, address, sector, same, erase);
 	string_append_string(dst, &sha_string);
 	string_append(dst, "\n");
 
@@ -460,10 +826,9 @@ app_action_t application_function_flash_checksum(string_t *src, string_t *dst)
 {
 	unsigned int address, current, length, done;
 	SpiFlashOpResult flash_result;
-
-	SHA_CTX sha_context;
-	unsigned char sha_result[SHA_DIGEST_LENGTH];
-	string_new(, sha_string, SHA_DIGEST_LENGTH * 2 + 2);
+	ota_checksum_algorithm_t algorithm;
+	ota_checksum_t checksum;
+	string_new(, checksum_string, SHA_DIGEST_LENGTH * 2 + 2);
 
 	if(parse_uint(1, src, &address, 0, ' ') != parse_ok)
 	{
@@ -489,10 +854,23 @@ app_action_t application_function_flash_checksum(string_t *src, string_t *dst)
 		return(app_action_error);
 	}
 
-	SHA1Init(&sha_context);
+	if(!ota_checksum_parse_algorithm(3, src, &algorithm))
+	{
+		string_append(dst, "ERROR: flash_checksum: algorithm should be sha1 or crc32\n");
+		return(app_action_error);
+	}
+
+	flash_job_flush();
+
+	if(!ota_flash_jobs_ok(dst, "checksum"))
+		return(app_action_error);
+
+	ota_checksum_init(&checksum, algorithm);
 
 	for(current = address, done = 0; done < length; current += SPI_FLASH_SEC_SIZE, done += SPI_FLASH_SEC_SIZE)
 	{
+		system_soft_wdt_feed();
+
 		flash_result = spi_flash_read(current, string_buffer_nonconst(dst), SPI_FLASH_SEC_SIZE);
 
 		if(flash_result == SPI_FLASH_RESULT_ERR)
@@ -507,42 +885,201 @@ app_action_t application_function_flash_checksum(string_t *src, string_t *dst)
 			return(app_action_error);
 		}
 
-		SHA1Update(&sha_context, string_buffer(dst), SPI_FLASH_SEC_SIZE);
+		ota_checksum_update(&checksum, string_buffer(dst), SPI_FLASH_SEC_SIZE);
 	}
 
-	SHA1Final(sha_result, &sha_context);
-	string_bin_to_hex(&sha_string, sha_result, SHA_DIGEST_LENGTH);
+	ota_checksum_final(&checksum, &checksum_string);
 
 	string_clear(dst);
 	string_format(dst, "OK flash-checksum: checksummed bytes: %u, from address: %u, checksum: ", done, address);
-	string_append_string(dst, &sha_string);
+	string_append_string(dst, &checksum_string);
 	string_append(dst, "\n");
 
 	return(app_action_normal);
 }
 
-static app_action_t flash_select(string_t *src, string_t *dst, bool once)
+// checksum one sector per task invocation, so a large range doesn't stall the other tasks or trip the watchdog
+
+void ota_checksum_run(void)
 {
-	const char *cmdname = once ? "flash-select-once" : "flash-select";
+	uint32_t chunk[ota_checksum_chunk / sizeof(uint32_t)];
+	unsigned int address, offset, size;
+	string_t result;
 
-#if IMAGE_OTA == 0
-	string_format(dst, "ERROR %s: no OTA image\n", cmdname);
-	return(app_action_error);
-#else
-	unsigned int slot;
+	if(!ota_checksum_job.running)
+		return;
 
-	rboot_if_config_t config;
-	rboot_if_rtc_config_t rtc;
+	address = ota_checksum_job.address + ota_checksum_job.checksummed;
 
-	if(!rboot_if_read_config(&config))
+	if(flash_job_pending_sector(address / SPI_FLASH_SEC_SIZE))
+		flash_job_flush();
+
+	for(offset = 0; (offset < SPI_FLASH_SEC_SIZE) && (ota_checksum_job.checksummed < ota_checksum_job.length); offset += size)
 	{
-		string_format(dst, "ERROR %s: rboot config invalid\n", cmdname);
+		size = ota_checksum_job.length - ota_checksum_job.checksummed;
+
+		if(size > sizeof(chunk))
+			size = sizeof(chunk);
+
+		if(spi_flash_read(address + offset, chunk, sizeof(chunk)) != SPI_FLASH_RESULT_OK)
+		{
+			ota_checksum_job.running = 0;
+			ota_checksum_job.failed = 1;
+
+			if(ota_checksum_job.owner == ota_checksum_owner_fetch)
+				ota_fetch_checksum_done(false);
+
+			return;
+		}
+
+		ota_checksum_update(&ota_checksum_job.checksum, chunk, size);
+		ota_checksum_job.checksummed += size;
+	}
+
+	if(ota_checksum_job.checksummed < ota_checksum_job.length)
+	{
+		// the task queue is full, stop instead of hanging as running, flash-fetch starts it again
+
+		if(!dispatch_post_task(2, task_flash_checksum, 0))
+		{
+			ota_checksum_job.running = 0;
+			ota_checksum_job.failed = 1;
+			ota_checksum_job.queue_full = 1;
+		}
+
+		return;
+	}
+
+	string_set(&result, ota_checksum_job.result, sizeof(ota_checksum_job.result), 0);
+	ota_checksum_final(&ota_checksum_job.checksum, &result);
+	string_to_cstr(&result);
+
+	ota_checksum_job.time_finish = system_get_time();
+	ota_checksum_job.running = 0;
+	ota_checksum_job.done = 1;
+
+	if(ota_checksum_job.owner == ota_checksum_owner_fetch)
+		ota_fetch_checksum_done(true);
+}
+
+// returns false if the task queue is full, the checksum is not running then
+
+static bool ota_checksum_start(ota_checksum_owner_t owner, unsigned int address, unsigned int length, ota_checksum_algorithm_t algorithm)
+{
+	ota_checksum_job.running = 1;
+	ota_checksum_job.owner = owner;
+	ota_checksum_job.done = 0;
+	ota_checksum_job.failed = 0;
+	ota_checksum_job.queue_full = 0;
+	ota_checksum_job.address = address;
+	ota_checksum_job.length = length;
+	ota_checksum_job.checksummed = 0;
+	ota_checksum_job.time_start = system_get_time();
+	ota_checksum_job.time_finish = ota_checksum_job.time_start;
+	ota_checksum_job.result[0] = '\0';
+	ota_checksum_init(&ota_checksum_job.checksum, algorithm);
+
+	if(!dispatch_post_task(2, task_flash_checksum, 0))
+	{
+		ota_checksum_job.running = 0;
+		return(false);
+	}
+
+	return(true);
+}
+
+app_action_t application_function_flash_checksum_start(string_t *src, string_t *dst)
+{
+	unsigned int address, length;
+	ota_checksum_algorithm_t algorithm;
+
+	if(ota_checksum_job.running)
+	{
+		string_format(dst, "ERROR flash-checksum-start: checksum already running, checksummed bytes: %u\n", ota_checksum_job.checksummed);
 		return(app_action_error);
 	}
 
-	if(parse_uint(1, src, &slot, 0, ' ') != parse_ok)
+	if(parse_uint(1, src, &address, 0, ' ') != parse_ok)
 	{
-		string_format(dst, "ERROR %s: slot required\n", cmdname);
+		string_append(dst, "ERROR flash-checksum-start: address required\n");
+		return(app_action_error);
+	}
+
+	if(parse_uint(2, src, &length, 0, ' ') != parse_ok)
+	{
+		string_append(dst, "ERROR flash-checksum-start: length required\n");
+		return(app_action_error);
+	}
+
+	if(((address % SPI_FLASH_SEC_SIZE) != 0) || ((length % SPI_FLASH_SEC_SIZE) != 0) || (length == 0))
+	{
+		string_append(dst, "ERROR flash-checksum-start: address and length should be divisible by flash sector size\n");
+		return(app_action_error);
+	}
+
+	if(!ota_checksum_parse_algorithm(3, src, &algorithm))
+	{
+		string_append(dst, "ERROR flash-checksum-start: algorithm should be sha1 or crc32\n");
+		return(app_action_error);
+	}
+
+	if(!ota_flash_jobs_ok(dst, "checksum-start"))
+		return(app_action_error);
+
+	if(!ota_checksum_start(ota_checksum_owner_user, address, length, algorithm))
+	{
+		string_append(dst, "ERROR flash-checksum-start: task queue full, try again\n");
+		return(app_action_error);
+	}
+
+	string_format(dst, "OK flash-checksum-start: address: %u, length: %u, algorithm: %s\n",
+			address, length, ota_checksum_algorithm_name(algorithm));
+
+	return(app_action_normal);
+}
+
+app_action_t application_function_flash_checksum_status(string_t *src, string_t *dst)
+{
+	const ota_checksum_job_t *job = &ota_checksum_job;
+
+	if(job->failed)
+	{
+		string_format(dst, "ERROR flash-checksum-status: %s at address: %u\n",
+				job->queue_full ? "stopped, task queue full" : "read error", job->address + job->checksummed);
+		return(app_action_error);
+	}
+
+	if(!job->running && !job->done)
+	{
+		string_append(dst, "ERROR flash-checksum-status: no checksum started\n");
+		return(app_action_error);
+	}
+
+	string_format(dst, "OK flash-checksum-status: done: %u, checksummed bytes: %u, of: %u (%u%%), from address: %u, algorithm: %s, milliseconds: %lu",
+			job->done, job->checksummed, job->length, (unsigned int)(((uint64_t)job->checksummed * 100) / job->length),
+			job->address, ota_checksum_algorithm_name(job->checksum.algorithm),
+			((job->done ? job->time_finish : system_get_time()) - job->time_start) / 1000);
+
+	if(job->done)
+		string_format(dst, ", checksum: %s", job->result);
+
+	string_append(dst, "\n");
+
+	return(app_action_normal);
+}
+
+#if IMAGE_OTA == 1
+// dst must be able to hold a flash sector, it's used as scratch buffer for updating the rboot config
+
+static app_action_t flash_select_slot(unsigned int slot, string_t *dst, bool once)
+{
+	const char *cmdname = once ? "flash-select-once" : "flash-select";
+	rboot_if_config_t config;
+	rboot_if_rtc_config_t rtc;
+
+	if(!rboot_if_read_config(&config))
+	{
+		string_format(dst, "ERROR %s: rboot config invalid\n", cmdname);
 		return(app_action_error);
 	}
 
@@ -649,6 +1186,31 @@ static app_action_t flash_select(string_t *src, string_t *dst, bool once)
 	string_format(dst, "OK %s: slot %u selected, address %lu\n", cmdname, slot, config.slots[slot]);
 
 	return(app_action_normal);
+}
+#endif
+
+static app_action_t flash_select(string_t *src, string_t *dst, bool once)
+{
+	const char *cmdname = once ? "flash-select-once" : "flash-select";
+
+#if IMAGE_OTA == 0
+	string_format(dst, "ERROR %s: no OTA image\n", cmdname);
+	return(app_action_error);
+#else
+	unsigned int slot;
+
+	flash_job_flush();
+
+	if(!ota_flash_jobs_ok(dst, once ? "select-once" : "select"))
+		return(app_action_error);
+
+	if(parse_uint(1, src, &slot, 0, ' ') != parse_ok)
+	{
+		string_format(dst, "ERROR %s: slot required\n", cmdname);
+		return(app_action_error);
+	}
+
+	return(flash_select_slot(slot, dst, once));
 #endif
 }
 
@@ -661,3 +1223,566 @@ app_action_t application_function_flash_select_once(string_t *src, string_t *dst
 {
 	return(flash_select(src, dst, true));
 }
+
+#if IMAGE_OTA == 1
+// flash-fetch: pull an image from a http server into an (inactive) slot,
+// the body is written per sector in the background while it's being received
+
+enum
+{
+	ota_fetch_timer_interval = 100,
+	ota_fetch_timeout_ticks = 100,
+	ota_fetch_verify_timeout_ticks = 600,
+};
+
+typedef enum
+{
+	ota_fetch_idle,
+	ota_fetch_header,
+	ota_fetch_body,
+	ota_fetch_verify,
+	ota_fetch_done,
+	ota_fetch_failed,
+} ota_fetch_state_t;
+
+typedef struct
+{
+	ota_fetch_state_t	state;
+	unsigned int		close:1;
+	unsigned int		verify_started:1;
+	unsigned int		permanent:1;
+	unsigned int		flash_failed:1;
+	unsigned int		flash_failed_address;
+	unsigned int		slot;
+	unsigned int		address;
+	unsigned int		content_length;
+	unsigned int		received;
+	unsigned int		written;
+	unsigned int		idle_ticks;
+	int					http_status;
+	string_t			*buffer;
+	uint32_t			time_start;
+	uint32_t			time_finish;
+	SHA_CTX				sha_context;
+	char				sha[SHA_DIGEST_LENGTH * 2 + 1];
+	const char			*error;
+} ota_fetch_t;
+
+roflash static const char *const ota_fetch_state_names[] =
+{
+	"idle",
+	"header",
+	"body",
+	"verify",
+	"done",
+	"failed",
+};
+
+static ota_fetch_t ota_fetch;
+static lwip_if_socket_t ota_fetch_socket;
+static os_timer_t ota_fetch_timer;
+string_new(static, ota_fetch_receive_buffer, 1460); // a complete tcp segment, so nothing gets truncated
+string_new(static, ota_fetch_send_buffer, 256);
+string_new(static, ota_fetch_line, 128);
+
+static void ota_fetch_fail(const char *error)
+{
+	if((ota_fetch.state == ota_fetch_failed) || (ota_fetch.state == ota_fetch_done))
+		return;
+
+	logf("flash-fetch: %s\n", error);
+
+	ota_fetch.error = error;
+	ota_fetch.state = ota_fetch_failed;
+	ota_fetch.time_finish = system_get_time();
+	ota_fetch.close = 1;
+}
+
+// write failures of the fetch are kept apart from those of flash-write, which are reported by the next flash command
+
+static void ota_fetch_flash_job_done(bool success, unsigned int address, void *context)
+{
+	flash_buffer_release((string_t *)context);
+
+	if(!success && !ota_fetch.flash_failed)
+	{
+		logf("flash-fetch: background erase/write failed at %x\n", address);
+		ota_fetch.flash_failed = 1;
+		ota_fetch.flash_failed_address = address;
+	}
+}
+
+static void ota_fetch_write_sector(void)
+{
+	unsigned int length = string_length(ota_fetch.buffer);
+
+	// pad the last sector, the padding isn't part of the image checksum
+
+	if(length < SPI_FLASH_SEC_SIZE)
+		memset(string_buffer_nonconst(ota_fetch.buffer) + length, 0xff, SPI_FLASH_SEC_SIZE - length);
+
+	if(!flash_job_submit(flash_job_erase_write, ota_fetch.address + ota_fetch.written, string_buffer(ota_fetch.buffer), SPI_FLASH_SEC_SIZE,
+				ota_fetch_flash_job_done, ota_fetch.buffer))
+	{
+		flash_job_flush();
+
+		if(!flash_job_submit(flash_job_erase_write, ota_fetch.address + ota_fetch.written, string_buffer(ota_fetch.buffer), SPI_FLASH_SEC_SIZE,
+					ota_fetch_flash_job_done, ota_fetch.buffer))
+		{
+			ota_fetch_fail("cannot queue write");
+			return;
+		}
+	}
+
+	ota_fetch.buffer = (string_t *)0;
+	ota_fetch.written += SPI_FLASH_SEC_SIZE;
+}
+
+static void ota_fetch_receive_body(const char *data, unsigned int length)
+{
+	unsigned int chunk;
+	unsigned char sha_result[SHA_DIGEST_LENGTH];
+	string_t sha_string;
+
+	if((ota_fetch.received + length) > ota_fetch.content_length)
+		length = ota_fetch.content_length - ota_fetch.received;
+
+	while((ota_fetch.state == ota_fetch_body) && (length > 0))
+	{
+		if(!ota_fetch.buffer && !(ota_fetch.buffer = flash_buffer_lease(fsb_ota)))
+		{
+			ota_fetch_fail("no sector buffer available");
+			return;
+		}
+
+		chunk = SPI_FLASH_SEC_SIZE - string_length(ota_fetch.buffer);
+
+		if(chunk > length)
+			chunk = length;
+
+		string_append_bytes(ota_fetch.buffer, data, chunk);
+		SHA1Update(&ota_fetch.sha_context, data, chunk);
+
+		ota_fetch.received += chunk;
+		data += chunk;
+		length -= chunk;
+
+		if((string_length(ota_fetch.buffer) >= SPI_FLASH_SEC_SIZE) || (ota_fetch.received >= ota_fetch.content_length))
+			ota_fetch_write_sector();
+	}
+
+	if((ota_fetch.state == ota_fetch_body) && (ota_fetch.received >= ota_fetch.content_length))
+	{
+		SHA1Final(sha_result, &ota_fetch.sha_context);
+		string_set(&sha_string, ota_fetch.sha, sizeof(ota_fetch.sha), 0);
+		string_bin_to_hex(&sha_string, sha_result, SHA_DIGEST_LENGTH);
+		string_to_cstr(&sha_string);
+
+		ota_fetch.state = ota_fetch_verify;
+		ota_fetch.idle_ticks = 0;
+		ota_fetch.close = 1;
+	}
+}
+
+static bool ota_fetch_header_name(const string_t *line, const char *name)
+{
+	int ix;
+	char c;
+
+	for(ix = 0; name[ix]; ix++)
+	{
+		if(ix >= string_length(line))
+			return(false);
+
+		c = string_at(line, ix);
+
+		if((c >= 'A') && (c <= 'Z'))
+			c += 'a' - 'A';
+
+		if(c != name[ix])
+			return(false);
+	}
+
+	return(true);
+}
+
+// the value may follow the colon directly or after any amount of white space, as may trailing white space
+
+static bool ota_fetch_header_uint(const string_t *line, const char *name, unsigned int *value)
+{
+	int ix, digits;
+	char c;
+
+	if(!ota_fetch_header_name(line, name))
+		return(false);
+
+	for(ix = strlen(name); (ix < string_length(line)) && ((string_at(line, ix) == ' ') || (string_at(line, ix) == '\t')); ix++)
+		(void)0;
+
+	for(*value = 0, digits = 0; ix < string_length(line); ix++, digits++)
+	{
+		c = string_at(line, ix);
+
+		if((c < '0') || (c > '9'))
+			break;
+
+		*value = (*value * 10) + (c - '0');
+	}
+
+	// more than 9 digits may overflow and the image can't be that large anyway
+
+	if((digits == 0) || (digits > 9))
+		return(false);
+
+	for(; ix < string_length(line); ix++)
+		if((string_at(line, ix) != ' ') && (string_at(line, ix) != '\t'))
+			return(false);
+
+	return(true);
+}
+
+static void ota_fetch_header_line(void)
+{
+	unsigned int value;
+
+	if(ota_fetch.http_status < 0)
+	{
+		if(!string_nmatch_cstr(&ota_fetch_line, "HTTP/", 5) || (parse_int(1, &ota_fetch_line, &ota_fetch.http_status, 10, ' ') != parse_ok))
+		{
+			ota_fetch_fail("invalid http status line");
+			return;
+		}
+
+		if(ota_fetch.http_status != 200)
+			ota_fetch_fail("http status not ok");
+
+		return;
+	}
+
+	if(string_empty(&ota_fetch_line))
+	{
+		if(ota_fetch.content_length == 0)
+		{
+			ota_fetch_fail("no content length");
+			return;
+		}
+
+		if(ota_fetch.content_length > SIZE_OTA_IMG)
+		{
+			ota_fetch_fail("image too large for slot");
+			return;
+		}
+
+		SHA1Init(&ota_fetch.sha_context);
+		ota_fetch.state = ota_fetch_body;
+		return;
+	}
+
+	if(ota_fetch_header_uint(&ota_fetch_line, "content-length:", &value))
+		ota_fetch.content_length = value;
+}
+
+static void ota_fetch_data_received(lwip_if_socket_t *socket, unsigned int length)
+{
+	const char *data = string_buffer(socket->receive_buffer);
+	unsigned int offset, total;
+	char c;
+
+	total = string_length(socket->receive_buffer);
+	ota_fetch.idle_ticks = 0;
+
+	for(offset = 0; (ota_fetch.state == ota_fetch_header) && (offset < total); offset++)
+	{
+		c = data[offset];
+
+		if(c == '\r')
+			continue;
+
+		if(c == '\n')
+		{
+			ota_fetch_header_line();
+			string_clear(&ota_fetch_line);
+			continue;
+		}
+
+		string_append_byte(&ota_fetch_line, c);
+	}
+
+	if((ota_fetch.state == ota_fetch_body) && (offset < total))
+		ota_fetch_receive_body(data + offset, total - offset);
+
+	string_clear(socket->receive_buffer);
+	lwip_if_receive_buffer_unlock(socket);
+}
+
+static void ota_fetch_checksum_done(bool success)
+{
+	string_t *buffer;
+
+	if(ota_fetch.state != ota_fetch_verify)
+		return;
+
+	if(!success)
+	{
+		ota_fetch_fail("read back failed");
+		return;
+	}
+
+	if(strcmp(ota_checksum_job.result, ota_fetch.sha))
+	{
+		ota_fetch_fail("checksum of written image doesn't match");
+		return;
+	}
+
+	// the rboot config update needs a sector buffer as scratch space
+
+	if(!(buffer = flash_buffer_lease(fsb_ota)))
+	{
+		ota_fetch_fail("no sector buffer available for select");
+		return;
+	}
+
+	if(flash_select_slot(ota_fetch.slot, buffer, !ota_fetch.permanent) != app_action_normal)
+	{
+		logf("flash-fetch: %s", string_to_cstr(buffer));
+		flash_buffer_release(buffer);
+		ota_fetch_fail("select slot failed");
+		return;
+	}
+
+	flash_buffer_release(buffer);
+
+	ota_fetch.time_finish = system_get_time();
+	ota_fetch.state = ota_fetch_done;
+
+	logf("flash-fetch: image of %u bytes written to slot %u and selected\n", ota_fetch.received, ota_fetch.slot);
+}
+
+// socket close and timeout handling can't be done from the lwip callbacks
+
+static bool ota_fetch_busy(void)
+{
+	return((ota_fetch.state == ota_fetch_header) || (ota_fetch.state == ota_fetch_body) || (ota_fetch.state == ota_fetch_verify));
+}
+
+static void ota_fetch_timer_callback(void *arg)
+{
+	if(ota_fetch.flash_failed)
+		ota_fetch_fail("flash erase/write failed");
+
+	if(ota_fetch.close)
+	{
+		ota_fetch.close = 0;
+
+		if(lwip_if_connected(&ota_fetch_socket))
+			lwip_if_shutdown(&ota_fetch_socket);
+
+		if(ota_fetch.buffer)
+		{
+			flash_buffer_release(ota_fetch.buffer);
+			ota_fetch.buffer = (string_t *)0;
+		}
+	}
+
+	switch(ota_fetch.state)
+	{
+		case(ota_fetch_header):
+		case(ota_fetch_body):
+		{
+			if(!lwip_if_connected(&ota_fetch_socket))
+				ota_fetch_fail("connection closed before end of image");
+			else
+				if(++ota_fetch.idle_ticks > ota_fetch_timeout_ticks)
+					ota_fetch_fail("timeout");
+
+			break;
+		}
+
+		case(ota_fetch_verify):
+		{
+			// a checksum started by the user must finish first, it's not replaced
+
+			// a checksum that stopped because the task queue was full is started over, as is one that couldn't be started
+
+			if(ota_fetch.verify_started && !ota_checksum_job.running && ota_checksum_job.queue_full && (ota_checksum_job.owner == ota_checksum_owner_fetch))
+				ota_fetch.verify_started = 0;
+
+			if(!ota_fetch.verify_started && !ota_checksum_job.running)
+				ota_fetch.verify_started = ota_checksum_start(ota_checksum_owner_fetch, ota_fetch.address, ota_fetch.received, ota_checksum_sha1) ? 1 : 0;
+
+			if(++ota_fetch.idle_ticks > ota_fetch_verify_timeout_ticks)
+				ota_fetch_fail(ota_fetch.verify_started ? "verify timeout" : "verify timeout, other checksum running");
+
+			break;
+		}
+
+		default:
+		{
+			if(!ota_fetch.close)
+				os_timer_disarm(&ota_fetch_timer);
+
+			break;
+		}
+	}
+}
+#else
+static void ota_fetch_checksum_done(bool success)
+{
+}
+
+static bool ota_fetch_busy(void)
+{
+	return(false);
+}
+#endif
+
+// flash-fetch <url> <slot> [permanent]
+// url is http://<ip address>[:<port>]/<path>, the server must send a content-length header
+
+app_action_t application_function_flash_fetch(string_t *src, string_t *dst)
+{
+#if IMAGE_OTA == 0
+	string_append(dst, "ERROR flash-fetch: no OTA image\n");
+	return(app_action_error);
+#else
+	string_new(, url, 128);
+	string_new(, host, 16);
+	string_new(, option, 16);
+	const char *ptr, *path;
+	unsigned int slot, port;
+	ip_addr_t address;
+	rboot_if_config_t config;
+
+	if(ota_fetch_busy())
+	{
+		string_format(dst, "ERROR flash-fetch: fetch already running, received bytes: %u\n", ota_fetch.received);
+		return(app_action_error);
+	}
+
+	if(parse_string(1, src, &url, ' ') != parse_ok)
+	{
+		string_append(dst, "ERROR flash-fetch: url required\n");
+		return(app_action_error);
+	}
+
+	if(parse_uint(2, src, &slot, 0, ' ') != parse_ok)
+	{
+		string_append(dst, "ERROR flash-fetch: slot required\n");
+		return(app_action_error);
+	}
+
+	ota_fetch.permanent = (parse_string(3, src, &option, ' ') == parse_ok) && string_match_cstr(&option, "permanent");
+
+	if(!rboot_if_read_config(&config))
+	{
+		string_append(dst, "ERROR flash-fetch: rboot config invalid\n");
+		return(app_action_error);
+	}
+
+	if(slot >= config.slot_count)
+	{
+		string_format(dst, "ERROR flash-fetch: invalid slot, valid range = 0 - %d\n", config.slot_count - 1);
+		return(app_action_error);
+	}
+
+	if(slot == rboot_if_mapped_slot())
+	{
+		string_format(dst, "ERROR flash-fetch: slot %u is running\n", slot);
+		return(app_action_error);
+	}
+
+	ptr = string_to_cstr(&url);
+
+	if(string_nmatch_cstr(&url, "http://", 7))
+		ptr += 7;
+
+	for(; *ptr && (*ptr != ':') && (*ptr != '/'); ptr++)
+		string_append_byte(&host, *ptr);
+
+	port = 80;
+
+	if(*ptr == ':')
+		for(port = 0, ptr++; (*ptr >= '0') && (*ptr <= '9'); ptr++)
+			port = (port * 10) + (*ptr - '0');
+
+	path = *ptr == '/' ? ptr : "/";
+	address = ip_addr(string_to_cstr(&host));
+
+	if((address.addr == 0) || (port == 0) || (port > 65535))
+	{
+		string_append(dst, "ERROR flash-fetch: url should be http://<ip address>[:<port>]/<path>\n");
+		return(app_action_error);
+	}
+
+	flash_job_flush();
+
+	if(ota_fetch.buffer)
+		flash_buffer_release(ota_fetch.buffer);
+
+	ota_fetch.state = ota_fetch_header;
+	ota_fetch.close = 0;
+	ota_fetch.verify_started = 0;
+	ota_fetch.flash_failed = 0;
+	ota_fetch.flash_failed_address = 0;
+	ota_fetch.slot = slot;
+	ota_fetch.address = config.slots[slot];
+	ota_fetch.content_length = 0;
+	ota_fetch.received = 0;
+	ota_fetch.written = 0;
+	ota_fetch.idle_ticks = 0;
+	ota_fetch.http_status = -1;
+	ota_fetch.buffer = (string_t *)0;
+	ota_fetch.time_start = system_get_time();
+	ota_fetch.time_finish = ota_fetch.time_start;
+	ota_fetch.sha[0] = '\0';
+	ota_fetch.error = "";
+
+	string_clear(&ota_fetch_line);
+	string_clear(&ota_fetch_receive_buffer);
+	string_clear(&ota_fetch_send_buffer);
+	string_format(&ota_fetch_send_buffer, "GET %s HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", path, string_to_cstr(&host));
+
+	if(!lwip_if_connect(&ota_fetch_socket, &ota_fetch_receive_buffer, &ota_fetch_send_buffer, &address, port, ota_fetch_data_received) ||
+			!lwip_if_send(&ota_fetch_socket))
+	{
+		ota_fetch.state = ota_fetch_failed;
+		ota_fetch.error = "connect failed";
+		string_append(dst, "ERROR flash-fetch: connect failed\n");
+		return(app_action_error);
+	}
+
+	os_timer_disarm(&ota_fetch_timer);
+	os_timer_setfn(&ota_fetch_timer, ota_fetch_timer_callback, (void *)0);
+	os_timer_arm(&ota_fetch_timer, ota_fetch_timer_interval, 1);
+
+	string_format(dst, "OK flash-fetch: fetching http://%s:%u%s into slot %u at address %u\n", string_to_cstr(&host), port, path, slot, ota_fetch.address);
+
+	return(app_action_normal);
+#endif
+}
+
+app_action_t application_function_flash_fetch_status(string_t *src, string_t *dst)
+{
+#if IMAGE_OTA == 0
+	string_append(dst, "ERROR flash-fetch-status: no OTA image\n");
+	return(app_action_error);
+#else
+	bool finished = (ota_fetch.state == ota_fetch_done) || (ota_fetch.state == ota_fetch_failed);
+
+	string_format(dst, "OK flash-fetch-status: state: %s, slot: %u, http status: %d, received bytes: %u, of: %u, written: %u, verified: %u, milliseconds: %lu",
+			ota_fetch_state_names[ota_fetch.state], ota_fetch.slot, ota_fetch.http_status,
+			ota_fetch.received, ota_fetch.content_length, ota_fetch.written,
+			((ota_fetch.state == ota_fetch_verify) && ota_fetch.verify_started) ? ota_checksum_job.checksummed : (ota_fetch.state == ota_fetch_done ? ota_fetch.received : 0),
+			((finished ? ota_fetch.time_finish : system_get_time()) - ota_fetch.time_start) / 1000);
+
+	if(ota_fetch.sha[0])
+		string_format(dst, ", checksum: %s", ota_fetch.sha);
+
+	if(ota_fetch.state == ota_fetch_failed)
+		string_format(dst, ", error: %s", ota_fetch.error);
+
+	string_append(dst, "\n");
+
+	return(app_action_normal);
+#endif
+}
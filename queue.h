@@ -25,6 +25,16 @@ attr_inline attr_pure char queue_full(const queue_t *queue)
 	return(((queue->in + 1) % queue->size) == queue->out);
 }
 
+attr_inline attr_pure int queue_length(const queue_t *queue)
+{
+	return((queue->in - queue->out + queue->size) % queue->size);
+}
+
+attr_inline attr_pure int queue_space(const queue_t *queue)
+{
+	return(queue->size - 1 - queue_length(queue));
+}
+
 attr_inline void queue_flush(queue_t *queue)
 {
 	queue->in = 0;
@@ -54,7 +54,7 @@ bool remote_trigger_init(void)
 
 	for(remote_index = 0; remote_index < remote_trigger_max_remotes; remote_index++)
 	{
-		if(config_get_string("trigger.remote.%u.%u", &ip, 0, remote_index) && !string_match_cstr(&ip, "0.0.0.0"))
+		if(config_get_string(config_key_trigger_remote, &ip, 0, remote_index) && !string_match_cstr(&ip, "0.0.0.0"))
 		{
 			remote_trigger_active = true;
 			remote_address = ip_addr(string_to_cstr(&ip));
@@ -67,7 +67,7 @@ bool remote_trigger_init(void)
 
 	if(remote_trigger_active)
 		lwip_if_socket_create(&trigger_socket, &remote_trigger_socket_receive_buffer, &remote_trigger_socket_send_buffer, remote_trigger_local_udp_port,
-				false, true, socket_remote_trigger_callback_data_received);
+				false, true, false, socket_remote_trigger_callback_data_received);
 
 	return(true);
 }
@@ -153,11 +153,11 @@ app_action_t application_function_trigger_remote(string_t *src, string_t *dst)
 			return(app_action_error);
 		}
 
-		config_delete("trigger.remote.%u.%u", false, 0, remote_index);
+		config_delete(config_key_trigger_remote, 0, remote_index);
 
 		if(!string_match_cstr(&remote_ip, "0.0.0.0"))
 		{
-			if(!config_set_string("trigger.remote.%u.%u", string_to_cstr(&remote_ip), 0, remote_index))
+			if(!config_set_string(config_key_trigger_remote, string_to_cstr(&remote_ip), 0, remote_index))
 			{
 				config_abort_write();
 				string_append(dst, "cannot set config\n");
@@ -173,7 +173,7 @@ app_action_t application_function_trigger_remote(string_t *src, string_t *dst)
 	}
 
 	string_clear(&remote_ip);
-	if(!config_get_string("trigger.remote.%u.%u", &remote_ip, 0, remote_index))
+	if(!config_get_string(config_key_trigger_remote, &remote_ip, 0, remote_index))
 	{
 		string_clear(&remote_ip);
 		string_append(&remote_ip, "<unset>");
@@ -495,6 +495,8 @@ void				system_soft_wdt_feed(void);
 bool				system_update_cpu_freq(uint8_t);
 
 void				ets_delay_us(uint32_t);
+void				ets_intr_lock(void);
+void				ets_intr_unlock(void);
 void				ets_install_putc1(void (*)(char));
 void				ets_timer_setfn(os_timer_t *, ETSTimerFunc *, void *);
 void				ets_timer_arm_new(os_timer_t *, uint32_t, bool, bool);
@@ -61,6 +61,7 @@ static bool clear_all_flash_entries(unsigned int mirror)
 {
 	sequencer_entry_t *entry;
 	unsigned int offset, sector, current = 0;
+	string_t *sector_buffer;
 	char *buffer;
 
 	if(mirror > 1)
@@ -74,19 +75,13 @@ static bool clear_all_flash_entries(unsigned int mirror)
 	if(offset == 0) // plain image, no mirror offset
 		return(true);
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-		return(false);
-
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache) &&
-			(flash_sector_buffer_use != fsb_display_picture))
+	if(!(sector_buffer = flash_buffer_lease(fsb_sequencer)))
 	{
-		logf("clear_all_flash_entries: flash sector in use: %u\n", flash_sector_buffer_use);
+		log("clear_all_flash_entries: no sector buffer available\n");
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_sequencer;
-
-	buffer = string_buffer_nonconst(&flash_sector_buffer);
+	buffer = string_buffer_nonconst(sector_buffer);
 
 	for(sector = 0; sector < sequencer_flash_sectors; sector++)
 	{
@@ -122,11 +117,11 @@ static bool clear_all_flash_entries(unsigned int mirror)
 			goto error;
 	}
 
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	return(true);
 
 error:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	return(false);
 }
 
@@ -151,6 +146,7 @@ static bool update_flash_entry(unsigned int index, unsigned int mirror, const se
 {
 	sequencer_entry_t *entries_in_buffer, *entry_in_buffer;
 	unsigned int flash_start_offset, sector;
+	string_t *sector_buffer;
 	char *buffer;
 
 	if(!sequencer.flash_valid)
@@ -162,19 +158,13 @@ static bool update_flash_entry(unsigned int index, unsigned int mirror, const se
 	if(mirror > 1)
 		return(false);
 
-	if(string_size(&flash_sector_buffer) < SPI_FLASH_SEC_SIZE)
-		return(false);
-
-	if((flash_sector_buffer_use != fsb_free) && (flash_sector_buffer_use != fsb_config_cache) &&
-			(flash_sector_buffer_use != fsb_display_picture))
+	if(!(sector_buffer = flash_buffer_lease(fsb_sequencer)))
 	{
-		logf("clear_all_flash_entries: flash sector in use: %u\n", flash_sector_buffer_use);
+		log("update_flash_entry: no sector buffer available\n");
 		return(false);
 	}
 
-	flash_sector_buffer_use = fsb_sequencer;
-
-	buffer = string_buffer_nonconst(&flash_sector_buffer);
+	buffer = string_buffer_nonconst(sector_buffer);
 
 	if(mirror == 0)
 		flash_start_offset = SEQUENCER_FLASH_OFFSET_0;
@@ -212,11 +202,11 @@ static bool update_flash_entry(unsigned int index, unsigned int mirror, const se
 		goto error;
 
 ok:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	return(true);
 
 error:
-	flash_sector_buffer_use = fsb_free;
+	flash_buffer_release(sector_buffer);
 	return(false);
 }
 
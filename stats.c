@@ -3,9 +3,12 @@
 #include "util.h"
 #include "sys_string.h"
 #include "config.h"
+#include "dispatch.h"
+#include "flash_job.h"
 #include "sys_time.h"
 #include "i2c.h"
 #include "i2c_sensor.h"
+#include "io.h"
 #include "rboot-interface.h"
 #include "sdk.h"
 
@@ -15,14 +18,25 @@ unsigned int stat_uart_spurious;
 unsigned int stat_uart0_rx_interrupts;
 unsigned int stat_uart0_tx_interrupts;
 unsigned int stat_uart1_tx_interrupts;
+unsigned int stat_uart_rx_overrun[2];
+unsigned int stat_uart_rx_fifo_overflow[2];
+unsigned int stat_uart_rx_frames;
+unsigned int stat_uart_rx_frames_merged;
+unsigned int stat_uart_rx_frames_truncated;
 unsigned int stat_fast_timer;
+unsigned int stat_fast_timer_us_last;
+unsigned int stat_fast_timer_us_max;
+uint64_t stat_fast_timer_us_total;
 unsigned int stat_slow_timer;
 unsigned int stat_pwm_cycles;
+unsigned int stat_pwm_updates_full;
+unsigned int stat_pwm_updates_incremental;
 unsigned int stat_timer_interrupts;
 unsigned int stat_pwm_timer_interrupts;
 unsigned int stat_pwm_timer_interrupts_while_nmi_masked;
 unsigned int stat_pc_counts;
 unsigned int stat_cmd_receive_buffer_overflow;
+unsigned int stat_cmd_receive_buffer_held;
 unsigned int stat_cmd_send_buffer_overflow;
 unsigned int stat_uart_receive_buffer_overflow;
 unsigned int stat_uart_send_buffer_overflow;
@@ -31,6 +45,7 @@ unsigned int stat_update_command_udp;
 unsigned int stat_update_command_tcp;
 unsigned int stat_update_command_uart;
 unsigned int stat_update_display;
+unsigned int stat_log_deferred_dropped;
 unsigned int stat_task_posted[3];
 unsigned int stat_task_executed[3];
 unsigned int stat_task_post_failed[3];
@@ -38,9 +53,19 @@ unsigned int stat_task_current_queue[3];
 unsigned int stat_task_max_queue[3];
 unsigned int stat_config_read_requests;
 unsigned int stat_config_read_loads;
+unsigned int stat_config_buffer_reclaims;
 unsigned int stat_config_write_requests;
 unsigned int stat_config_write_saved;
 unsigned int stat_config_write_aborted;
+unsigned int stat_config_write_deferred;
+unsigned int stat_config_write_failed;
+unsigned int stat_config_index_builds;
+unsigned int stat_config_index_overflows;
+unsigned int stat_config_log_replays;
+unsigned int stat_config_log_appends;
+unsigned int stat_config_log_compactions;
+unsigned int stat_config_cache_reloads;
+unsigned int stat_config_cache_overflows;
 unsigned int stat_lwip_tcp_send_segmentation;
 unsigned int stat_lwip_tcp_send_error;
 unsigned int stat_lwip_udp_send_error;
@@ -63,6 +88,13 @@ unsigned int stat_i2c_bus_locks;
 unsigned int stat_i2c_bus_lock_max_period;
 unsigned int stat_i2c_soft_resets;
 unsigned int stat_i2c_hard_resets;
+unsigned int stat_io_expander_writes_deferred;
+unsigned int stat_io_expander_flushes;
+unsigned int stat_io_expander_flushes_failed;
+unsigned int stat_io_expander_reads;
+unsigned int stat_io_expander_reads_cached;
+unsigned int stat_io_expander_interrupts;
+unsigned int stat_io_expander_interrupts_serviced;
 
 unsigned int stat_display_update_min_us = ~0UL;
 unsigned int stat_display_update_max_us;
@@ -343,6 +375,8 @@ void stats_counters(string_t *dst)
 			">   fast: %u, slow: %u\n",
 				stat_fast_timer, stat_slow_timer);
 
+	io_periodic_fast_stats(dst);
+
 	string_format(dst,
 			">\n> TASKS\n");
 
@@ -360,19 +394,37 @@ void stats_counters(string_t *dst)
 
 	string_format(dst,
 			">\n> BUFFER OVERFLOWS\n"
-			">  cmd receive:  %4u, send: %u\n"
-			">  uart receive: %4u, send: %u\n",
-				stat_cmd_receive_buffer_overflow, stat_cmd_send_buffer_overflow,
-				stat_uart_receive_buffer_overflow, stat_uart_send_buffer_overflow);
+			">  cmd receive:  %4u, send: %u, tcp receive held (throttled): %u\n"
+			">  uart receive: %4u, send: %u\n"
+			">  uart0 rx overrun queue: %4u, fifo: %u\n"
+			">  uart1 rx overrun queue: %4u, fifo: %u\n"
+			">  deferred log entries dropped: %u\n",
+				stat_cmd_receive_buffer_overflow, stat_cmd_send_buffer_overflow, stat_cmd_receive_buffer_held,
+				stat_uart_receive_buffer_overflow, stat_uart_send_buffer_overflow,
+				stat_uart_rx_overrun[0], stat_uart_rx_fifo_overflow[0],
+				stat_uart_rx_overrun[1], stat_uart_rx_fifo_overflow[1],
+				stat_log_deferred_dropped);
 
 	string_format(dst,
 			">\n> CONFIG\n"
 			">  read requests: %u\n"
-			">  loads: %u\n"
-			">  write requests: %u, succeeded: %u, aborted: %u\n",
+			">  loads: %u, buffer reclaimed: %u\n"
+			">  write requests: %u, deferred: %u, committed: %u, aborted: %u, failed (retried): %u\n"
+			">  index builds: %u, overflows: %u\n"
+			">  log replays: %u, appends: %u, compactions: %u\n"
+			">  cache reloads: %u, overflows: %u\n",
 				stat_config_read_requests,
-				stat_config_read_loads,
-				stat_config_write_requests, stat_config_write_saved, stat_config_write_aborted);
+				stat_config_read_loads, stat_config_buffer_reclaims,
+				stat_config_write_requests, stat_config_write_deferred, stat_config_write_saved, stat_config_write_aborted, stat_config_write_failed,
+				stat_config_index_builds, stat_config_index_overflows,
+				stat_config_log_replays, stat_config_log_appends, stat_config_log_compactions,
+				stat_config_cache_reloads, stat_config_cache_overflows);
+
+	string_append(dst, ">\n> FLASH BUFFERS\n");
+	flash_buffer_stats(dst);
+
+	string_append(dst, ">\n> FLASH JOBS\n");
+	flash_job_stats(dst);
 
 	string_format(dst,
 			">\n> LWIP\n"
@@ -407,11 +459,15 @@ void stats_counters(string_t *dst)
 			">  pin change counts:   %u\n"
 			">  display updated:     %u\n"
 			">  primary PWM cycles:  %u\n"
-			">  uart data processed: %u\n",
+			">  primary PWM updates: %u full, %u incremental\n"
+			">  uart data processed: %u\n"
+			">  uart frames:         %u, merged: %u, truncated: %u\n",
 				stat_pc_counts,
 				stat_update_display,
 				stat_pwm_cycles,
-				stat_update_uart);
+				stat_pwm_updates_full, stat_pwm_updates_incremental,
+				stat_update_uart,
+				stat_uart_rx_frames, stat_uart_rx_frames_merged, stat_uart_rx_frames_truncated);
 
 	string_format(dst,
 			">\n> DEBUG COUNTERS\n"
@@ -449,6 +505,22 @@ void stats_i2c(string_t *dst)
 				yesno(i2c_info.multiplexer),
 				i2c_info.buses);
 
+	string_format(dst,
+			"> i2c io expander pin writes deferred: %u\n"
+			"> i2c io expander output flushes: %u\n"
+			"> i2c io expander output flushes failed: %u\n"
+			"> i2c io expander input samples: %u\n"
+			"> i2c io expander input reads from cache: %u\n"
+			"> i2c io expander interrupts: %u\n"
+			"> i2c io expander interrupts serviced: %u\n",
+				stat_io_expander_writes_deferred,
+				stat_io_expander_flushes,
+				stat_io_expander_flushes_failed,
+				stat_io_expander_reads,
+				stat_io_expander_reads_cached,
+				stat_io_expander_interrupts,
+				stat_io_expander_interrupts_serviced);
+
 	string_format(dst,
 			"> i2c sensors init called: %u\n"
 			"> i2c sensors init succeeded: %u\n"
@@ -24,27 +24,49 @@ extern unsigned int stat_uart_spurious;
 extern unsigned int stat_uart0_rx_interrupts;
 extern unsigned int stat_uart0_tx_interrupts;
 extern unsigned int stat_uart1_tx_interrupts;
+extern unsigned int stat_uart_rx_overrun[2];
+extern unsigned int stat_uart_rx_fifo_overflow[2];
+extern unsigned int stat_uart_rx_frames;
+extern unsigned int stat_uart_rx_frames_merged;
+extern unsigned int stat_uart_rx_frames_truncated;
 extern unsigned int stat_fast_timer;
+extern unsigned int stat_fast_timer_us_last;
+extern unsigned int stat_fast_timer_us_max;
+extern uint64_t stat_fast_timer_us_total;
 extern unsigned int stat_slow_timer;
 extern unsigned int stat_pwm_cycles;;
+extern unsigned int stat_pwm_updates_full;
+extern unsigned int stat_pwm_updates_incremental;
 extern unsigned int stat_pwm_timer_interrupts;
 extern unsigned int stat_pwm_timer_interrupts_while_nmi_masked;
 extern unsigned int stat_pc_counts;
 extern unsigned int stat_cmd_receive_buffer_overflow;
+extern unsigned int stat_cmd_receive_buffer_held;
 extern unsigned int stat_cmd_send_buffer_overflow;
 extern unsigned int stat_uart_receive_buffer_overflow;
 extern unsigned int stat_uart_send_buffer_overflow;
 extern unsigned int stat_config_read_requests;
 extern unsigned int stat_config_read_loads;
+extern unsigned int stat_config_buffer_reclaims;
 extern unsigned int stat_config_write_requests;
 extern unsigned int stat_config_write_saved;
 extern unsigned int stat_config_write_aborted;
+extern unsigned int stat_config_write_deferred;
+extern unsigned int stat_config_write_failed;
+extern unsigned int stat_config_index_builds;
+extern unsigned int stat_config_index_overflows;
+extern unsigned int stat_config_log_replays;
+extern unsigned int stat_config_log_appends;
+extern unsigned int stat_config_log_compactions;
+extern unsigned int stat_config_cache_reloads;
+extern unsigned int stat_config_cache_overflows;
 extern unsigned int stat_update_uart;
 extern unsigned int stat_update_longop;
 extern unsigned int stat_update_command_udp;
 extern unsigned int stat_update_command_tcp;
 extern unsigned int stat_update_command_uart;
 extern unsigned int stat_update_display;
+extern unsigned int stat_log_deferred_dropped;
 extern unsigned int stat_task_posted[3];
 extern unsigned int stat_task_executed[3];
 extern unsigned int stat_task_post_failed[3];
@@ -82,6 +104,13 @@ extern unsigned int stat_i2c_bus_locks;
 extern unsigned int stat_i2c_bus_lock_max_period;
 extern unsigned int stat_i2c_soft_resets;
 extern unsigned int stat_i2c_hard_resets;
+extern unsigned int stat_io_expander_writes_deferred;
+extern unsigned int stat_io_expander_flushes;
+extern unsigned int stat_io_expander_flushes_failed;
+extern unsigned int stat_io_expander_reads;
+extern unsigned int stat_io_expander_reads_cached;
+extern unsigned int stat_io_expander_interrupts;
+extern unsigned int stat_io_expander_interrupts_serviced;
 
 extern volatile uint32_t *stat_stack_sp_initial;
 extern int stat_stack_painted;
@@ -353,13 +353,13 @@ void time_sntp_start(void)
 	if(!time_flags.sntp_init_succeeded)
 		return;
 
-	if(config_get_string("sntp.server", &ip, -1, -1) && !string_match_cstr(&ip, "0.0.0.0"))
+	if(config_get_string(config_key_sntp_server, &ip, -1, -1) && !string_match_cstr(&ip, "0.0.0.0"))
 	{
 		sntp_server = ip_addr(string_to_cstr(&ip));
 		time_flags.sntp_server_valid = 1;
 	}
 
-	if(!config_get_int("sntp.tz", &sntp_timezone, -1, -1))
+	if(!config_get_int(config_key_sntp_tz, &sntp_timezone, -1, -1))
 		sntp_timezone = 0;
 
 	stat_sntp_poll = 0;
@@ -372,7 +372,7 @@ static void time_sntp_init(void)
 
 	time_flags.sntp_init_succeeded = 0;
 
-	if(lwip_if_socket_create(&sntp_socket, &sntp_socket_receive_buffer, &sntp_socket_send_buffer, 0, false, false, socket_sntp_callback_data_received))
+	if(lwip_if_socket_create(&sntp_socket, &sntp_socket_receive_buffer, &sntp_socket_send_buffer, 0, false, false, false, socket_sntp_callback_data_received))
 	{
 		send_packet->misc = sntp_misc_mode_client | (4 << sntp_misc_vn_shift);
 		string_setlength(&sntp_socket_send_buffer, sizeof(sntp_network_t));
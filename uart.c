@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 typedef struct
 {
@@ -23,9 +24,40 @@ static autofill_info_t autofill_info[2] =
 	{ false, 0 },
 };
 
+enum
+{
+	uart_rx_fifo_full_threshold = 32,
+	uart_rx_bridge_threshold = 64,
+	uart_rx_timeout_default = 2,
+	uart_frame_queue_size = 8,
+	uart_tx_fifo_size = 127,
+	uart_tx_fifo_stall_us = 10000,
+};
+
+typedef struct
+{
+	unsigned int	length;
+	uint32_t		timestamp;
+} uart_frame_t;
+
+typedef struct
+{
+	unsigned int	gap;
+	bool			timestamp;
+	unsigned int	pending;
+	unsigned int	in;
+	unsigned int	out;
+	uart_frame_t	frame[uart_frame_queue_size];
+} uart_framing_t;
+
+static uart_framing_t framing;
+
 static queue_t uart_send_queue[2];
 static queue_t uart_receive_queue;
 
+static config_cache_slot_t baud_slots[2], data_slots[2], stop_slots[2];
+static config_cache_t baud_cache, data_cache, stop_cache;
+
 attr_inline int rx_fifo_length(unsigned int uart)
 {
 	return((read_peri_reg(UART_STATUS(uart)) >> UART_RXFIFO_CNT_S) & UART_RXFIFO_CNT);
@@ -47,9 +79,9 @@ attr_inline void enable_transmit_int(unsigned int uart, bool enable)
 attr_inline void enable_receive_int(unsigned int uart, bool enable)
 {
 	if(enable)
-		set_peri_reg_mask(UART_INT_ENA(uart), UART_RXFIFO_TOUT_INT_ENA | UART_RXFIFO_FULL_INT_ENA);
+		set_peri_reg_mask(UART_INT_ENA(uart), UART_RXFIFO_TOUT_INT_ENA | UART_RXFIFO_FULL_INT_ENA | UART_RXFIFO_OVF_INT_ENA);
 	else
-		clear_peri_reg_mask(UART_INT_ENA(uart), UART_RXFIFO_TOUT_INT_ENA | UART_RXFIFO_FULL_INT_ENA);
+		clear_peri_reg_mask(UART_INT_ENA(uart), UART_RXFIFO_TOUT_INT_ENA | UART_RXFIFO_FULL_INT_ENA | UART_RXFIFO_OVF_INT_ENA);
 }
 
 attr_inline void clear_interrupts(unsigned int uart)
@@ -57,12 +89,78 @@ attr_inline void clear_interrupts(unsigned int uart)
 	write_peri_reg(UART_INT_CLR(uart), 0xffff);
 }
 
-static void clear_fifos(unsigned int uart)
+iram static void clear_fifos(unsigned int uart)
 {
 	set_peri_reg_mask(UART_CONF0(uart), UART_RXFIFO_RST | UART_TXFIFO_RST);
 	clear_peri_reg_mask(UART_CONF0(uart), UART_RXFIFO_RST | UART_TXFIFO_RST);
 }
 
+iram static void fetch_fifo(unsigned int uart, bool idle)
+{
+	int length_before, leave;
+	unsigned int next;
+
+	length_before = queue_length(&uart_receive_queue);
+
+	// make sure to fetch all data from the fifo, or we'll get a another
+	// interrupt immediately after we acknowledge it
+
+	// in framing mode, leave one byte in the fifo when the fifo isn't drained
+	// due to a timeout, otherwise the timeout interrupt that marks the end
+	// of the frame will never come
+
+	leave = (framing.gap && !idle) ? 1 : 0;
+
+	while(rx_fifo_length(uart) > leave)
+	{
+		if(queue_full(&uart_receive_queue))
+		{
+			(void)read_peri_reg(UART_FIFO(uart));
+			stat_uart_rx_overrun[uart]++;
+		}
+		else
+		{
+			queue_push(&uart_receive_queue, read_peri_reg(UART_FIFO(uart)));
+			framing.pending++;
+		}
+	}
+
+	if(framing.gap)
+	{
+		if(!idle || (framing.pending == 0))
+			return;
+
+		next = (framing.in + 1) % uart_frame_queue_size;
+
+		// if the frame queue is full, the frame will be merged with the next one
+
+		if(next == framing.out)
+		{
+			stat_uart_rx_frames_merged++;
+			return;
+		}
+
+		framing.frame[framing.in].length = framing.pending;
+		framing.frame[framing.in].timestamp = system_get_time();
+		framing.in = next;
+		framing.pending = 0;
+
+		stat_uart_rx_frames++;
+
+		if(uart_bridge_active)
+			dispatch_post_task(0, task_uart_bridge, 0);
+
+		return;
+	}
+
+	// only wake up the bridge when a reasonable amount of data has been collected
+	// or the sender has gone quiet (fifo timeout), not for every interrupt
+
+	if(uart_bridge_active && (idle ||
+			((length_before < uart_rx_bridge_threshold) && (queue_length(&uart_receive_queue) >= uart_rx_bridge_threshold))))
+		dispatch_post_task(0, task_uart_bridge, 0);
+}
+
 iram static void uart_callback(void *p)
 {
 	unsigned int uart0_int_status, uart1_int_status;
@@ -72,11 +170,17 @@ iram static void uart_callback(void *p)
 	uart0_int_status = read_peri_reg(UART_INT_ST(0));
 	uart1_int_status = read_peri_reg(UART_INT_ST(1));
 
-	if(uart0_int_status & (UART_RXFIFO_TOUT_INT_ST | UART_RXFIFO_FULL_INT_ST)) // data in input fifo of uart0
+	if(uart0_int_status & UART_RXFIFO_OVF_INT_ST) // input fifo of uart0 overflowed before we could empty it
+		stat_uart_rx_fifo_overflow[0]++;
+
+	if(uart0_int_status & (UART_RXFIFO_TOUT_INT_ST | UART_RXFIFO_FULL_INT_ST | UART_RXFIFO_OVF_INT_ST)) // data in input fifo of uart0
 	{
 		stat_uart0_rx_interrupts++;
-		enable_receive_int(0, false); // disable input info data available interrupts while the fifo is not empty
-		dispatch_post_task(0, task_uart_fetch_fifo, 0);
+
+		if(queues_alive)
+			fetch_fifo(0, !!(uart0_int_status & UART_RXFIFO_TOUT_INT_ST));
+		else
+			clear_fifos(0);
 	}
 
 	if(uart0_int_status & UART_TXFIFO_EMPTY_INT_ST) // space available in the output fifo of uart0
@@ -124,6 +228,86 @@ iram void uart_send(unsigned int uart, unsigned int byte)
 		queue_push(&uart_send_queue[uart], byte);
 }
 
+unsigned int uart_send_bytes(unsigned int uart, unsigned int length, const char *bytes)
+{
+	queue_t *queue;
+	unsigned int chunk, done;
+
+	if(!queues_alive)
+	{
+		stat_uart_spurious++;
+		return(0);
+	}
+
+	queue = &uart_send_queue[uart];
+
+	if(length > (unsigned int)queue_space(queue))
+		length = queue_space(queue);
+
+	// copy in at most two chunks, until the end of the buffer and from the start of the buffer
+
+	for(done = 0; done < length; done += chunk)
+	{
+		chunk = umin(length - done, queue->size - queue->in);
+		memcpy(queue->data + queue->in, bytes + done, chunk);
+		queue->in = (queue->in + chunk) % queue->size;
+	}
+
+	return(length);
+}
+
+// push bytes straight into the hardware fifo, waiting for room, bypassing the (too small) send queue,
+// for streams that can't tolerate gaps longer than a few bytes' time, like ledpixel frames
+
+// a fifo that doesn't take a single byte for this long won't drain at all (e.g. flow control is holding it)
+
+static bool tx_fifo_wait_space(unsigned int uart)
+{
+	uint32_t start;
+
+	if(tx_fifo_length(uart) < uart_tx_fifo_size)
+		return(true);
+
+	start = system_get_time();
+
+	while(tx_fifo_length(uart) >= uart_tx_fifo_size)
+		if((system_get_time() - start) > uart_tx_fifo_stall_us)
+			return(false);
+
+	return(true);
+}
+
+bool uart_send_fifo(unsigned int uart, unsigned int length, const uint8_t *bytes)
+{
+	unsigned int current;
+	bool transmit_int_enabled, rv;
+
+	if(!queues_alive)
+	{
+		stat_uart_spurious++;
+		return(false);
+	}
+
+	// the interrupt would start filling the fifo from the queue in between, restore it when done
+
+	transmit_int_enabled = (read_peri_reg(UART_INT_ENA(uart)) & UART_TXFIFO_EMPTY_INT_ENA) != 0;
+	enable_transmit_int(uart, false);
+
+	// anything still in the send queue goes first
+
+	for(rv = true; rv && !queue_empty(&uart_send_queue[uart]); )
+		if((rv = tx_fifo_wait_space(uart)))
+			write_peri_reg(UART_FIFO(uart), queue_pop(&uart_send_queue[uart]));
+
+	for(current = 0; rv && (current < length); current++)
+		if((rv = tx_fifo_wait_space(uart)))
+			write_peri_reg(UART_FIFO(uart), bytes[current]);
+
+	enable_transmit_int(uart, transmit_int_enabled);
+
+	return(rv);
+}
+
 iram void uart_send_string(unsigned int uart, const string_t *string)
 {
 	unsigned int current, length;
@@ -181,35 +365,72 @@ iram void uart_clear_receive_queue(unsigned int uart)
 		return;
 	}
 
+	ets_isr_mask(1 << ETS_UART_INUM);
 	queue_flush(&uart_receive_queue);
+	framing.pending = 0;
+	framing.in = framing.out = 0;
+	ets_isr_unmask(1 << ETS_UART_INUM);
 }
 
-void uart_task_handler_fetch_fifo(unsigned int uart)
+bool uart_frame_available(unsigned int uart, unsigned int *length, uint32_t *timestamp)
 {
-	unsigned int byte;
-
 	if(!queues_alive)
 	{
 		stat_uart_spurious++;
-		return;
+		return(false);
 	}
 
-	// make sure to fetch all data from the fifo, or we'll get a another
-	// interrupt immediately after we enable it
+	if(framing.in == framing.out)
+		return(false);
 
-	while(rx_fifo_length(uart) > 0)
-	{
-		byte = read_peri_reg(UART_FIFO(uart));
+	*length = framing.frame[framing.out].length;
+	*timestamp = framing.frame[framing.out].timestamp;
 
-		if(!queue_full(&uart_receive_queue))
-			queue_push(&uart_receive_queue, byte);
-	}
+	return(true);
+}
 
-	clear_interrupts(uart);
-	enable_receive_int(uart, true);
+void uart_frame_done(unsigned int uart)
+{
+	if(framing.in != framing.out)
+		framing.out = (framing.out + 1) % uart_frame_queue_size;
+}
 
-	if(uart_bridge_active)
-		dispatch_post_task(0, task_uart_bridge, 0);
+void uart_frame_mode(unsigned int uart, unsigned int gap, bool timestamp)
+{
+	if(uart != 0)
+		return;
+
+	if(gap > UART_RX_TOUT_THRHD)
+		gap = UART_RX_TOUT_THRHD;
+
+	ets_isr_mask(1 << ETS_UART_INUM);
+
+	framing.gap = gap;
+	framing.timestamp = timestamp;
+	framing.pending = 0;
+	framing.in = framing.out = 0;
+
+	if(gap == 0)
+		gap = uart_rx_timeout_default;
+
+	clear_set_peri_reg_mask(UART_CONF1(uart),
+			UART_RX_TOUT_THRHD << UART_RX_TOUT_THRHD_S,
+			(gap & UART_RX_TOUT_THRHD) << UART_RX_TOUT_THRHD_S);
+
+	ets_isr_unmask(1 << ETS_UART_INUM);
+}
+
+void uart_get_frame_mode(unsigned int uart, unsigned int *gap, bool *timestamp)
+{
+	if(uart != 0)
+	{
+		*gap = 0;
+		*timestamp = false;
+		return;
+	}
+
+	*gap = framing.gap;
+	*timestamp = framing.timestamp;
 }
 
 void uart_task_handler_fill_fifo(unsigned int uart)
@@ -372,6 +593,10 @@ void uart_init(void)
 
 	queues_alive = true;
 
+	config_cache_register(&baud_cache, baud_slots, 2, config_key_uart_baud, true, 115200);
+	config_cache_register(&data_cache, data_slots, 2, config_key_uart_data, true, 8);
+	config_cache_register(&stop_cache, stop_slots, 2, config_key_uart_stop, true, 1);
+
 	clear_fifos(0);
 	clear_fifos(1);
 
@@ -391,10 +616,14 @@ void uart_init(void)
 	// If the fifo contains less than this numbers of bytes, raise an
 	// interrupt.
 
+	// The receive fifo is emptied directly from the interrupt handler, so
+	// the "full" threshold can be quite high, leaving enough headroom in
+	// the 128 bytes fifo for the interrupt latency.
+
 	write_peri_reg(UART_CONF1(0),
-			((2 & UART_RX_TOUT_THRHD) << UART_RX_TOUT_THRHD_S) |
+			((uart_rx_timeout_default & UART_RX_TOUT_THRHD) << UART_RX_TOUT_THRHD_S) |
 			UART_RX_TOUT_EN |
-			((8 & UART_RXFIFO_FULL_THRHD) << UART_RXFIFO_FULL_THRHD_S) |
+			((uart_rx_fifo_full_threshold & UART_RXFIFO_FULL_THRHD) << UART_RXFIFO_FULL_THRHD_S) |
 			((64 & UART_TXFIFO_EMPTY_THRHD) << UART_TXFIFO_EMPTY_THRHD_S));
 
 	write_peri_reg(UART_CONF1(1),
@@ -466,18 +695,15 @@ void uart_set_initial(unsigned int uart)
 	unsigned int data;
 	unsigned int stop;
 	unsigned int parity_int;
+	unsigned int gap;
+	unsigned int timestamp;
 	uart_parity_t parity;
 
-	if(!config_get_uint("uart.baud.%u", &baud, uart, -1))
-		baud = 115200;
-
-	if(!config_get_uint("uart.data.%u", &data, uart, -1))
-		data = 8;
+	baud = config_cache_uint(&baud_cache, uart, -1);
+	data = config_cache_uint(&data_cache, uart, -1);
+	stop = config_cache_uint(&stop_cache, uart, -1);
 
-	if(!config_get_uint("uart.stop.%u", &stop, uart, -1))
-		stop = 1;
-
-	if(config_get_uint("uart.parity.%u", &parity_int, uart, -1))
+	if(config_get_uint(config_key_uart_parity, &parity_int, uart, -1))
 		parity = (uart_parity_t)parity_int;
 	else
 		parity = parity_none;
@@ -486,4 +712,12 @@ void uart_set_initial(unsigned int uart)
 	uart_data_bits(uart, data);
 	uart_stop_bits(uart, stop);
 	uart_parity(uart, parity);
+
+	if(!config_get_uint(config_key_uart_frame_gap, &gap, uart, -1))
+		gap = 0;
+
+	if(!config_get_uint(config_key_uart_frame_timestamp, &timestamp, uart, -1))
+		timestamp = 0;
+
+	uart_frame_mode(uart, gap, !!timestamp);
 }
@@ -52,12 +52,17 @@ void			uart_is_autofill(unsigned int uart, bool *enable, unsigned int *character
 bool			uart_full(unsigned int uart);
 void			uart_send(unsigned int, unsigned int);
 void			uart_send_string(unsigned int, const string_t *);
+unsigned int	uart_send_bytes(unsigned int uart, unsigned int length, const char *bytes);
+bool			uart_send_fifo(unsigned int uart, unsigned int length, const uint8_t *bytes);
 void			uart_flush(unsigned int);
 bool			uart_empty(unsigned int);
 unsigned int	uart_receive(unsigned int);
 void			uart_clear_receive_queue(unsigned int);
 void			uart_set_initial(unsigned int uart);
-void			uart_task_handler_fetch_fifo(unsigned int uart);
+void			uart_frame_mode(unsigned int uart, unsigned int gap, bool timestamp);
+void			uart_get_frame_mode(unsigned int uart, unsigned int *gap, bool *timestamp);
+bool			uart_frame_available(unsigned int uart, unsigned int *length, uint32_t *timestamp);
+void			uart_frame_done(unsigned int uart);
 void			uart_task_handler_fill_fifo(unsigned int uart);
 
 #endif
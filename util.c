@@ -3,21 +3,52 @@
 #include "uart.h"
 #include "ota.h"
 #include "config.h"
+#include "dispatch.h"
+#include "stats.h"
+#include "flash_job.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+// the log buffer is a circular buffer, every byte that's ever logged gets a sequence number,
+// when the buffer is full, the oldest bytes are overwritten
+
+enum
+{
+	logbuffer_size = 0x3fffeb2c - 0x3fffe000 - 16,
+};
+
+static char * const logbuffer_data = (char *)0x3fffe000;
+static unsigned int logbuffer_in = 0;			// position in the buffer of the next byte
+static unsigned int logbuffer_first_seq = 0;	// sequence number of the oldest byte still available
+static unsigned int logbuffer_next_seq = 0;		// sequence number of the next byte to be written
+
 unsigned int logbuffer_display_current = 0;
 
-string_t logbuffer =
+// deferred log entries only contain the pointer to the format string (in flash), the arguments
+// and a timestamp, they're rendered later from a low priority task or by the host (log-binary)
+
+enum
 {
-	.size = 0x3fffeb2c - 0x3fffe000 - 16,
-	.length = 0,
-	.buffer = (char *)0x3fffe000,
+	log_deferred_size = 32,
 };
 
+typedef struct
+{
+	const char	*fmt;
+	uint32_t	timestamp;
+	uint32_t	arg[log_deferred_args];
+} log_deferred_entry_t;
+
+assert_size(log_deferred_entry_t, 24);
+
+static log_deferred_entry_t log_deferred_entry[log_deferred_size];
+static unsigned int log_deferred_in = 0;		// sequence number of the next entry to be written
+static unsigned int log_deferred_rendered = 0;	// sequence number of the next entry to be rendered
+static bool log_deferred_posted = false;
+
 int attr_used __errno;
 
 void espconn_init(void);
@@ -27,6 +58,8 @@ void espconn_init(void)
 
 void reset(void)
 {
+	config_commit();
+	flash_job_flush();
 	system_restart();
 }
 
@@ -46,10 +79,116 @@ attr_const const char *onoff(bool value)
 	return("on");
 }
 
+iram static void logbuffer_append_char(char c)
+{
+	logbuffer_data[logbuffer_in++] = c;
+
+	if(logbuffer_in >= logbuffer_size)
+		logbuffer_in = 0;
+
+	logbuffer_next_seq++;
+
+	if((logbuffer_next_seq - logbuffer_first_seq) > logbuffer_size)
+		logbuffer_first_seq = logbuffer_next_seq - logbuffer_size;
+}
+
+static void logbuffer_append(const string_t *src)
+{
+	unsigned int offset, length, chunk;
+
+	length = string_length(src);
+
+	// only the tail of the message can be stored when it's larger than the buffer
+
+	if(length > logbuffer_size)
+	{
+		logbuffer_next_seq += length - logbuffer_size;
+		offset = length - logbuffer_size;
+	}
+	else
+		offset = 0;
+
+	for(; offset < length; offset += chunk)
+	{
+		chunk = umin(length - offset, logbuffer_size - logbuffer_in);
+		memcpy(logbuffer_data + logbuffer_in, string_buffer(src) + offset, chunk);
+
+		logbuffer_in += chunk;
+
+		if(logbuffer_in >= logbuffer_size)
+			logbuffer_in = 0;
+
+		logbuffer_next_seq += chunk;
+	}
+
+	if((logbuffer_next_seq - logbuffer_first_seq) > logbuffer_size)
+		logbuffer_first_seq = logbuffer_next_seq - logbuffer_size;
+}
+
+attr_inline unsigned int logbuffer_index(unsigned int seq)
+{
+	unsigned int distance = logbuffer_next_seq - seq; // <= logbuffer_size
+
+	if(distance > logbuffer_in)
+		return(logbuffer_in + logbuffer_size - distance);
+
+	return(logbuffer_in - distance);
+}
+
 void logbuffer_clear(void)
 {
-	logbuffer_display_current = 0;
-	string_clear(&logbuffer);
+	logbuffer_first_seq = logbuffer_next_seq;
+}
+
+attr_pure unsigned int logbuffer_first(void)
+{
+	return(logbuffer_first_seq);
+}
+
+attr_pure unsigned int logbuffer_next(void)
+{
+	return(logbuffer_next_seq);
+}
+
+bool logbuffer_get_char(unsigned int *seq, char *c)
+{
+	// the requested byte has been overwritten already, skip to the oldest available
+
+	if((logbuffer_next_seq - *seq) > (logbuffer_next_seq - logbuffer_first_seq))
+		*seq = logbuffer_first_seq;
+
+	if(*seq == logbuffer_next_seq)
+		return(false);
+
+	*c = logbuffer_data[logbuffer_index(*seq)];
+	(*seq)++;
+
+	return(true);
+}
+
+unsigned int logbuffer_get(string_t *dst, unsigned int from, unsigned int to)
+{
+	unsigned int index, chunk, length;
+
+	if((logbuffer_next_seq - from) > (logbuffer_next_seq - logbuffer_first_seq))
+		from = logbuffer_first_seq;
+
+	if((logbuffer_next_seq - to) > (logbuffer_next_seq - from))
+		to = logbuffer_next_seq;
+
+	length = to - from;
+
+	if(length > (unsigned int)(string_size(dst) - string_length(dst)))
+		length = string_size(dst) - string_length(dst);
+
+	for(index = logbuffer_index(from); length > 0; length -= chunk, from += chunk)
+	{
+		chunk = umin(length, logbuffer_size - index);
+		string_append_bytes(dst, logbuffer_data + index, chunk);
+		index = 0;
+	}
+
+	return(from);
 }
 
 unsigned int log_from_flash(const char *data)
@@ -63,12 +202,7 @@ unsigned int log_from_flash(const char *data)
 		uart_send_string(0, &flash_dram);
 
 	if(config_flags_match(flag_log_to_buffer))
-	{
-		if((unsigned int)(string_length(&logbuffer) + length) >= (unsigned int)string_size(&logbuffer))
-			logbuffer_clear();
-
-		string_append_string(&logbuffer, &flash_dram);
-	}
+		logbuffer_append(&flash_dram);
 
 	return(length);
 }
@@ -94,14 +228,97 @@ unsigned int log_from_flash_format(const char *fmt_in_flash, ...)
 		uart_send_string(0, &flash_dram);
 
 	if(config_flags_match(flag_log_to_buffer))
+		logbuffer_append(&flash_dram);
+
+	return(length);
+}
+
+iram void log_deferred(const char *fmt_in_flash, unsigned int args, ...)
+{
+	va_list ap;
+	unsigned int ix;
+	uint32_t arg[log_deferred_args];
+	log_deferred_entry_t *entry;
+
+	va_start(ap, args);
+
+	for(ix = 0; ix < log_deferred_args; ix++)
+		arg[ix] = (ix < args) ? va_arg(ap, uint32_t) : 0;
+
+	va_end(ap);
+
+	if(!config_flags_match(flag_log_deferred))
 	{
-		if((string_length(&logbuffer) + length) >= string_size(&logbuffer))
-			logbuffer_clear();
+		log_from_flash_format(fmt_in_flash, arg[0], arg[1], arg[2], arg[3]);
+		return;
+	}
 
-		string_append_string(&logbuffer, &flash_dram);
+	ets_intr_lock();
+
+	if((log_deferred_in - log_deferred_rendered) >= log_deferred_size)
+	{
+		ets_intr_unlock();
+		stat_log_deferred_dropped++;
+		return;
 	}
 
-	return(length);
+	entry = &log_deferred_entry[log_deferred_in % log_deferred_size];
+	entry->fmt = fmt_in_flash;
+	entry->timestamp = system_get_time();
+
+	for(ix = 0; ix < log_deferred_args; ix++)
+		entry->arg[ix] = arg[ix];
+
+	log_deferred_in++;
+
+	ets_intr_unlock();
+
+	// if the task queue is full, the next entry tries again
+
+	if(!log_deferred_posted)
+	{
+		log_deferred_posted = true;
+
+		if(!dispatch_post_task(2, task_log_deferred, 0))
+			log_deferred_posted = false;
+	}
+}
+
+void log_deferred_render(void)
+{
+	const log_deferred_entry_t *entry;
+
+	log_deferred_posted = false;
+
+	while(log_deferred_rendered != log_deferred_in)
+	{
+		entry = &log_deferred_entry[log_deferred_rendered % log_deferred_size];
+
+		logf("[%lu.%06lu] ", entry->timestamp / 1000000, entry->timestamp % 1000000);
+		log_from_flash_format(entry->fmt, entry->arg[0], entry->arg[1], entry->arg[2], entry->arg[3]);
+
+		log_deferred_rendered++;
+	}
+}
+
+void log_deferred_dump(string_t *dst)
+{
+	const log_deferred_entry_t *entry;
+	unsigned int seq, ix;
+
+	seq = (log_deferred_in > log_deferred_size) ? log_deferred_in - log_deferred_size : 0;
+
+	for(; seq != log_deferred_in; seq++)
+	{
+		entry = &log_deferred_entry[seq % log_deferred_size];
+
+		string_format(dst, "%u %08lx %08lx", seq, (unsigned long)entry->timestamp, (unsigned long)entry->fmt);
+
+		for(ix = 0; ix < log_deferred_args; ix++)
+			string_format(dst, " %08lx", (unsigned long)entry->arg[ix]);
+
+		string_append(dst, "\n");
+	}
 }
 
 iram void logchar(char c)
@@ -113,12 +330,7 @@ iram void logchar(char c)
 	}
 
 	if(config_flags_match(flag_log_to_buffer))
-	{
-		if((logbuffer.length + 1) >= logbuffer.size)
-			logbuffer_clear();
-
-		string_append_char(&logbuffer, c);
-	}
+		logbuffer_append_char(c);
 }
 
 void msleep(int msec)
@@ -70,9 +70,12 @@ attr_inline void csleep(volatile uint32_t target)
 
 ip_addr_t ip_addr(const char *);
 
-extern string_t logbuffer;
 extern unsigned int logbuffer_display_current;
 void logbuffer_clear(void);
+unsigned int logbuffer_first(void);
+unsigned int logbuffer_next(void);
+bool logbuffer_get_char(unsigned int *seq, char *c);
+unsigned int logbuffer_get(string_t *dst, unsigned int from, unsigned int to);
 
 unsigned int attr_nonnull log_from_flash(const char *data);
 unsigned int attr_nonnull log_from_flash_format(const char *fmt_in_flash, ...) __attribute__ ((format (printf, 1, 2)));
@@ -89,6 +92,27 @@ do { \
 	log_from_flash_format(log_fmt_flash, __VA_ARGS__); \
 } while(0)
 
+// deferred logging, only for integer arguments (no strings, no floating point),
+// the format string and arguments are stored and rendered later
+
+enum
+{
+	log_deferred_args = 4,
+};
+
+void log_deferred(const char *fmt_in_flash, unsigned int args, ...) __attribute__ ((format (printf, 1, 3)));
+void log_deferred_render(void);
+void log_deferred_dump(string_t *dst);
+
+#define logd_args(...) ((sizeof((unsigned int []){ 0, ##__VA_ARGS__ }) / sizeof(unsigned int)) - 1)
+
+#define logd(fmt, ...) \
+do { \
+	static roflash const char log_fmt_flash[] = fmt; \
+	_Static_assert(logd_args(__VA_ARGS__) <= log_deferred_args, "logd: too many arguments"); \
+	log_deferred(log_fmt_flash, logd_args(__VA_ARGS__), ##__VA_ARGS__); \
+} while(0)
+
 void logchar(char c);
 
 #endif